@@ -165,7 +165,7 @@ namespace llvm {
   // about the jump tables created by JumpInstrTables
   ImmutablePass *createJumpInstrTableInfoPass();
 
-FunctionPass *createFsSemanticFunctionPass(StringRef ConfFile, StringRef OutDir);
+ModulePass *createFsSemanticPass(StringRef ConfFile, StringRef OutDir);
 }
 
 #endif
@@ -0,0 +1,104 @@
+//===- llvm/Support/TimeProfiler.h - Hierarchical Time Profiler -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a profiler recording the nested sections of a run of a
+// tool (the parsing of a header, the instantiation of a template, a pass run
+// over a function, ...) and writing them as a JSON file in the Chrome
+// trace_event format, which chrome://tracing and speedscope display as a
+// flame graph.
+//
+// The sections are marked with TimeTraceScope objects, which do nothing
+// unless the profiler has been initialized. The profiler is not thread-safe:
+// it records the sections of the thread which runs the tool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMEPROFILER_H
+#define LLVM_SUPPORT_TIMEPROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+#include <type_traits>
+
+namespace llvm {
+
+class raw_ostream;
+struct TimeTraceProfiler;
+
+extern TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// Initializes the profiler. The sections shorter than
+/// \p TimeTraceGranularity microseconds are not recorded, which keeps the
+/// trace small; the time they take still counts in the totals.
+///
+/// \param ProcName The name of the process in the trace.
+void timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
+                                 StringRef ProcName);
+
+/// Destroys the profiler and the sections it has recorded.
+void timeTraceProfilerCleanup();
+
+/// Returns true if the profiler has been initialized.
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != nullptr;
+}
+
+/// Writes the sections recorded so far to \p OS in the trace_event format,
+/// followed by the total time spent in the outermost sections of each name.
+void timeTraceProfilerWrite(raw_ostream &OS);
+
+/// Opens a section named \p Name. \p Detail, e.g. the file name or the
+/// function name, is shown with it.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// Closes the last section opened.
+void timeTraceProfilerEnd();
+
+/// \brief Records the lifetime of the object as a section, if the profiler
+/// is enabled.
+///
+/// The detail of the section is only computed if the profiler is enabled,
+/// so that it costs nothing otherwise:
+/// \code
+///   TimeTraceScope Scope("InstantiateFunction", [&]() {
+///     return FD->getQualifiedNameAsString();
+///   });
+/// \endcode
+class TimeTraceScope {
+  bool Enabled;
+
+  TimeTraceScope(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit TimeTraceScope(StringRef Name, StringRef Detail = StringRef())
+      : Enabled(timeTraceProfilerEnabled()) {
+    if (Enabled)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  /// \param Detail A callable returning the detail as a std::string.
+  template <typename DetailFn>
+  TimeTraceScope(StringRef Name, DetailFn &&Detail,
+                 typename std::enable_if<
+                     !std::is_convertible<DetailFn, StringRef>::value>::type * =
+                     nullptr)
+      : Enabled(timeTraceProfilerEnabled()) {
+    if (Enabled)
+      timeTraceProfilerBegin(Name, Detail());
+  }
+  ~TimeTraceScope() {
+    if (Enabled)
+      timeTraceProfilerEnd();
+  }
+};
+
+} // end namespace llvm
+
+#endif
@@ -114,6 +114,10 @@ public:
   ///
   void stopTimer();
 
+  /// getTotalTime - Return the time accumulated by this timer since it was
+  /// last printed.
+  TimeRecord getTotalTime() const { return Time; }
+
 private:
   friend class TimerGroup;
 };
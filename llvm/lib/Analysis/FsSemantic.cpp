@@ -1,17 +1,26 @@
 #include "llvm/IR/Constants.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Function.h"
-#include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
@@ -19,76 +28,111 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <atomic>
+#include <thread>
+#endif
 
 using namespace llvm;
 
 #define DL_NAME "fs-semantic"
 #define DEBUG_TYPE DL_NAME
 
+STATISTIC(NumIndirectCalls, "Number of indirect calls visited");
+STATISTIC(NumResolvedIndirectCalls,
+          "Number of indirect calls resolved through op tables");
+STATISTIC(NumCachedFunctions,
+          "Number of functions whose call sites were read from the cache");
+
 static cl::opt<bool> ClVerbose(
   "fs-semantic-verbose", cl::desc("Verbose outputs for fs-semantic"), 
   cl::Hidden,cl::init(false));
 
-#define FSS_DEBUG(stmt)                         \
-  do {                                          \
-    if (ClVerbose)                              \
-      llvm::errs() << stmt;                     \
-  } while(0)
-
-#define FSS_PRINT(stmt)                         \
-  do {                                          \
-    if (OutFile)                                \
-      *OutFile << stmt;                         \
-    FSS_DEBUG(stmt);                            \
-  } while(0)
-
-#define FSS_PRINT_TYPE(type)                    \
-  do {                                          \
-    if (OutFile)                                \
-      (type)->print(*OutFile);                  \
-    if (ClVerbose)                              \
-      (type)->print(llvm::errs());              \
-  } while(0)
+static cl::opt<unsigned> ClThreads(
+  "fs-semantic-threads",
+  cl::desc("Number of threads writing the fs-semantic outputs "
+           "(0 = one per core)"),
+  cl::Hidden, cl::init(0));
 
-namespace {
+static cl::opt<std::string> ClCacheDir(
+  "fs-semantic-cache-dir",
+  cl::desc("Directory caching the call sites of the functions across "
+           "fs-semantic runs"),
+  cl::Hidden, cl::init(""));
 
-class FsSemantic : public FunctionPass, public InstVisitor<FsSemantic> {
-  friend class InstVisitor<FsSemantic>;
+namespace {
 
+class FsSemantic : public ModulePass {
   FsSemantic(const FsSemantic &); // do not implement
 protected:
-  Function *F;
-
   // Allocator
   BumpPtrAllocator Alloc;
 
   /// List of target functions
   StringMap<StringRef> Targets;
 
-  /// Set to prevent us from cycling
-  SmallPtrSet<Function *, 8> Visited;
+  /// A call site in the body of a function: the name of its direct callee,
+  /// or of the callees of an indirect call resolved through the op tables,
+  /// or, if there is none, the printed type of the called value
+  struct CallInfo {
+    SmallVector<StringRef, 1> Callees;
+    StringRef IndirectType;
+  };
+
+  /// Call sites of every function reachable from a target by name, in
+  /// instruction order. Each body is walked once however many targets reach
+  /// it. The functions defined in other modules have the call sites cached
+  /// under their name, if any.
+  StringMap<std::vector<CallInfo> > Calls;
+
+  /// Functions stored into each function pointer field, identified by its
+  /// struct type and index, by the initializers of the global op tables
+  /// (e.g. toyfs_file_setattr into inode_operations.setattr)
+  typedef std::pair<StructType *, unsigned> FieldTy;
+  DenseMap<FieldTy, TinyPtrVector<Function *> > FieldTargets;
+
+  /// Named struct types by their name without the suffix the IR linker
+  /// appends to the copies of a type it could not merge (struct.inode.42)
+  StringMap<StructType *> CanonicalTypes;
+  DenseMap<StructType *, StructType *> CanonicalTypeCache;
+
+  /// Hash of the indexed op table fields, in module order, which the cached
+  /// call sites of a function depend on as well as its IR
+  MD5 OpTablesHash;
+  std::string OpTablesDigest;
 
   /// Analysis result
-  raw_ostream *OutFile; 
   StringRef OutDir;
 
+  /// Targets defined in the module, with their op names
+  std::vector<std::pair<StringRef, StringRef> > Roots;
+
 
   bool loadConfFile(StringRef ConfFileName);
-  void visitCallSite(CallSite CS);
-  Function *resolveCallee(Value *V);
-  void createOutputFile(StringRef OpName, StringRef FuncName);
-  void closeOutputFile() {
-    delete(OutFile); 
-    OutFile = nullptr;
-  }
+  StructType *getCanonicalType(StructType *STy);
+  void indexInitializer(Constant *C);
+  ArrayRef<Function *> resolveCallee(Value *V);
+  void getCalls(Function &F, std::vector<CallInfo> &FCalls);
+  void collectCalls(Module &M, StringRef Root);
+  bool loadCalls(StringRef FileName, std::vector<CallInfo> &FCalls);
+  void writeCalls(StringRef FileName,
+                  const std::vector<CallInfo> &FCalls) const;
+  void printCalls(StringRef Name, StringSet<> &Visited,
+                  raw_ostream &OS) const;
+  void writeOutputFile(unsigned Root) const;
+  void writeOutputFiles() const;
 
 public:
   static char ID; // Pass identification, replacement for typeid
 
   FsSemantic(StringRef ConfFileName = "", StringRef OutDirName = "") 
-    : FunctionPass(ID), OutFile(nullptr) {
+    : ModulePass(ID) {
     if (!loadConfFile(ConfFileName)) {
       errs() << "Error loading '" << ConfFileName << "\n";
       exit(1);
@@ -98,7 +142,7 @@ public:
     initializeFsSemanticPass(*PassRegistry::getPassRegistry());
   }
 
-  bool runOnFunction(Function &F_) override;
+  bool runOnModule(Module &M) override;
   // void getAnalysisUsage(AnalysisUsage &AU) const override;
   // void print(raw_ostream &O, const Module *M = nullptr) const override;
 };
@@ -148,55 +192,392 @@ bool FsSemantic::loadConfFile(StringRef ConfFile) {
   return true;
 }
 
-void FsSemantic::visitCallSite(CallSite CS) {
-  // Callee of call or invoke instruction
-  Value *V = CS.getCalledValue();
-  Function *F;
+StructType *FsSemantic::getCanonicalType(StructType *STy) {
+  if (!STy->hasName())
+    return STy;
+
+  StructType *&Canonical = CanonicalTypeCache[STy];
+  if (Canonical)
+    return Canonical;
+
+  // struct.inode_operations.42 -> struct.inode_operations
+  StringRef Name = STy->getName();
+  std::pair<StringRef, StringRef> Split = Name.rsplit('.');
+  unsigned Suffix;
+  if (!Split.second.empty() && !Split.second.getAsInteger(10, Suffix))
+    Name = Split.first;
+
+  StructType *&ByName = CanonicalTypes[Name];
+  if (!ByName)
+    ByName = STy;
+  return Canonical = ByName;
+}
+
+void FsSemantic::indexInitializer(Constant *C) {
+  // arrays of op tables
+  if (ConstantArray *CA = dyn_cast<ConstantArray>(C)) {
+    for (unsigned I = 0, E = CA->getNumOperands(); I != E; ++I)
+      indexInitializer(CA->getOperand(I));
+    return;
+  }
+
+  ConstantStruct *CS = dyn_cast<ConstantStruct>(C);
+  if (!CS)
+    return;
+
+  StructType *STy = getCanonicalType(CS->getType());
+  for (unsigned I = 0, E = CS->getNumOperands(); I != E; ++I) {
+    Constant *Field = CS->getOperand(I);
+    Function *Fn = dyn_cast<Function>(Field->stripPointerCasts());
+    // op tables embedded in other structs
+    if (!Fn) {
+      indexInitializer(Field);
+      continue;
+    }
+
+    TinyPtrVector<Function *> &Fns = FieldTargets[FieldTy(STy, I)];
+    if (std::find(Fns.begin(), Fns.end(), Fn) == Fns.end())
+      Fns.push_back(Fn);
+
+    StringRef TypeName = STy->hasName() ? STy->getName() : "<literal>";
+    OpTablesHash.update((TypeName + "." + Twine(I) + " " + Fn->getName() +
+                         "\n").str());
+  }
+}
+
+/// Strip the bitcasts only; stripPointerCasts() also strips the all-zero
+/// GEPs selecting the first field of a struct.
+static Value *stripBitCasts(Value *V) {
+  while (Operator::getOpcode(V) == Instruction::BitCast)
+    V = cast<Operator>(V)->getOperand(0);
+  return V;
+}
 
-  // direct call
-  if ( (F = dyn_cast<Function>(V)) || (F = resolveCallee(V)) )
-    FSS_PRINT(F->getName() << "\n");
-  // indirect call
-  else {
-    FSS_PRINT("# indirect call: ");
-    FSS_PRINT_TYPE(V->getType());
-    FSS_PRINT("\n");
+ArrayRef<Function *> FsSemantic::resolveCallee(Value *V) {
+  // Resolve callee of indirect call through a function pointer loaded from
+  // a field of an op table, e.g. inode->i_op->setattr(...): look up the
+  // functions the global op tables store into the same field of the same
+  // struct type.
+  LoadInst *LI = dyn_cast<LoadInst>(stripBitCasts(V));
+  if (!LI)
+    return None;
+
+  Value *Ptr = stripBitCasts(LI->getPointerOperand());
+  StructType *STy = nullptr;
+  unsigned Field = 0;
+  if (GEPOperator *GEP = dyn_cast<GEPOperator>(Ptr)) {
+    // the struct indexed by the last index
+    for (gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP);
+         GTI != GTE; ++GTI) {
+      STy = dyn_cast<StructType>(*GTI);
+      if (STy)
+        Field = cast<ConstantInt>(GTI.getOperand())->getZExtValue();
+    }
+  } else {
+    // the first field, through a cast of a pointer to the struct
+    PointerType *PTy = dyn_cast<PointerType>(Ptr->getType());
+    if (PTy)
+      STy = dyn_cast<StructType>(PTy->getElementType());
   }
+  if (!STy)
+    return None;
+
+  DenseMap<FieldTy, TinyPtrVector<Function *> >::const_iterator I =
+    FieldTargets.find(FieldTy(getCanonicalType(STy), Field));
+  if (I == FieldTargets.end())
+    return None;
+  return I->second;
+}
+
+void FsSemantic::getCalls(Function &F, std::vector<CallInfo> &FCalls) {
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    CallSite CS(&*I);
+    if (!CS)
+      continue;
 
-  // go deeper
-  if (F && Visited.insert(F).second)
-    visit(F); 
+    // Callee of call or invoke instruction
+    Value *V = CS.getCalledValue();
+    CallInfo Call;
+    // direct call
+    if (Function *Callee = dyn_cast<Function>(V))
+      Call.Callees.push_back(Callee->getName());
+    // indirect call
+    else {
+      ++NumIndirectCalls;
+      ArrayRef<Function *> Resolved = resolveCallee(V);
+      for (unsigned J = 0, JE = Resolved.size(); J != JE; ++J)
+        Call.Callees.push_back(Resolved[J]->getName());
+
+      if (Resolved.empty()) {
+        std::string Type;
+        raw_string_ostream OS(Type);
+        V->getType()->print(OS);
+        Call.IndirectType = StringRef(OS.str()).copy(Alloc);
+      } else
+        ++NumResolvedIndirectCalls;
+    }
+    FCalls.push_back(Call);
+  }
 }
 
-Function *FsSemantic::resolveCallee(Value *V) {
-  // Resolve callee of indirect call
+/// Returns the name of a function with the characters which cannot appear
+/// in a file name replaced.
+static std::string getFileNameBase(StringRef Name) {
+  std::string Base = Name;
+  for (unsigned I = 0, E = Base.size(); I != E; ++I)
+    if (!isalnum(static_cast<unsigned char>(Base[I])) && Base[I] != '_' &&
+        Base[I] != '.')
+      Base[I] = '_';
+  return Base;
+}
 
-  // XXX need to implement 
-  return NULL;
+/// Returns the hash of the IR of \p F and of the op tables it may call
+/// through, so that the cached call sites of a changed function are not used.
+static std::string getIRHash(const Function &F, StringRef OpTablesDigest) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  F.print(OS);
+
+  MD5 Hash;
+  Hash.update(OS.str());
+  Hash.update(OpTablesDigest);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
 }
 
-void FsSemantic::createOutputFile(StringRef OpName, StringRef FuncName) {
+// A cache file lists the call sites of a function, one per line:
+//
+//   FSC 1
+//   call toyfs_lookup
+//   call toyfs_file_setattr ext2_setattr
+//   indirect i32 (%struct.inode*)*
+//
+// with the callees of an indirect call resolved through the op tables on one
+// line.
+static const char CacheMagic[] = "FSC 1";
+
+bool FsSemantic::loadCalls(StringRef FileName,
+                           std::vector<CallInfo> &FCalls) {
+  SmallString<128> Path(ClCacheDir);
+  sys::path::append(Path, FileName);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MemBufOrErr =
+    MemoryBuffer::getFile(Path.str());
+  if (!MemBufOrErr)
+    return false;
+
+  SmallVector<StringRef, 32> Lines;
+  (*MemBufOrErr)->getBuffer().split(Lines, "\n", -1, false);
+  if (Lines.empty() || Lines[0] != CacheMagic)
+    return false;
+
+  std::vector<CallInfo> Loaded;
+  for (unsigned I = 1, E = Lines.size(); I != E; ++I) {
+    std::pair<StringRef, StringRef> Token = Lines[I].split(' ');
+    CallInfo Call;
+    if (Token.first == "call") {
+      SmallVector<StringRef, 4> Names;
+      Token.second.split(Names, " ", -1, false);
+      for (unsigned J = 0, JE = Names.size(); J != JE; ++J)
+        Call.Callees.push_back(Names[J].copy(Alloc));
+      if (Call.Callees.empty())
+        return false;
+    } else if (Token.first == "indirect" && !Token.second.empty()) {
+      Call.IndirectType = Token.second.copy(Alloc);
+    } else
+      return false;
+    Loaded.push_back(Call);
+  }
+
+  FCalls.swap(Loaded);
+  ++NumCachedFunctions;
+  return true;
+}
+
+void FsSemantic::writeCalls(StringRef FileName,
+                            const std::vector<CallInfo> &FCalls) const {
+  SmallString<128> Path(ClCacheDir), TmpPath;
+  sys::path::append(Path, FileName);
+
+  // Several runs may write the same file; write it to a private file first
+  // so that readers never see a partial one.
+  int FD;
+  if (sys::fs::createUniqueFile(Path.str() + "-%%%%%%.tmp", FD, TmpPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << CacheMagic << '\n';
+    for (unsigned I = 0, E = FCalls.size(); I != E; ++I) {
+      const CallInfo &Call = FCalls[I];
+      if (Call.Callees.empty()) {
+        OS << "indirect " << Call.IndirectType << '\n';
+        continue;
+      }
+      OS << "call";
+      for (unsigned J = 0, JE = Call.Callees.size(); J != JE; ++J)
+        OS << ' ' << Call.Callees[J];
+      OS << '\n';
+    }
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TmpPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TmpPath.str(), Path.str()))
+    sys::fs::remove(TmpPath.str());
+}
+
+void FsSemantic::collectCalls(Module &M, StringRef Root) {
+  SmallVector<StringRef, 32> Worklist;
+  Worklist.push_back(Root);
+  while (!Worklist.empty()) {
+    StringRef Name = Worklist.pop_back_val();
+    if (Calls.count(Name))
+      continue;
+
+    std::vector<CallInfo> &FCalls = Calls[Name];
+    Function *F = M.getFunction(Name);
+    if (F && !F->isDeclaration()) {
+      if (ClCacheDir.empty())
+        getCalls(*F, FCalls);
+      else {
+        // Cache the call sites by IR hash, and by name alone for the other
+        // modules calling the function.
+        std::string Base = getFileNameBase(Name);
+        std::string FileName =
+          Base + "-" + getIRHash(*F, OpTablesDigest) + ".fsc";
+        if (!loadCalls(FileName, FCalls)) {
+          getCalls(*F, FCalls);
+          writeCalls(FileName, FCalls);
+          if (!F->hasLocalLinkage())
+            writeCalls(Base + ".fsc", FCalls);
+        }
+      }
+    }
+    // defined in another module
+    else if (!ClCacheDir.empty())
+      loadCalls(getFileNameBase(Name) + ".fsc", FCalls);
+
+    // go deeper
+    for (unsigned I = 0, E = FCalls.size(); I != E; ++I)
+      Worklist.append(FCalls[I].Callees.begin(), FCalls[I].Callees.end());
+  }
+}
+
+void FsSemantic::printCalls(StringRef Name, StringSet<> &Visited,
+                            raw_ostream &OS) const {
+  const std::vector<CallInfo> &FCalls = Calls.find(Name)->second;
+  for (unsigned I = 0, E = FCalls.size(); I != E; ++I) {
+    const CallInfo &Call = FCalls[I];
+    if (Call.Callees.empty()) {
+      OS << "# indirect call: " << Call.IndirectType << "\n";
+      continue;
+    }
+
+    for (unsigned J = 0, JE = Call.Callees.size(); J != JE; ++J) {
+      OS << Call.Callees[J] << "\n";
+
+      // go deeper
+      if (Visited.insert(Call.Callees[J]).second)
+        printCalls(Call.Callees[J], Visited, OS);
+    }
+  }
+}
+
+void FsSemantic::writeOutputFile(unsigned Root) const {
+  StringRef FuncName = Roots[Root].first;
+  StringRef OpName = Roots[Root].second;
+
   std::error_code EC;
   std::string OutFileName = OutDir.str() + "/" + 
     OpName.str() + "." + FuncName.str() + ".fss";
-  OutFile = new raw_fd_ostream(OutFileName, EC, sys::fs::F_Text);
+  raw_fd_ostream OutFile(OutFileName, EC, sys::fs::F_Text);
   if (EC) {
     errs() << "Error opening '" << OutFileName << "': " << EC.message()
            << '\n';
     exit(1);
   }
-}
 
-bool FsSemantic::runOnFunction(Function &F) {
-  StringMap<StringRef>::const_iterator I = Targets.find(F.getName());
-  if (I != Targets.end()) {
-    createOutputFile(I->second.str(), F.getName());
-    FSS_PRINT(F.getName() << "\n");
+  StringSet<> Visited;
+  Visited.insert(FuncName);
+  OutFile << FuncName << "\n";
+  printCalls(FuncName, Visited, OutFile);
+
+  if (ClVerbose) {
     Visited.clear();
-    Visited.insert(&F);
-    visit(&F);
-    closeOutputFile();
+    Visited.insert(FuncName);
+    errs() << FuncName << "\n";
+    printCalls(FuncName, Visited, errs());
+  }
+}
+
+void FsSemantic::writeOutputFiles() const {
+  unsigned NumThreads = 1;
+#if LLVM_ENABLE_THREADS
+  NumThreads = ClThreads ? ClThreads : std::thread::hardware_concurrency();
+#endif
+  // the verbose outputs of the targets would interleave
+  if (ClVerbose || NumThreads < 2 || Roots.size() < 2) {
+    for (unsigned I = 0, E = Roots.size(); I != E; ++I)
+      writeOutputFile(I);
+    return;
   }
+
+#if LLVM_ENABLE_THREADS
+  // The call sites have all been collected, so the workers only read them.
+  std::atomic<unsigned> NextRoot(0);
+  std::vector<std::thread> Workers;
+  NumThreads = std::min<unsigned>(NumThreads, Roots.size());
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Workers.push_back(std::thread([this, &NextRoot] {
+      for (unsigned Root = NextRoot++; Root < Roots.size();
+           Root = NextRoot++)
+        writeOutputFile(Root);
+    }));
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Workers[I].join();
+#endif
+}
+
+bool FsSemantic::runOnModule(Module &M) {
+  // Index the op tables once per module, so that resolving an indirect call
+  // is a single lookup.
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (I->hasInitializer())
+      indexInitializer(I->getInitializer());
+
+  MD5::MD5Result Result;
+  OpTablesHash.final(Result);
+  SmallString<32> Digest;
+  MD5::stringifyResult(Result, Digest);
+  OpTablesDigest = Digest.str();
+
+  if (!ClCacheDir.empty())
+    sys::fs::create_directories(ClCacheDir);
+
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    StringMap<StringRef>::const_iterator I = Targets.find(F->getName());
+    if (I != Targets.end()) {
+      Roots.push_back(std::make_pair(F->getName(), I->second));
+      collectCalls(M, F->getName());
+    }
+  }
+
+  writeOutputFiles();
+
+  Roots.clear();
+  Calls.clear();
+  FieldTargets.clear();
+  CanonicalTypes.clear();
+  CanonicalTypeCache.clear();
+  OpTablesHash = MD5();
   return false;
 }
 
@@ -207,6 +588,6 @@ INITIALIZE_PASS_BEGIN(FsSemantic, DL_NAME, fssemantic_name, true,
 INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_PASS_END(FsSemantic, DL_NAME, fssemantic_name, true, true)
 
-FunctionPass *llvm::createFsSemanticFunctionPass(StringRef ConfFile, StringRef OutDir) { 
+ModulePass *llvm::createFsSemanticPass(StringRef ConfFile, StringRef OutDir) {
   return new FsSemantic(ConfFile, OutDir); 
 }
@@ -0,0 +1,188 @@
+//===-- TimeProfiler.cpp - Hierarchical Time Profiler ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the hierarchical time profiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+
+namespace llvm {
+TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+}
+
+typedef std::chrono::steady_clock ClockType;
+typedef ClockType::time_point TimePointType;
+typedef std::chrono::microseconds DurationType;
+
+namespace {
+/// A section of the trace.
+struct Entry {
+  TimePointType Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+
+  Entry(TimePointType Start, std::string Name, std::string Detail)
+      : Start(Start), Duration(0), Name(std::move(Name)),
+        Detail(std::move(Detail)) {}
+};
+}
+
+namespace llvm {
+struct TimeTraceProfiler {
+  TimeTraceProfiler(unsigned TimeTraceGranularity, StringRef ProcName)
+      : StartTime(ClockType::now()), ProcName(ProcName),
+        TimeTraceGranularity(TimeTraceGranularity) {}
+
+  /// The sections which are open, innermost last.
+  SmallVector<Entry, 16> Stack;
+  /// The sections which have been closed and are long enough to be written.
+  std::vector<Entry> Entries;
+  /// The number and the total duration of the outermost sections of each
+  /// name.
+  StringMap<std::pair<unsigned, DurationType> > CountAndTotalPerName;
+  const TimePointType StartTime;
+  const std::string ProcName;
+  const DurationType TimeTraceGranularity;
+
+  void begin(StringRef Name, StringRef Detail) {
+    Stack.push_back(Entry(ClockType::now(), Name, Detail));
+  }
+
+  void end() {
+    assert(!Stack.empty() && "Must call begin() first");
+    Entry &E = Stack.back();
+    E.Duration =
+        std::chrono::duration_cast<DurationType>(ClockType::now() - E.Start);
+
+    // Only count the outermost of nested sections of the same name, such as
+    // the instantiations of templates done by another instantiation, so that
+    // the total is the time spent in them.
+    bool Outermost = true;
+    for (unsigned I = 0, N = Stack.size() - 1; I != N; ++I)
+      if (Stack[I].Name == E.Name)
+        Outermost = false;
+    if (Outermost) {
+      std::pair<unsigned, DurationType> &CountAndTotal =
+          CountAndTotalPerName[E.Name];
+      ++CountAndTotal.first;
+      CountAndTotal.second += E.Duration;
+    }
+
+    if (E.Duration >= TimeTraceGranularity)
+      Entries.push_back(std::move(E));
+    Stack.pop_back();
+  }
+
+  void write(raw_ostream &OS);
+};
+}
+
+/// Writes \p S as a JSON string.
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) {
+  assert(Stack.empty() &&
+         "All sections must be closed before the trace is written");
+  OS << "{ \"traceEvents\": [\n";
+
+  // The sections are complete events ("ph": "X") of the first thread.
+  for (const Entry &E : Entries) {
+    long long StartUs =
+        std::chrono::duration_cast<DurationType>(E.Start - StartTime).count();
+    OS << "{ \"pid\": 1, \"tid\": 0, \"ph\": \"X\", \"ts\": " << StartUs
+       << ", \"dur\": " << (long long)E.Duration.count() << ", \"name\": ";
+    writeJSONString(OS, E.Name);
+    OS << ", \"args\": { \"detail\": ";
+    writeJSONString(OS, E.Detail);
+    OS << " } },\n";
+  }
+
+  // The totals are on threads of their own, largest first, so that they do
+  // not overlap in the viewers.
+  std::vector<const StringMapEntry<std::pair<unsigned, DurationType> > *>
+      Totals;
+  for (const auto &Total : CountAndTotalPerName)
+    Totals.push_back(&Total);
+  std::sort(Totals.begin(), Totals.end(),
+            [](const StringMapEntry<std::pair<unsigned, DurationType> > *A,
+               const StringMapEntry<std::pair<unsigned, DurationType> > *B) {
+              if (A->getValue().second != B->getValue().second)
+                return A->getValue().second > B->getValue().second;
+              return A->getKey() < B->getKey();
+            });
+  unsigned Tid = 0;
+  for (const auto *Total : Totals) {
+    OS << "{ \"pid\": 1, \"tid\": " << ++Tid
+       << ", \"ph\": \"X\", \"ts\": 0, \"dur\": "
+       << (long long)Total->getValue().second.count() << ", \"name\": ";
+    writeJSONString(OS, "Total " + Total->getKey().str());
+    OS << ", \"args\": { \"count\": " << Total->getValue().first
+       << ", \"avg ms\": "
+       << (long long)(Total->getValue().second.count() / 1000 /
+                      Total->getValue().first)
+       << " } },\n";
+  }
+
+  // The name of the process, as a metadata event ("ph": "M").
+  OS << "{ \"cat\": \"\", \"pid\": 1, \"tid\": 0, \"ts\": 0, \"ph\": \"M\", "
+        "\"name\": \"process_name\", \"args\": { \"name\": ";
+  writeJSONString(OS, ProcName);
+  OS << " } }\n";
+  OS << "] }\n";
+}
+
+void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
+                                       StringRef ProcName) {
+  assert(!TimeTraceProfilerInstance && "Profiler should not be initialized");
+  TimeTraceProfilerInstance =
+      new TimeTraceProfiler(TimeTraceGranularity, ProcName);
+}
+
+void llvm::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void llvm::timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance && "Profiler object can't be null");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void llvm::timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->end();
+}
@@ -158,6 +158,12 @@ public:
                       const JobAction *JA,
                       bool IssueErrors = false) const;
 
+  /// PrintCommand - Print the command line of \p C if -v or CC_PRINT_OPTIONS
+  /// ask for it.
+  ///
+  /// \return False if the CC_PRINT_OPTIONS file could not be opened.
+  bool PrintCommand(const Command &C) const;
+
   /// ExecuteCommand - Execute an actual command.
   ///
   /// \param FailingCommand - For non-zero results, this will be set to the
@@ -172,6 +178,21 @@ public:
   void ExecuteJob(const Job &J,
      SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
 
+  /// ExecuteJobs - Execute the commands of a job list, running up to
+  /// \p NumParallelJobs of them at once (0 for one per core).
+  ///
+  /// A command starts once the commands producing its inputs have completed,
+  /// and is skipped if one of them failed, as with ExecuteJob. The output of
+  /// the commands run in parallel is buffered and printed in the order of
+  /// the jobs, and the failing commands are listed in that order too, so the
+  /// result does not depend on the number of parallel jobs.
+  ///
+  /// \param FailingCommands - For non-zero results, this will be a vector of
+  /// failing commands and their associated result code.
+  void ExecuteJobs(const JobList &Jobs,
+     SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands,
+     unsigned NumParallelJobs) const;
+
   /// initCompilationForDiagnostics - Remove stale state and suppress output
   /// so compilation can be reexecuted to generate additional diagnostic
   /// information (e.g., preprocessed source(s)).
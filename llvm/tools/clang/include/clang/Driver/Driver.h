@@ -166,6 +166,10 @@ public:
   /// Use lazy precompiled headers for PCH support.
   unsigned CCCUsePCH : 1;
 
+  /// The number of commands ExecuteCompilation runs at once
+  /// (--parallel-jobs=), or 0 for one per core.
+  unsigned NumParallelJobs;
+
 private:
   /// Certain options suppress the 'no input files' warning.
   bool SuppressMissingInputWarning : 1;
@@ -0,0 +1,113 @@
+//===--- HeaderTokenCache.h - On-disk cache of header tokens ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+#define LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+
+namespace clang {
+
+class FileEntry;
+class Lexer;
+class PTHLexer;
+class Preprocessor;
+
+/// \brief A cache of the tokens of the headers, shared by the translation
+/// units of a batch through a directory.
+///
+/// The first translation unit which includes a header lexes it from the
+/// source and stores its raw tokens in the directory, in a file named after
+/// the hash of the contents of the header and of the language options which
+/// change how it is lexed.  The translation units which include the same
+/// contents afterwards memory map that file and read the tokens through a
+/// PTHLexer instead of lexing them again.
+///
+/// The raw tokens of a header include those of all its conditional blocks,
+/// like those of a PTH file, so they do not depend on the macros defined when
+/// the header is entered; the preprocessor still evaluates the conditionals
+/// and expands the macros.  The comments of a cached header are not passed to
+/// the comment handlers.  A header about which the lexer issues a diagnostic
+/// is not stored, as the translation units reading its tokens back would not
+/// issue it again.
+class HeaderTokenCache {
+public:
+  /// The current version of the format of the cache files.
+  enum { Version = 1 };
+
+private:
+  class CachedFile;
+
+  Preprocessor &PP;
+
+  /// The directory holding the cache files.
+  std::string Path;
+
+  /// The hash of the language options which affect the raw tokens.
+  size_t LangOptsHash;
+
+  /// The cached tokens of the headers entered so far, or null for the headers
+  /// which cannot be cached.
+  llvm::DenseMap<const FileEntry *, CachedFile *> Files;
+
+  /// A header lexed from the source, whose tokens are stored once the lexer
+  /// reaches its end without issuing a diagnostic.
+  struct PendingFile {
+    uint64_t Key;
+    std::string Name;
+    std::string Data;
+  };
+
+  /// The headers being lexed from the source which can be stored.
+  llvm::DenseMap<FileID, PendingFile> Pending;
+
+  unsigned NumHits, NumStores;
+
+  HeaderTokenCache(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+
+  /// \brief Lex the file \p FID from the source and return the contents of
+  /// its cache file, or an empty string if it cannot be cached.
+  std::string LexTokens(FileID FID, uint64_t Key);
+
+  /// \brief Write the cache file \p Name, replacing it atomically.
+  bool WriteCacheFile(StringRef Name, StringRef Data);
+
+public:
+  /// \param Path The directory holding the cache files, created on demand.
+  HeaderTokenCache(Preprocessor &PP, StringRef Path);
+  ~HeaderTokenCache();
+
+  /// \brief Return a PTHLexer reading the cached tokens of the header
+  /// \p FID, or null if the header must be lexed from the source.
+  ///
+  /// A header which is not in the cache yet is lexed from the source this
+  /// time, and stored by ExitSourceFile.  It is the responsibility of the
+  /// caller to 'delete' the returned object.
+  PTHLexer *CreateLexer(FileID FID);
+
+  /// \brief Called when the lexer \p L of a file reaches its end.  Store the
+  /// tokens of the file if it is a header not in the cache yet, and \p L
+  /// issued no diagnostic about it.
+  void ExitSourceFile(const Lexer &L);
+
+  void PrintStats() const;
+};
+
+}  // end namespace clang
+
+#endif
@@ -86,6 +86,10 @@ class Lexer : public PreprocessorLexer {
 
   bool HasLeadingEmptyMacro;
 
+  // HasIssuedDiagnostics - True if a diagnostic was issued about the contents
+  // of the buffer, whether or not the warning options let it through.
+  mutable bool HasIssuedDiagnostics;
+
   // CurrentConflictMarkerState - The kind of conflict marker we are handling.
   ConflictMarkerKind CurrentConflictMarkerState;
 
@@ -212,6 +216,10 @@ public:
   /// position in the current buffer into a SourceLocation object for rendering.
   DiagnosticBuilder Diag(const char *Loc, unsigned DiagID) const;
 
+  /// hasIssuedDiagnostics - Return true if the lexer has issued a diagnostic
+  /// about the contents of the buffer.
+  bool hasIssuedDiagnostics() const { return HasIssuedDiagnostics; }
+
   /// getSourceLocation - Return a source location identifier for the specified
   /// offset in the current file.
   SourceLocation getSourceLocation(const char *Loc, unsigned TokLen = 1) const;
@@ -18,9 +18,32 @@
 
 namespace clang {
 
+class IdentifierInfo;
 class PTHManager;
 class PTHSpellingSearch;
 
+/// PTHTokenSource - The storage of the identifiers and of the literal
+///  spellings referred to by the token data read by a PTHLexer, i.e. a PTH
+///  file or an entry of the header token cache.
+class PTHTokenSource {
+protected:
+  /// SpellingBase - The base address of the spellings of the literals.  The
+  ///  token data holds the offset of the spelling of each literal from it.
+  const unsigned char *const SpellingBase;
+
+  explicit PTHTokenSource(const unsigned char *SpellingBase)
+    : SpellingBase(SpellingBase) {}
+
+public:
+  virtual ~PTHTokenSource();
+
+  const unsigned char *getSpellingBase() const { return SpellingBase; }
+
+  /// GetIdentifierInfo - Return the IdentifierInfo for the persistent ID of
+  ///  an identifier in the token data.
+  virtual IdentifierInfo *GetIdentifierInfo(unsigned PersistentID) = 0;
+};
+
 class PTHLexer : public PreprocessorLexer {
   SourceLocation FileStartLoc;
 
@@ -44,6 +67,10 @@ class PTHLexer : public PreprocessorLexer {
   ///  to process when doing quick skipping of preprocessor blocks.
   const unsigned char* CurPPCondPtr;
 
+  /// PropagatedFlags - The start of line and leading space flags of an empty
+  ///  macro expansion, given to the next token.
+  unsigned char PropagatedFlags;
+
   PTHLexer(const PTHLexer &) LLVM_DELETED_FUNCTION;
   void operator=(const PTHLexer &) LLVM_DELETED_FUNCTION;
 
@@ -52,17 +79,18 @@ class PTHLexer : public PreprocessorLexer {
   
   bool LexEndOfFile(Token &Result);
 
-  /// PTHMgr - The PTHManager object that created this PTHLexer.
-  PTHManager& PTHMgr;
+  /// Source - The identifiers and the spellings of the token stream.
+  PTHTokenSource &Source;
 
   Token EofToken;
 
 protected:
   friend class PTHManager;
+  friend class HeaderTokenCache;
 
   /// Create a PTHLexer for the specified token stream.
   PTHLexer(Preprocessor& pp, FileID FID, const unsigned char *D,
-           const unsigned char* ppcond, PTHManager &PM);
+           const unsigned char* ppcond, PTHTokenSource &S);
 public:
 
   ~PTHLexer() {}
@@ -76,6 +104,17 @@ public:
   /// uninterpreted string.  This switches the lexer out of directive mode.
   void DiscardToEndOfLine();
 
+  /// ReadToEndOfLine - Read the rest of the current preprocessor line from
+  /// the source file as an uninterpreted string, and switch the lexer out of
+  /// directive mode.  Return false, after discarding the line, if the source
+  /// file is not available.
+  bool ReadToEndOfLine(SmallVectorImpl<char> &Result);
+
+  /// PropagateLineStartLeadingSpaceInfo - Give the next token the start of
+  ///  line and leading space flags of \p Result, a macro which expanded to
+  ///  nothing.
+  void PropagateLineStartLeadingSpaceInfo(Token &Result);
+
   /// isNextPPTokenLParen - Return 1 if the next unexpanded token will return a
   /// tok::l_paren token, 0 if it is something else and 2 if there are no more
   /// tokens controlled by this lexer.
@@ -34,7 +34,7 @@ class PTHLexer;
 class DiagnosticsEngine;
 class FileSystemStatCache;
 
-class PTHManager : public IdentifierInfoLookup {
+class PTHManager : public IdentifierInfoLookup, public PTHTokenSource {
   friend class PTHLexer;
 
   friend class PTHStatCache;
@@ -74,10 +74,6 @@ class PTHManager : public IdentifierInfoLookup {
   ///  PTHLexer objects.
   Preprocessor* PP;
 
-  /// SpellingBase - The base offset within the PTH memory buffer that
-  ///  contains the cached spellings for literals.
-  const unsigned char* const SpellingBase;
-
   /// OriginalSourceFile - A null-terminated C-string that specifies the name
   ///  if the file (if any) that was to used to generate the PTH cache.
   const char* OriginalSourceFile;
@@ -100,7 +96,7 @@ class PTHManager : public IdentifierInfoLookup {
 
   /// GetIdentifierInfo - Used to reconstruct IdentifierInfo objects from the
   ///  PTH file.
-  inline IdentifierInfo* GetIdentifierInfo(unsigned PersistentID) {
+  IdentifierInfo* GetIdentifierInfo(unsigned PersistentID) override {
     // Check if the IdentifierInfo has already been resolved.
     if (IdentifierInfo* II = PerIDCache[PersistentID])
       return II;
@@ -46,6 +46,7 @@ class ExternalPreprocessorSource;
 class FileManager;
 class FileEntry;
 class HeaderSearch;
+class HeaderTokenCache;
 class PragmaNamespace;
 class PragmaHandler;
 class CommentHandler;
@@ -111,6 +112,10 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   /// a token cache rather than lexing the original source file.
   std::unique_ptr<PTHManager> PTH;
 
+  /// An optional cache of the tokens of the headers, shared with the other
+  /// translation units of a batch.
+  std::unique_ptr<HeaderTokenCache> HeaderTokens;
+
   /// A BumpPtrAllocator object used to quickly allocate and release
   /// objects internal to the Preprocessor.
   llvm::BumpPtrAllocator BP;
@@ -514,6 +519,12 @@ public:
 
   PTHManager *getPTHManager() { return PTH.get(); }
 
+  /// \brief Read the tokens of the headers from \p Cache when possible,
+  /// rather than lexing them from the source.
+  void setHeaderTokenCache(std::unique_ptr<HeaderTokenCache> Cache);
+
+  HeaderTokenCache *getHeaderTokenCache() { return HeaderTokens.get(); }
+
   void setExternalSource(ExternalPreprocessorSource *Source) {
     ExternalSource = Source;
   }
@@ -117,6 +117,26 @@ enum IPAKind {
   IPAK_DynamicDispatchBifurcate = 5
 };
 
+/// \brief Describes the order in which the analyzer explores the work list.
+enum ExplorationStrategyKind {
+  ESK_NotSet = 0,
+
+  /// Explore the most recently generated node first.
+  ESK_DFS = 1,
+
+  /// Explore nodes in the order they are generated.
+  ESK_BFS = 2,
+
+  /// Explore basic blocks breadth-first and the nodes within a block
+  /// depth-first.
+  ESK_BFSBlockDFSContents = 3,
+
+  /// Explore nodes whose basic block can still reach a return statement of
+  /// the top level function that no path has reached yet first, and fall back
+  /// to depth-first search for the others.
+  ESK_UnexploredReturnsFirst = 4
+};
+
 class AnalyzerOptions : public RefCountedBase<AnalyzerOptions> {
 public:
   typedef llvm::StringMap<std::string> ConfigTable;
@@ -165,6 +185,12 @@ public:
   unsigned visualizeExplodedGraphWithUbiGraph : 1;
   unsigned UnoptimizedCFG : 1;
   unsigned PrintStats : 1;
+
+  /// \brief Time the callbacks of each checker.
+  unsigned CheckerTimers : 1;
+
+  /// \brief The file the checker timers are written to, if not empty.
+  std::string CheckerTimersOutput;
   
   /// \brief Do not re-analyze paths leading to exhausted nodes with a different
   /// strategy. We get better code coverage when retry is enabled.
@@ -194,6 +220,9 @@ private:
   /// Controls the mode of inter-procedural analysis.
   IPAKind IPAMode;
 
+  /// Controls the order in which the work list is explored.
+  ExplorationStrategyKind ExplorationStrategy;
+
   /// Controls which C++ member functions will be considered for inlining.
   CXXInlineableMemberKind CXXMemberInliningMode;
   
@@ -252,6 +281,15 @@ private:
   /// \sa getMaxNodesPerTopLevelFunction
   Optional<unsigned> MaxNodesPerTopLevelFunction;
 
+  /// \sa getMaxMemoryMB
+  Optional<unsigned> MaxMemoryMB;
+
+  /// \sa getNumAnalysisJobs
+  Optional<unsigned> NumAnalysisJobs;
+
+  /// \sa getMaxPathDiagnostics
+  Optional<unsigned> MaxPathDiagnostics;
+
 public:
   /// Interprets an option's string value as a boolean.
   ///
@@ -265,6 +303,11 @@ public:
   /// Interprets an option's string value as an integer value.
   int getOptionAsInteger(StringRef Name, int DefaultVal);
 
+  /// Query an option's string value.
+  ///
+  /// If an option value is not provided, returns the given \p DefaultVal.
+  StringRef getOptionAsString(StringRef Name, StringRef DefaultVal);
+
   /// \brief Retrieves and sets the UserMode. This is a high-level option,
   /// which is used to set other low-level options. It is not accessible
   /// outside of AnalyzerOptions.
@@ -273,6 +316,13 @@ public:
   /// \brief Returns the inter-procedural analysis mode.
   IPAKind getIPAMode();
 
+  /// \brief Returns the order in which the work list is explored.
+  ///
+  /// This is controlled by the 'exploration_strategy' config option, which
+  /// accepts the values "dfs", "bfs", "bfs_block_dfs_contents" and
+  /// "unexplored_returns_first". Default = "dfs"
+  ExplorationStrategyKind getExplorationStrategy();
+
   /// Returns the option controlling which C++ member functions will be
   /// considered for inlining.
   ///
@@ -421,6 +471,47 @@ public:
   /// This is controlled by the 'max-nodes' config option.
   unsigned getMaxNodesPerTopLevelFunction();
 
+  /// Returns the maximum number of megabytes the exploded graph of a top
+  /// level function, its states and its stores may take. Past three quarters
+  /// of it, the uninteresting nodes are reclaimed after every statement
+  /// rather than every 'graph-trim-interval' statements; once it is reached,
+  /// the analyzer stops exploring the function as it does at 'max-nodes'.
+  /// 0 is default and means no limit.
+  ///
+  /// This is controlled by the 'max-memory-mb' config option.
+  unsigned getMaxMemoryMB();
+
+  /// Returns the number of worker processes used to explore the top level
+  /// functions of a translation unit. 1 is default and analyzes them serially.
+  ///
+  /// The diagnostics are emitted in the order of a serial run, but each worker
+  /// starts every top level function with empty function summaries. With
+  /// more than one job, the limits which a serial run carries over from one
+  /// top level function to the next, 'max-times-inline-large' and the
+  /// callees known to exceed 'max-blocks', apply to each top level function
+  /// separately. The inlining decisions, and the output, then differ from a
+  /// serial run on the functions which reach these limits.
+  ///
+  /// This is controlled by the 'jobs' config option.
+  unsigned getNumAnalysisJobs();
+
+  /// Returns whether the top level functions are analyzed bottom-up, callees
+  /// before their callers, so that the PathCondExtractor checker can apply
+  /// the return path summaries of the callees at their call sites instead of
+  /// inlining them.
+  ///
+  /// This is controlled by the 'pathcond-summaries' config option, which
+  /// accepts the values "true" and "false". Default = false
+  bool shouldUsePathCondSummaries();
+
+  /// Returns the maximum number of bug report equivalence classes per
+  /// exploded graph for which a path is generated. The others are reported
+  /// with their message only, without running the BugReporterVisitors, which
+  /// may therefore no longer suppress them. 0 is default and means no limit.
+  ///
+  /// This is controlled by the 'max-path-diagnostics' config option.
+  unsigned getMaxPathDiagnostics();
+
 public:
   AnalyzerOptions() :
     AnalysisStoreOpt(RegionStoreModel),
@@ -438,6 +529,7 @@ public:
     visualizeExplodedGraphWithUbiGraph(0),
     UnoptimizedCFG(0),
     PrintStats(0),
+    CheckerTimers(0),
     NoRetryExhausted(0),
     // Cap the stack depth at 4 calls (5 stack frames, base + 4 calls).
     InlineMaxStackDepth(5),
@@ -445,6 +537,7 @@ public:
                                 // FSS: All: generate results of inlined functions
     UserMode(UMK_NotSet),
     IPAMode(IPAK_NotSet),
+    ExplorationStrategy(ESK_NotSet),
     CXXMemberInliningMode() {}
 
 };
@@ -397,14 +397,16 @@ private:
   const Kind kind;
   BugReporterData& D;
 
-  /// Generate and flush the diagnostics for the given bug report.
-  void FlushReport(BugReportEquivClass& EQ);
+  /// Generate and flush the diagnostics for the given bug report. Returns
+  /// true if a path has been generated for it.
+  bool FlushReport(BugReportEquivClass& EQ, bool WithPath);
 
   /// Generate and flush the diagnostics for the given bug report
   /// and PathDiagnosticConsumer.
   void FlushReport(BugReport *exampleReport,
                    PathDiagnosticConsumer &PD,
-                   ArrayRef<BugReport*> BugReports);
+                   ArrayRef<BugReport*> BugReports,
+                   bool WithPath);
 
   /// The set of bug reports tracked by the BugReporter.
   llvm::FoldingSet<BugReportEquivClass> EQClasses;
@@ -34,14 +34,16 @@ private:
   const std::string Name;
   const std::string Category;
   bool SuppressonSink;
+  bool MessageOnly;
 
   virtual void anchor();
 public:
   BugType(class CheckName check, StringRef name, StringRef cat)
-      : Check(check), Name(name), Category(cat), SuppressonSink(false) {}
+      : Check(check), Name(name), Category(cat), SuppressonSink(false),
+        MessageOnly(false) {}
   BugType(const CheckerBase *checker, StringRef name, StringRef cat)
       : Check(checker->getCheckName()), Name(name), Category(cat),
-        SuppressonSink(false) {}
+        SuppressonSink(false), MessageOnly(false) {}
   virtual ~BugType() {}
 
   // FIXME: Should these be made strings as well?
@@ -55,6 +57,12 @@ public:
   bool isSuppressOnSink() const { return SuppressonSink; }
   void setSuppressOnSink(bool x) { SuppressonSink = x; }
 
+  /// isMessageOnly - Returns true if only the message of the bug reports
+  ///  associated with this bug type is of interest. No path is generated for
+  ///  them, so the BugReporterVisitors do not run and cannot suppress them.
+  bool isMessageOnly() const { return MessageOnly; }
+  void setMessageOnly(bool x) { MessageOnly = x; }
+
   virtual void FlushReports(BugReporter& BR);
 };
 
@@ -120,6 +120,52 @@ public:
   }
 };
 
+/// \brief Like PreStmt<STMT>, but only for the statements \p FILTER accepts,
+/// e.g. PreStmtIf<BinaryOperator, isAssignment>.
+///
+/// \p FILTER may only look at the class and the opcode of the statement: the
+/// checker manager runs it once per class and opcode and keeps the result, so
+/// the checker is not called at all for the statements it rejects.
+template <typename STMT, bool (*FILTER)(const STMT *)>
+class PreStmtIf {
+  template <typename CHECKER>
+  static void _checkStmt(void *checker, const Stmt *S, CheckerContext &C) {
+    ((const CHECKER *)checker)->checkPreStmt(cast<STMT>(S), C);
+  }
+
+  static bool _handlesStmt(const Stmt *S) {
+    return isa<STMT>(S) && FILTER(cast<STMT>(S));
+  }
+public:
+  template <typename CHECKER>
+  static void _register(CHECKER *checker, CheckerManager &mgr) {
+    mgr._registerForPreStmt(CheckerManager::CheckStmtFunc(checker,
+                                                          _checkStmt<CHECKER>),
+                            _handlesStmt);
+  }
+};
+
+/// \brief Like PostStmt<STMT>, but only for the statements \p FILTER
+/// accepts. See PreStmtIf.
+template <typename STMT, bool (*FILTER)(const STMT *)>
+class PostStmtIf {
+  template <typename CHECKER>
+  static void _checkStmt(void *checker, const Stmt *S, CheckerContext &C) {
+    ((const CHECKER *)checker)->checkPostStmt(cast<STMT>(S), C);
+  }
+
+  static bool _handlesStmt(const Stmt *S) {
+    return isa<STMT>(S) && FILTER(cast<STMT>(S));
+  }
+public:
+  template <typename CHECKER>
+  static void _register(CHECKER *checker, CheckerManager &mgr) {
+    mgr._registerForPostStmt(CheckerManager::CheckStmtFunc(checker,
+                                                           _checkStmt<CHECKER>),
+                             _handlesStmt);
+  }
+};
+
 class PreObjCMessage {
   template <typename CHECKER>
   static void _checkObjCMessage(void *checker, const ObjCMethodCall &msg,
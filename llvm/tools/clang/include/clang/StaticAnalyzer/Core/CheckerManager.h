@@ -20,6 +20,8 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/Store.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Timer.h"
+#include <memory>
 #include <vector>
 
 namespace clang {
@@ -156,7 +158,9 @@ public:
   CheckerManager(const LangOptions &langOpts,
                  AnalyzerOptionsRef AOptions)
     : LangOpts(langOpts),
-      AOptions(AOptions) {}
+      AOptions(AOptions),
+      Timers(AOptions->CheckerTimers ?
+               new llvm::TimerGroup("Checker Callbacks") : nullptr) {}
 
   ~CheckerManager();
 
@@ -174,6 +178,80 @@ public:
   typedef const void *CheckerTag;
   typedef CheckerFn<void ()> CheckerDtor;
 
+//===----------------------------------------------------------------------===//
+// Checker timers.
+//===----------------------------------------------------------------------===//
+
+  /// The kinds of callbacks the checker timers ('-analyzer-checker-timers')
+  /// tell apart.
+  enum CallbackKind {
+    CK_ASTDecl,
+    CK_ASTBody,
+    CK_PreStmt,
+    CK_PostStmt,
+    CK_PreObjCMessage,
+    CK_PostObjCMessage,
+    CK_PreCall,
+    CK_PostCall,
+    CK_Location,
+    CK_Bind,
+    CK_EndAnalysis,
+    CK_EndFunction,
+    CK_BranchCondition,
+    CK_LiveSymbols,
+    CK_DeadSymbols,
+    CK_RegionChanges,
+    CK_PointerEscape,
+    CK_EvalAssume,
+    CK_EvalCall,
+    CK_EndOfTranslationUnit
+  };
+
+  static StringRef getCallbackKindName(CallbackKind K);
+
+  /// \brief The number of calls of, and the time spent in, the callbacks of
+  /// one kind of one checker.
+  class CheckerTimer {
+    StringRef CheckerName;
+    CallbackKind Kind;
+    llvm::Timer T;
+    unsigned NumCalls;
+    /// The number of running callbacks. A callback may cause the checkers to
+    /// run again, for instance for the region changes of a state it creates.
+    unsigned Depth;
+
+  public:
+    CheckerTimer(StringRef CheckerName, CallbackKind Kind,
+                 llvm::TimerGroup &TG)
+      : CheckerName(CheckerName), Kind(Kind),
+        T((CheckerName + " " + getCallbackKindName(Kind)).str(), TG),
+        NumCalls(0), Depth(0) {}
+
+    void start(unsigned Calls) {
+      NumCalls += Calls;
+      if (Depth++ == 0)
+        T.startTimer();
+    }
+    void stop() {
+      if (--Depth == 0)
+        T.stopTimer();
+    }
+
+    StringRef getCheckerName() const { return CheckerName; }
+    CallbackKind getKind() const { return Kind; }
+    unsigned getNumCalls() const { return NumCalls; }
+    llvm::TimeRecord getTotalTime() const { return T.getTotalTime(); }
+  };
+
+  /// Returns the timer of the \p K callbacks of \p Checker, or null if the
+  /// checker timers are disabled.
+  CheckerTimer *getCheckerTimer(const CheckerBase *Checker, CallbackKind K);
+
+  /// Prints the checker timers, and writes them as comma separated values to
+  /// the '-analyzer-checker-timers-output' file if there is one. \p Total is
+  /// the time taken by the whole analysis, including the checkers.
+  void printCheckerTimers(const llvm::TimeRecord &Total);
+
 //===----------------------------------------------------------------------===//
 // registerChecker
 //===----------------------------------------------------------------------===//
@@ -502,6 +580,9 @@ public:
                           AnalysisManager&, BugReporter &)>
       CheckEndOfTranslationUnit;
 
+  /// Returns whether a statement checker runs for a statement. The result
+  /// may only depend on the class and the opcode of the statement, which it is
+  /// cached by (see getCachedStmtCheckersFor).
   typedef bool (*HandlesStmtFunc)(const Stmt *D);
   void _registerForPreStmt(CheckStmtFunc checkfn,
                            HandlesStmtFunc isForStmtFn);
@@ -605,6 +686,8 @@ private:
   std::vector<StmtCheckerInfo> StmtCheckers;
 
   typedef SmallVector<CheckStmtFunc, 4> CachedStmtCheckers;
+  /// The statement checkers to run, by statement class, opcode and visit
+  /// kind, so that the filtered checkers are skipped without a call.
   typedef llvm::DenseMap<unsigned, CachedStmtCheckers> CachedStmtCheckersMapTy;
   CachedStmtCheckersMapTy CachedStmtCheckersMap;
 
@@ -653,6 +736,15 @@ private:
   
   typedef llvm::DenseMap<EventTag, EventInfo> EventsTy;
   EventsTy Events;
+
+  /// The group of the checker timers, if they are enabled. It must outlive
+  /// the timers.
+  std::unique_ptr<llvm::TimerGroup> Timers;
+  /// The checker timers, in the order of their first use.
+  std::vector<std::unique_ptr<CheckerTimer> > CheckerTimers;
+  typedef llvm::DenseMap<std::pair<const CheckerBase *, unsigned>,
+                         CheckerTimer *> CheckerTimerMapTy;
+  CheckerTimerMapTy CheckerTimerMap;
 };
 
 } // end ento namespace
@@ -0,0 +1,40 @@
+//== FunctionDigest.h - Stable digests of function definitions --*- C++ -*--==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file declares a digest of a function definition which is stable
+//  across analyzer runs, used to key the results cached on disk.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_STATICANALYZER_CORE_FUNCTIONDIGEST_H
+#define LLVM_CLANG_STATICANALYZER_CORE_FUNCTIONDIGEST_H
+
+#include "clang/Basic/LLVM.h"
+#include <string>
+
+namespace clang {
+
+class FunctionDecl;
+
+namespace ento {
+
+/// \brief Returns the MD5 digest, as 32 hex digits, of the location, the
+/// type, the source text and the printed body of the definition \p FD.
+///
+/// Unlike Stmt::Profile, the digest does not depend on the addresses of the
+/// declarations the body refers to, so it can be compared across runs. The
+/// printed body reflects the macros expanded in the body, and the location
+/// and the source text the positions of its statements, which the analysis
+/// results print.
+std::string getFunctionDigest(const FunctionDecl *FD);
+
+} // end namespace ento
+} // end namespace clang
+
+#endif
@@ -0,0 +1,123 @@
+//== PathCondStream.h - Binary path condition records -----------*- C++ -*--==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the binary record stream written by PathCondExtractor,
+//  and a reader which converts it back to the textual @@<< ... @@>> form.
+//
+//  A stream is a sequence of function blocks, so that streams written by
+//  several analyzer processes can simply be concatenated. Every record is a
+//  one byte kind, a 32-bit little-endian payload length and the payload:
+//
+//    RK_BeginFunction  "PCND", a 32-bit format version and the function name.
+//    RK_Signature      A return signature ("<loc>\n@FUNCTION: ..\n@RETURN: ..").
+//                      Signatures are numbered from zero within a function.
+//    RK_Fragment       A @CONDITION or @LOG_* line. Paths to a return share
+//                      most of their lines, so every distinct line is written
+//                      once; fragments are numbered from zero within a
+//                      function.
+//    RK_Path           A 32-bit signature number followed by the 32-bit
+//                      numbers of the fragments of one path reaching that
+//                      signature, in order.
+//    RK_EndFunction    No payload.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_STATICANALYZER_CORE_PATHCONDSTREAM_H
+#define LLVM_CLANG_STATICANALYZER_CORE_PATHCONDSTREAM_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace clang {
+namespace ento {
+
+namespace pathcond {
+
+enum RecordKind {
+  RK_BeginFunction = 1,
+  RK_Signature,
+  RK_Fragment,
+  RK_Path,
+  RK_EndFunction
+};
+
+/// The version written into every RK_BeginFunction record.
+const unsigned StreamVersion = 2;
+
+/// A single record of a path condition stream. The text points into the
+/// buffer handed to the reader.
+struct Record {
+  RecordKind Kind;
+  /// The signature number of an RK_Path record.
+  unsigned SigID;
+  /// The function name, signature or fragment text, or the packed fragment
+  /// numbers of an RK_Path record.
+  StringRef Text;
+
+  /// The number of fragments of an RK_Path record.
+  unsigned getNumFragments() const { return Text.size() / sizeof(uint32_t); }
+
+  /// The \p I-th fragment number of an RK_Path record.
+  unsigned getFragment(unsigned I) const;
+};
+
+} // end namespace pathcond
+
+/// \brief Writes path condition records to a raw_ostream.
+class PathCondStreamWriter {
+  raw_ostream &OS;
+
+  void writeHeader(pathcond::RecordKind K, unsigned Length);
+
+public:
+  explicit PathCondStreamWriter(raw_ostream &os) : OS(os) {}
+
+  void writeBeginFunction(StringRef FuncName);
+  void writeSignature(StringRef Sig);
+  void writeFragment(StringRef Fragment);
+  void writePath(unsigned SigID, ArrayRef<unsigned> Fragments);
+  void writeEndFunction();
+};
+
+/// \brief Iterates over the records of a path condition stream in place.
+///
+/// The reader does not copy the buffer, so a memory mapped file can be read
+/// without loading the whole stream.
+class PathCondStreamReader {
+  const char *Cur;
+  const char *End;
+  std::string Error;
+
+public:
+  explicit PathCondStreamReader(StringRef Buffer)
+    : Cur(Buffer.begin()), End(Buffer.end()) {}
+
+  /// Reads the next record into \p R. Returns false at the end of the
+  /// stream, or if the stream is malformed, in which case hasError() is set.
+  bool next(pathcond::Record &R);
+
+  bool hasError() const { return !Error.empty(); }
+  StringRef getError() const { return Error; }
+};
+
+/// \brief Prints the records of \p Buffer in the textual form the checker
+/// prints when no stream is requested: one "###: @@<< ... @@>>" block per
+/// return signature of a function.
+///
+/// \returns false and sets \p Error if the stream is malformed.
+bool convertPathCondStreamToText(StringRef Buffer, raw_ostream &OS,
+                                 std::string &Error);
+
+} // end namespace ento
+} // end namespace clang
+
+#endif
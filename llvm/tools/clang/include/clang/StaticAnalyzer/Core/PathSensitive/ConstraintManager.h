@@ -111,6 +111,19 @@ public:
     return nullptr;
   }
 
+  /// An inclusive range of values.
+  typedef std::pair<llvm::APSInt, llvm::APSInt> ValueRange;
+
+  /// \brief Collects the disjoint ranges of values \p Sym is constrained to,
+  /// in ascending order.
+  ///
+  /// Returns false if \p Sym is unconstrained, or the constraint manager
+  /// does not track ranges.
+  virtual bool getSymbolRanges(ProgramStateRef St, SymbolRef Sym,
+                               SmallVectorImpl<ValueRange> &Ranges) {
+    return false;
+  }
+
   virtual ProgramStateRef removeDeadBindings(ProgramStateRef state,
                                                  SymbolReaper& SymReaper) = 0;
 
@@ -123,6 +136,21 @@ public:
                      ProgramStateRef St, 
                      raw_ostream &Out) = 0;
 
+  /// A constrained symbol together with an opaque identity of its
+  /// constraint. Two states constraining a symbol with the same key print
+  /// the same constraint for it.
+  typedef std::pair<SymbolRef, const void *> ConstraintKey;
+
+  /// Collects the keys of the constraints of \p St, in the order
+  /// print(CheckerContext &, ...) prints them.
+  virtual void getConstraintKeys(ProgramStateRef St,
+                                 SmallVectorImpl<ConstraintKey> &Keys) = 0;
+
+  /// Prints the "@CONDITION" line print(CheckerContext &, ...) prints for
+  /// \p Sym.
+  virtual void printConstraint(ProgramStateRef St, SymbolRef Sym,
+                               raw_ostream &Out) = 0;
+
   virtual void EndPath(ProgramStateRef state) {}
   
   /// Convenience method to query the state to see if a symbol is null or
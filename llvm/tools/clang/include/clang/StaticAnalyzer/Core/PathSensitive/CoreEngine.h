@@ -25,6 +25,7 @@
 
 namespace clang {
 
+class AnalyzerOptions;
 class ProgramPointTag;
   
 namespace ento {
@@ -84,6 +85,18 @@ private:
   /// (This data is owned by AnalysisConsumer.)
   FunctionSummariesTy *FunctionSummaries;
 
+  /// The number of bytes the graph may take before the exploration stops, or
+  /// 0 if there is no limit (see AnalyzerOptions::getMaxMemoryMB).
+  uint64_t MaxMemory;
+
+  /// Whether the nodes are reclaimed after every statement because the
+  /// graph is close to MaxMemory.
+  bool ReclaimingEagerly;
+
+  /// Returns true if the graph has reached MaxMemory. Switches to eager node
+  /// reclamation when it is close to it.
+  bool isOverMemoryBudget();
+
   void generateNode(const ProgramPoint &Loc,
                     ProgramStateRef State,
                     ExplodedNode *Pred);
@@ -110,9 +123,8 @@ private:
 
 public:
   /// Construct a CoreEngine object to analyze the provided CFG.
-  CoreEngine(SubEngine &subengine, FunctionSummariesTy *FS)
-      : SubEng(subengine), WList(WorkList::makeDFS()),
-        BCounterFactory(G.getAllocator()), FunctionSummaries(FS) {}
+  CoreEngine(SubEngine &subengine, FunctionSummariesTy *FS,
+             AnalyzerOptions &Opts);
 
   /// getGraph - Returns the exploded graph.
   ExplodedGraph &getGraph() { return G; }
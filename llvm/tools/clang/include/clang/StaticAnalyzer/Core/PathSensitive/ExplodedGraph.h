@@ -87,6 +87,10 @@ class ExplodedNode : public llvm::FoldingSetNode {
 
     unsigned size() const;
 
+    /// Returns the bytes allocated for the nodes of the group, which are
+    /// stored inline unless there are several of them.
+    size_t getMemoryUsage() const;
+
     bool empty() const { return P == 0 || getFlag() != 0; }
 
     /// Adds a node to the list.
@@ -249,6 +253,7 @@ typedef llvm::DenseMap<const ExplodedNode *, const ExplodedNode *>
 class ExplodedGraph {
 protected:
   friend class CoreEngine;
+  friend class ExplodedNode;
 
   // Type definitions.
   typedef std::vector<ExplodedNode *> NodeVector;
@@ -272,6 +277,10 @@ protected:
 
   /// NumNodes - The number of nodes in the graph.
   unsigned NumNodes;
+
+  /// The number of predecessors added to nodes which already had one, i.e.
+  /// the number of times paths merged.
+  unsigned NumMerges;
   
   /// A list of recently allocated nodes that can potentially be recycled.
   NodeVector ChangedNodes;
@@ -323,6 +332,9 @@ public:
   bool empty() const { return NumNodes == 0; }
   unsigned size() const { return NumNodes; }
 
+  /// Returns the number of times paths merged into an existing node.
+  unsigned getNumMerges() const { return NumMerges; }
+
   // Iterators.
   typedef ExplodedNode                        NodeTy;
   typedef llvm::FoldingSet<ExplodedNode>      AllNodesTy;
@@ -383,10 +395,17 @@ public:
     ReclaimCounter = ReclaimNodeInterval = Interval;
   }
 
+  /// Returns true if nodes are reclaimed at all.
+  bool isReclaimingNodes() const { return ReclaimNodeInterval != 0; }
+
   /// Reclaim "uninteresting" nodes created since the last time this method
   /// was called.
   void reclaimRecentlyAllocatedNodes();
 
+  /// Returns the bytes allocated for the nodes of the graph and their
+  /// predecessor and successor lists, including the reclaimed nodes.
+  uint64_t getNodeMemoryUsage() const;
+
   /// \brief Returns true if nodes for the given expression kind are always
   ///        kept around.
   static bool isInterestingLValueExpr(const Expr *Ex);
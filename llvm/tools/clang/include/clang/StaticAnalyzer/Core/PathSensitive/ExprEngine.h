@@ -543,6 +543,10 @@ public:
   void defaultEvalCall(NodeBuilder &B, ExplodedNode *Pred,
                        const CallEvent &Call);
 private:
+  /// Updates the statistics on the memory taken by the graph, the states and
+  /// the stores of the function which has just been analyzed.
+  void updateMemoryStatistics();
+
   void evalLoadCommon(ExplodedNodeSet &Dst,
                       const Expr *NodeEx,  /* Eventually will be a CFGStmt */
                       const Expr *BoundEx,
@@ -25,12 +25,40 @@
 #include "clang/AST/PrettyPrinter.h"
 #include "clang/AST/StmtVisitor.h"
 #include "clang/Basic/CharInfo.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Format.h"
 
 namespace clang {
 namespace ento {
 
+/// \brief Memoizes the text FssStmtPrinter renders for symbols and regions.
+///
+/// Symbols and regions are uniqued and immutable, and their text depends
+/// only on whether they are printed at the outermost level, so it can be
+/// shared by every path of a top level function. Rendering a symbol still
+/// visits the statement it was conjured for, so this saves re-printing the
+/// same expressions for every return path. The text is kept in a bump
+/// allocator owned by the cache. One cache lives in each ProgramStateManager.
+class FssRenderCache {
+  llvm::BumpPtrAllocator Alloc;
+
+  /// How an entry was rendered.
+  enum EntryKind { EK_TopLevelSymbol, EK_NestedSymbol, EK_Region };
+  typedef std::pair<const void *, unsigned> KeyTy;
+  llvm::DenseMap<KeyTy, StringRef> Cache;
+
+  StringRef save(StringRef Text);
+
+public:
+  /// Prints \p Sym like Sym->dumpToStream(OS, Level).
+  void print(raw_ostream &OS, const SymExpr *Sym, int Level);
+
+  /// Prints \p V like V.dumpToStream(OS, Level).
+  void print(raw_ostream &OS, SVal V, int Level);
+};
+
 class FssStmtPrinter : public StmtVisitor<FssStmtPrinter> {
   raw_ostream &OS;
   const LocationContext *LCtx;
@@ -23,6 +23,8 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/Store.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/TaintTag.h"
 #include "clang/AST/OperationKinds.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/ImmutableMap.h"
 #include "llvm/ADT/PointerIntPair.h"
@@ -40,6 +42,9 @@ namespace ento {
 class CallEvent;
 class CallEventManager;
 class CheckerContext;
+class ExplodedGraph;
+class ExplodedNode;
+class FssRenderCache;
 
 typedef std::unique_ptr<ConstraintManager>(*ConstraintManagerCreator)(
     ProgramStateManager &, SubEngine *);
@@ -64,15 +69,47 @@ template <typename T> struct ProgramStateTrait {
 //===----------------------------------------------------------------------===//
 // Historical Event
 //===----------------------------------------------------------------------===//
-class HistoricalEvent {
+
+/// \class HistoricalEvent
+/// An assignment or a call recorded on a path.
+///
+/// Events are not part of the program state. Each event is recorded at an
+/// ExplodedNode of its own, and the events of a path are those recorded at
+/// the nodes leading to it. Events are uniqued and allocated by the
+/// HistoricalEventManager.
+class HistoricalEvent : public llvm::FoldingSetNode {
 public:
   enum Kind { BO_ASSIGN, UO_ASSIGN, FN_CALL, UNKNOWN };
   Kind K;
   const Stmt *S;
   const LocationContext *LCtx;
 
-  HistoricalEvent(Kind k, const Stmt *s, const LocationContext *lctx)
-    : K(k), S(s), LCtx(lctx) {}
+private:
+  friend class HistoricalEventManager;
+
+  /// The state the event was recorded in. Retained by the event.
+  const ProgramState *State;
+
+  HistoricalEvent(Kind k, const Stmt *s, const LocationContext *lctx,
+                  const ProgramState *state)
+    : K(k), S(s), LCtx(lctx), State(state) {}
+
+public:
+  /// The state the event was recorded in. Values of the event's statement
+  /// are rendered against it.
+  const ProgramState *getState() const { return State; }
+
+  static void Profile(llvm::FoldingSetNodeID &ID, Kind k, const Stmt *s,
+                      const LocationContext *lctx, const ProgramState *state) {
+    ID.AddInteger(k);
+    ID.AddPointer(s);
+    ID.AddPointer(lctx);
+    ID.AddPointer(state);
+  }
+
+  void Profile(llvm::FoldingSetNodeID &ID) const {
+    Profile(ID, K, S, LCtx, State);
+  }
 
   static Kind getKind(const Stmt *s) {
     if ( const BinaryOperator *BO = dyn_cast<BinaryOperator>(s) ) {
@@ -111,6 +148,64 @@ public:
   }
 };
 
+/// \class HistoricalEventManager
+/// Uniques the HistoricalEvents of the states of a ProgramStateManager, and
+/// keeps the event recorded at each event node. Recording an event leaves
+/// the state alone, so that states differing only in the events which led
+/// to them fold, and the history of a path is recovered from the graph.
+class HistoricalEventManager {
+  llvm::BumpPtrAllocator Alloc;
+  llvm::FoldingSet<HistoricalEvent> Events;
+
+  /// The events recorded at nodes. Event nodes are tagged, so ExplodedGraph
+  /// never reclaims them.
+  llvm::DenseMap<const ExplodedNode *, const HistoricalEvent *> NodeEvents;
+
+  /// The graph the event nodes belong to.
+  const ExplodedGraph *Graph;
+
+  typedef llvm::DenseMap<const ExplodedNode *,
+                         SmallVector<const ExplodedNode *, 1> > PrevEventMap;
+
+  /// The nearest event nodes on the paths leading to each event node,
+  /// computed on demand. Together they form the DAG of the events of the
+  /// graph, which stays valid until paths merge.
+  mutable PrevEventMap PrevEventNodes;
+
+  /// The number of merges of Graph when PrevEventNodes was last valid.
+  mutable unsigned NumMergesSeen;
+
+  /// Adds the nearest event nodes on the paths leading to \p N to \p Nodes.
+  void collectPrevEventNodes(const ExplodedNode *N,
+                             SmallVectorImpl<const ExplodedNode *> &Nodes)
+    const;
+
+  const SmallVectorImpl<const ExplodedNode *> &
+  getPrevEventNodes(const ExplodedNode *N) const;
+
+public:
+  HistoricalEventManager() : Graph(nullptr), NumMergesSeen(0) {}
+
+  void setGraph(const ExplodedGraph *G) { Graph = G; }
+
+  /// Returns the event recording \p s in \p state.
+  const HistoricalEvent *getEvent(HistoricalEvent::Kind k, const Stmt *s,
+                                  const LocationContext *lctx,
+                                  const ProgramState *state);
+
+  /// Records \p E at the node \p N.
+  void recordAtNode(const ExplodedNode *N, const HistoricalEvent *E) {
+    NodeEvents[N] = E;
+  }
+
+  /// Collects the events recorded on the paths to \p N, each after the
+  /// events recorded before it. Where paths merged, the events of all the
+  /// merged paths are collected, those of the first predecessor first.
+  void getHistoricalEvents(const ExplodedNode *N,
+                           SmallVectorImpl<const HistoricalEvent *> &Events)
+    const;
+};
+
 
 /// \class ProgramState
 /// ProgramState - This class encapsulates:
@@ -142,10 +237,6 @@ private:
   GenericDataMap   GDM;      // Custom data stored by a client of this class.
   unsigned refCount;
 
-  const ProgramState *PrevState;    // Reference to the previous state
-  bool IsTransient;                 // Am I transient or persistent?
-  HistoricalEvent *HxEv;            // Event
-
   /// makeWithStore - Return a ProgramState with the same values as the current
   ///  state with the exception of using the specified Store.
   ProgramStateRef makeWithStore(const StoreRef &store) const;
@@ -155,12 +246,11 @@ private:
 public:
   /// This ctor is used when creating the first ProgramState object.
   ProgramState(ProgramStateManager *mgr, const Environment& env,
-               StoreRef st, GenericDataMap gdm, bool isTransient,
-               HistoricalEvent *hxev);
+               StoreRef st, GenericDataMap gdm);
     
   /// Copy ctor - We must explicitly define this or else the "Next" ptr
   ///  in FoldingSetNode will also get copied.
-  ProgramState(const ProgramState &RHS, bool isTransient = true);
+  ProgramState(const ProgramState &RHS);
   
   ~ProgramState();
 
@@ -188,12 +278,11 @@ public:
 
   /// Profile - Profile the contents of a ProgramState object for use in a
   ///  FoldingSet.  Two ProgramState objects are considered equal if they
-  ///  have the same Environment, Store, GenericDataMap, and HxEv.
+  ///  have the same Environment, Store, and GenericDataMap.
   static void Profile(llvm::FoldingSetNodeID& ID, const ProgramState *V) {
     V->Env.Profile(ID);
     ID.AddPointer(V->store);
     V->GDM.Profile(ID);
-    ID.AddPointer(V->HxEv);
   }
 
   /// Profile - Used to profile the contents of this object for inclusion
@@ -496,152 +585,6 @@ private:
                         InvalidatedSymbols *IS,
                         RegionAndSymbolInvalidationTraits *HTraits,
                         const CallEvent *Call) const;
-
-  //==---------------------------------------------------------------------==//
-  // Iterator
-  //==---------------------------------------------------------------------==//
-private:
-  typedef llvm::SmallVector<ProgramStateRef, 128> HxVectorTy;
-  mutable HxVectorTy History;
-
-public:
-  const HistoricalEvent * getHistoricalEvent() const {
-    return HxEv;
-  }
-
-  template<typename CnTy, typename ItTy, typename DrIt>
-  class Iterator {
-  protected:
-    // Ordered from present to past
-    CnTy &History;
-    ItTy Iter;
-  public:
-    Iterator(CnTy &history, const ProgramState *state, bool begin)
-      : History(history) {
-      initHistory(state);
-      if (begin)
-        Iter = static_cast<DrIt*>(this)->begin();
-      else
-        Iter = static_cast<DrIt*>(this)->end(); 
-    }
-
-    Iterator& operator++() { ++Iter; return *this; }
-    Iterator& operator--() { --Iter; return *this; }
-    bool operator==(const Iterator& rhs) { return Iter == rhs.Iter; }
-    bool operator!=(const Iterator& rhs) { return Iter != rhs.Iter; }
-    ProgramStateRef operator*() { return *Iter; }
-  private:
-    void initHistory(const ProgramState *state) {
-      if (!History.empty()) return; 
-      while (state != nullptr) {
-        if (static_cast<DrIt*>(this)->test(state))
-          History.push_back(state);
-        state = state->PrevState;
-      }
-    }
-  };
-
-  //-------------------------------------------------------------------------//
-  // Filtering condition
-  //-------------------------------------------------------------------------//
-  class AllIterator {
-  public:
-    bool test(const ProgramState *state) { return true; }
-  };
-
-  class HistoricalEventIterator {
-  public:
-    bool test(const ProgramState *state) { return state->HxEv != nullptr; }
-  };
-
-  //-------------------------------------------------------------------------//
-  // Iteration direction
-  //-------------------------------------------------------------------------//
-  template<typename CnTy, typename ItTy, typename TstIt>
-  class ForwardIterator 
-    : public Iterator<CnTy, ItTy, ForwardIterator<CnTy,ItTy,TstIt> >,
-      public TstIt {
-    typedef  Iterator<CnTy, ItTy, ForwardIterator<CnTy,ItTy,TstIt> > SuperTy;
-  public:
-    ForwardIterator(CnTy &history, const ProgramState *state)
-      : SuperTy(history, state) {}
-    ForwardIterator(CnTy &history)
-      : SuperTy(history) {}
-    ItTy begin() { return SuperTy::History.rbegin(); }
-    ItTy end()   { return SuperTy::History.rend(); }
-  };
-
-  template<typename CnTy, typename ItTy, typename TstIt>
-  class ReverseIterator 
-    : public Iterator<CnTy, ItTy, ReverseIterator<CnTy,ItTy,TstIt> >,
-      public TstIt {
-    typedef  Iterator<CnTy, ItTy, ReverseIterator<CnTy,ItTy,TstIt> > SuperTy;
-  public:
-    ReverseIterator(CnTy &history, const ProgramState *state)
-      : SuperTy(history, state) {}
-    ReverseIterator(CnTy &history)
-      : SuperTy(history) {}
-    ItTy begin() { return SuperTy::History.begin(); }
-    ItTy end()   { return SuperTy::History.end(); }
-  };
-
-  //-------------------------------------------------------------------------//
-  // Concrete iterator = {filtering conditon} x {iteration direction}
-  //-------------------------------------------------------------------------//
-#define DEF_ITER_TYPE(__typename, __dir_iter, __std_iter, __cond_iter)  \
-  typedef Iterator<HxVectorTy,                                          \
-                   HxVectorTy::__std_iter,                              \
-                   __dir_iter<HxVectorTy,                               \
-                              HxVectorTy::__std_iter,                   \
-                              __cond_iter> > __typename
-
-  //-------------------------------------------------------------------------//
-  // program state iterators
-  //-------------------------------------------------------------------------//
-  DEF_ITER_TYPE(iterator,
-                ForwardIterator, reverse_iterator, AllIterator);
-  DEF_ITER_TYPE(const_iterator, 
-                ForwardIterator, const_reverse_iterator, AllIterator);
-  DEF_ITER_TYPE(reverse_iterator,
-                ReverseIterator, iterator, AllIterator);
-  DEF_ITER_TYPE(const_reverse_iterator,
-                ReverseIterator, const_iterator, AllIterator);
-
-  // forward iterator creation methods.
-  iterator begin()             { return iterator(History, this, true); }
-  iterator end()               { return iterator(History, this, false); }
-  const_iterator begin() const { return const_iterator(History, this, true); }
-  const_iterator end() const   { return const_iterator(History, this, false); }
-
-  // reverse iterator creation methods.
-  reverse_iterator rbegin()             { return reverse_iterator(History, this, true); }
-  reverse_iterator rend()               { return reverse_iterator(History, this, false); }
-  const_reverse_iterator rbegin() const { return const_reverse_iterator(History, this, true); }
-  const_reverse_iterator rend() const   { return const_reverse_iterator(History, this, false);}
-
-  //-------------------------------------------------------------------------//
-  // historical event iterators
-  //-------------------------------------------------------------------------//
-  DEF_ITER_TYPE(hxev_iterator,
-                ForwardIterator, reverse_iterator, HistoricalEventIterator);
-  DEF_ITER_TYPE(hxev_const_iterator, 
-                ForwardIterator, const_reverse_iterator, HistoricalEventIterator);
-  DEF_ITER_TYPE(hxev_reverse_iterator,
-                ReverseIterator, iterator, HistoricalEventIterator);
-  DEF_ITER_TYPE(hxev_const_reverse_iterator,
-                ReverseIterator, const_iterator, HistoricalEventIterator);
-
-  // forward iterator creation methods.
-  hxev_iterator hxev_begin()             { return hxev_iterator(History, this, true); }
-  hxev_iterator hxev_end()               { return hxev_iterator(History, this, false); }
-  hxev_const_iterator hxev_begin() const { return hxev_const_iterator(History, this, true); }
-  hxev_const_iterator hxev_end() const   { return hxev_const_iterator(History, this, false); }
-
-  // reverse iterator creation methods.
-  hxev_reverse_iterator hxev_rbegin()             { return hxev_reverse_iterator(History, this, true); }
-  hxev_reverse_iterator hxev_rend()               { return hxev_reverse_iterator(History, this, false); }
-  hxev_const_reverse_iterator hxev_rbegin() const { return hxev_const_reverse_iterator(History, this, true); }
-  hxev_const_reverse_iterator hxev_rend() const   { return hxev_const_reverse_iterator(History, this, false);}
 };
 
 
@@ -657,9 +600,13 @@ private:
   SubEngine *Eng; /* Can be null. */
 
   EnvironmentManager                   EnvMgr;
+  HistoricalEventManager               HxEvMgr;
   std::unique_ptr<StoreManager>        StoreMgr;
   std::unique_ptr<ConstraintManager>   ConstraintMgr;
 
+  /// Text rendered by FssStmtPrinter, created on first use.
+  std::unique_ptr<FssRenderCache>      RenderCache;
+
   ProgramState::GenericDataMap::Factory     GDMFactory;
 
   typedef llvm::DenseMap<void*,std::pair<void*,void (*)(void*)> > GDMContextsTy;
@@ -721,6 +668,10 @@ public:
 
   CallEventManager &getCallEventManager() { return *CallEventMgr; }
 
+  HistoricalEventManager &getHistoricalEventManager() { return HxEvMgr; }
+
+  FssRenderCache &getRenderCache();
+
   StoreManager& getStoreManager() { return *StoreMgr; }
   ConstraintManager& getConstraintManager() { return *ConstraintMgr; }
   SubEngine* getOwningEngine() { return Eng; }
@@ -830,6 +781,12 @@ public:
   void EndPath(ProgramStateRef St) {
     ConstraintMgr->EndPath(St);
   }
+
+  /// Returns the number of distinct states alive.
+  unsigned getNumStates() const { return StateSet.size(); }
+
+  /// Adds the memory taken by the stores of the states alive to \p Usage.
+  void addStoreMemoryUsage(StoreMemoryUsage &Usage) const;
 };
 
 
@@ -840,7 +797,7 @@ public:
 inline ConstraintManager &ProgramState::getConstraintManager() const {
   return stateMgr->getConstraintManager();
 }
-  
+
 inline const VarRegion* ProgramState::getRegion(const VarDecl *D,
                                                 const LocationContext *LC) const 
 {
@@ -37,6 +37,19 @@ class ScanReachableSymbols;
 
 typedef llvm::DenseSet<SymbolRef> InvalidatedSymbols;
 
+/// The memory taken by a set of stores, as computed by
+/// StoreManager::addMemoryUsage.
+struct StoreMemoryUsage {
+  /// The bytes of the maps from the base regions to their clusters.
+  uint64_t MapBytes;
+  /// The bytes of the binding clusters.
+  uint64_t ClusterBytes;
+  /// The number of distinct binding clusters.
+  uint64_t NumClusters;
+
+  StoreMemoryUsage() : MapBytes(0), ClusterBytes(0), NumClusters(0) {}
+};
+
 class StoreManager {
 protected:
   SValBuilder &svalBuilder;
@@ -206,6 +219,13 @@ public:
   virtual void print(Store store, raw_ostream &Out,
                      const char* nl, const char *sep) = 0;
 
+  /// Adds the memory taken by \p store to \p Usage. The parts of the store
+  /// recorded in \p Visited, which it shares with the stores seen before, are
+  /// not counted again.
+  virtual void addMemoryUsage(Store store,
+                              llvm::DenseSet<const void *> &Visited,
+                              StoreMemoryUsage &Usage) {}
+
   class BindingsHandler {
   public:
     virtual ~BindingsHandler();
@@ -279,6 +299,8 @@ inline StoreRef &StoreRef::operator=(StoreRef const &newStore) {
 std::unique_ptr<StoreManager>
 CreateRegionStoreManager(ProgramStateManager &StMgr);
 std::unique_ptr<StoreManager>
+CreateHashTrieRegionStoreManager(ProgramStateManager &StMgr);
+std::unique_ptr<StoreManager>
 CreateFieldsOnlyRegionStoreManager(ProgramStateManager &StMgr);
 
 } // end GR namespace
@@ -84,11 +84,18 @@ public:
     return SourcePathList;
   }
 
+  /// Returns the number of files to process in parallel (-j), 0 meaning one
+  /// per hardware thread. See ClangTool::setNumThreads.
+  unsigned getNumThreads() const {
+    return NumThreads;
+  }
+
   static const char *const HelpMessage;
 
 private:
   std::unique_ptr<CompilationDatabase> Compilations;
   std::vector<std::string> SourcePathList;
+  unsigned NumThreads;
   std::vector<std::string> ExtraArgsBefore;
   std::vector<std::string> ExtraArgsAfter;
 };
@@ -279,8 +279,23 @@ class ClangTool {
   /// \brief Clear the command line arguments adjuster chain.
   void clearArgumentsAdjusters();
 
+  /// \brief Sets the number of translation units to process in parallel, 0
+  /// meaning one per hardware thread. The default is 1.
+  ///
+  /// With more than one thread, the action and the diagnostic consumer are
+  /// used by all the threads at once, so the action must be thread-safe; the
+  /// calls to the diagnostic consumer are serialized. The commands of all the
+  /// files are looked up before any of them is run, and they are run with
+  /// '-working-directory' instead of in their directories. The files are read
+  /// once and shared by the threads, so they must not change during the run.
+  void setNumThreads(unsigned NumThreads) { this->NumThreads = NumThreads; }
+
   /// Runs an action over all files specified in the command line.
   ///
+  /// The messages of the tool and, without a diagnostic consumer, the
+  /// diagnostics are printed in the order of the files even if they are
+  /// processed in parallel.
+  ///
   /// \param Action Tool action.
   int run(ToolAction *Action);
 
@@ -304,6 +319,11 @@ class ClangTool {
   ArgumentsAdjuster ArgsAdjuster;
 
   DiagnosticConsumer *DiagConsumer;
+
+  unsigned NumThreads;
+
+  int runInParallel(ToolAction *Action, const std::string &MainExecutable,
+                    unsigned Threads);
 };
 
 template <typename T>
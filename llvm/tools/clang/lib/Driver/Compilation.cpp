@@ -14,10 +14,19 @@
 #include "clang/Driver/Options.h"
 #include "clang/Driver/ToolChain.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 using namespace clang::driver;
 using namespace clang;
 using namespace llvm::opt;
@@ -122,8 +131,7 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
+bool Compilation::PrintCommand(const Command &C) const {
   if ((getDriver().CCPrintOptions ||
        getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
     raw_ostream *OS = &llvm::errs();
@@ -138,9 +146,8 @@ int Compilation::ExecuteCommand(const Command &C,
       if (EC) {
         getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
             << EC.message();
-        FailingCommand = &C;
         delete OS;
-        return 1;
+        return false;
       }
     }
 
@@ -152,13 +159,17 @@ int Compilation::ExecuteCommand(const Command &C,
     if (OS != &llvm::errs())
       delete OS;
   }
+  return true;
+}
 
-  std::string Error;
-  bool ExecutionFailed;
-  int Res = C.Execute(Redirects, &Error, &ExecutionFailed);
+/// Reports the result of running \p C, as returned by Command::Execute.
+static int CommandCompleted(const Compilation &Comp, const Command &C,
+                            int Res, const std::string &Error,
+                            bool ExecutionFailed,
+                            const Command *&FailingCommand) {
   if (!Error.empty()) {
     assert(Res && "Error string set with 0 result code!");
-    getDriver().Diag(clang::diag::err_drv_command_failure) << Error;
+    Comp.getDriver().Diag(clang::diag::err_drv_command_failure) << Error;
   }
 
   if (Res)
@@ -167,6 +178,20 @@ int Compilation::ExecuteCommand(const Command &C,
   return ExecutionFailed ? 1 : Res;
 }
 
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  if (!PrintCommand(C)) {
+    FailingCommand = &C;
+    return 1;
+  }
+
+  std::string Error;
+  bool ExecutionFailed;
+  int Res = C.Execute(Redirects, &Error, &ExecutionFailed);
+  return CommandCompleted(*this, C, Res, Error, ExecutionFailed,
+                          FailingCommand);
+}
+
 typedef SmallVectorImpl< std::pair<int, const Command *> > FailingCommandList;
 
 static bool ActionFailed(const Action *A,
@@ -207,6 +232,211 @@ void Compilation::ExecuteJob(const Job &J,
   }
 }
 
+static void CollectCommands(const Job &J,
+                            SmallVectorImpl<const Command *> &Commands) {
+  if (const Command *C = dyn_cast<Command>(&J)) {
+    Commands.push_back(C);
+  } else {
+    for (const auto &Job : *cast<JobList>(&J))
+      CollectCommands(Job, Commands);
+  }
+}
+
+typedef llvm::DenseMap<const Action *, SmallVector<unsigned, 1> >
+    ProducerMap;
+
+/// Adds the commands producing the inputs of \p A, transitively, to \p Deps.
+static void CollectDeps(const Action *A, const ProducerMap &Producers,
+                        llvm::SmallPtrSetImpl<const Action *> &Visited,
+                        SmallVectorImpl<unsigned> &Deps) {
+  for (Action::const_iterator AI = A->begin(), AE = A->end(); AI != AE; ++AI) {
+    if (!Visited.insert(*AI).second)
+      continue;
+    ProducerMap::const_iterator P = Producers.find(*AI);
+    if (P != Producers.end())
+      Deps.append(P->second.begin(), P->second.end());
+    CollectDeps(*AI, Producers, Visited, Deps);
+  }
+}
+
+#if LLVM_ENABLE_THREADS
+namespace {
+/// A command run by ExecuteJobs, and its result.
+struct ParallelCommand {
+  enum StateKind { Pending, Running, Completed, Skipped };
+
+  const Command *Cmd;
+  /// The commands which have to complete before this one, by index.
+  SmallVector<unsigned, 4> Deps;
+  StateKind State;
+  /// The files the stdout and the stderr of the command are redirected to,
+  /// or empty if they could not be created.
+  SmallString<128> OutFile, ErrFile;
+  std::thread Thread;
+  int Res;
+  std::string Error;
+  bool ExecutionFailed;
+
+  explicit ParallelCommand(const Command *Cmd)
+      : Cmd(Cmd), State(Pending), Res(0), ExecutionFailed(false) {}
+
+  bool failedOrSkipped() const {
+    return State == Skipped ||
+           (State == Completed && (Res || ExecutionFailed));
+  }
+};
+}
+
+/// Prints the contents of the file \p Path, if any, to \p OS and removes it.
+static void ReplayOutput(StringRef Path, raw_ostream &OS) {
+  if (Path.empty())
+    return;
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > Buffer =
+      llvm::MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (Buffer)
+    OS << (*Buffer)->getBuffer();
+  OS.flush();
+  llvm::sys::fs::remove(Path);
+}
+#endif
+
+void Compilation::ExecuteJobs(const JobList &Jobs,
+                              FailingCommandList &FailingCommands,
+                              unsigned NumParallelJobs) const {
+#if LLVM_ENABLE_THREADS
+  if (NumParallelJobs == 0)
+    NumParallelJobs = std::max(std::thread::hardware_concurrency(), 1U);
+
+  SmallVector<const Command *, 8> Commands;
+  CollectCommands(Jobs, Commands);
+
+  // The output of the commands run for diagnostics is discarded anyway, and
+  // a fallback command reports falling back through the driver diagnostics,
+  // which are not thread-safe.
+  bool RunInParallel = NumParallelJobs > 1 && Commands.size() > 1 &&
+                       !Redirects;
+  for (const Command *C : Commands)
+    if (isa<FallbackCommand>(C))
+      RunInParallel = false;
+
+  // The commands are printed once they have completed; make sure the
+  // CC_PRINT_OPTIONS file can be written first, so that the error is
+  // reported as the serial run reports it.
+  if (RunInParallel && getDriver().CCPrintOptions &&
+      getDriver().CCPrintOptionsFilename) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(getDriver().CCPrintOptionsFilename, EC,
+                            llvm::sys::fs::F_Append | llvm::sys::fs::F_Text);
+    if (EC)
+      RunInParallel = false;
+  }
+
+  if (!RunInParallel) {
+    ExecuteJob(Jobs, FailingCommands);
+    return;
+  }
+
+  // Build the dependencies of the commands from the actions they come from.
+  // The inputs of a command come from commands before it, and so do its
+  // dependencies. The commands coming from the same action are run in order.
+  ProducerMap Producers;
+  std::vector<ParallelCommand> Cmds(Commands.begin(), Commands.end());
+  for (unsigned I = 0, E = Cmds.size(); I != E; ++I) {
+    SmallVector<unsigned, 1> &P = Producers[&Cmds[I].Cmd->getSource()];
+    Cmds[I].Deps.append(P.begin(), P.end());
+    P.push_back(I);
+  }
+  for (unsigned I = 0, E = Cmds.size(); I != E; ++I) {
+    llvm::SmallPtrSet<const Action *, 16> Visited;
+    SmallVector<unsigned, 8> Deps;
+    CollectDeps(&Cmds[I].Cmd->getSource(), Producers, Visited, Deps);
+    for (unsigned D : Deps)
+      if (D < I)
+        Cmds[I].Deps.push_back(D);
+  }
+
+  std::mutex Mutex;
+  std::condition_variable CommandCompletedCV;
+  unsigned NumRunning = 0;
+  unsigned NextToReport = 0;
+  std::unique_lock<std::mutex> Lock(Mutex);
+  while (NextToReport != Cmds.size()) {
+    // Start the first ready commands, and skip those whose inputs failed.
+    for (unsigned I = NextToReport, E = Cmds.size(); I != E; ++I) {
+      ParallelCommand &PC = Cmds[I];
+      if (PC.State != ParallelCommand::Pending)
+        continue;
+      bool Ready = true, Skip = false;
+      for (unsigned D : PC.Deps) {
+        if (Cmds[D].failedOrSkipped())
+          Skip = true;
+        else if (Cmds[D].State != ParallelCommand::Completed)
+          Ready = false;
+      }
+      if (Skip) {
+        PC.State = ParallelCommand::Skipped;
+        continue;
+      }
+      if (!Ready || NumRunning == NumParallelJobs)
+        continue;
+
+      if (llvm::sys::fs::createTemporaryFile("clang-job", "out", PC.OutFile))
+        PC.OutFile.clear();
+      if (llvm::sys::fs::createTemporaryFile("clang-job", "err", PC.ErrFile))
+        PC.ErrFile.clear();
+      PC.State = ParallelCommand::Running;
+      ++NumRunning;
+      PC.Thread = std::thread([&PC, &Mutex, &CommandCompletedCV,
+                               &NumRunning] {
+        StringRef Out = PC.OutFile, Err = PC.ErrFile;
+        const StringRef *CommandRedirects[] = {
+          nullptr, Out.empty() ? nullptr : &Out, Err.empty() ? nullptr : &Err
+        };
+        std::string Error;
+        bool ExecutionFailed;
+        int Res = PC.Cmd->Execute(CommandRedirects, &Error, &ExecutionFailed);
+
+        std::lock_guard<std::mutex> Lock(Mutex);
+        PC.Res = Res;
+        PC.Error = std::move(Error);
+        PC.ExecutionFailed = ExecutionFailed;
+        PC.State = ParallelCommand::Completed;
+        --NumRunning;
+        CommandCompletedCV.notify_one();
+      });
+    }
+
+    // Report the completed commands in order, as ExecuteJob would.
+    bool Reported = false;
+    for (; NextToReport != Cmds.size(); ++NextToReport) {
+      ParallelCommand &PC = Cmds[NextToReport];
+      if (PC.State == ParallelCommand::Skipped) {
+        Reported = true;
+        continue;
+      }
+      if (PC.State != ParallelCommand::Completed)
+        break;
+      PC.Thread.join();
+      Reported = true;
+
+      PrintCommand(*PC.Cmd);
+      ReplayOutput(PC.OutFile, llvm::outs());
+      ReplayOutput(PC.ErrFile, llvm::errs());
+      const Command *FailingCommand = nullptr;
+      if (int Res = CommandCompleted(*this, *PC.Cmd, PC.Res, PC.Error,
+                                     PC.ExecutionFailed, FailingCommand))
+        FailingCommands.push_back(std::make_pair(Res, FailingCommand));
+    }
+
+    if (!Reported && NextToReport != Cmds.size())
+      CommandCompletedCV.wait(Lock);
+  }
+#else
+  ExecuteJob(Jobs, FailingCommands);
+#endif
+}
+
 void Compilation::initCompilationForDiagnostics() {
   ForDiagnostics = true;
 
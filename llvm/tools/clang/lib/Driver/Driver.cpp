@@ -57,7 +57,7 @@ Driver::Driver(StringRef ClangExecutable,
     CCCPrintBindings(false),
     CCPrintHeaders(false), CCLogDiagnostics(false),
     CCGenDiagnostics(false), CCCGenericGCCName(""), CheckInputsExist(true),
-    CCCUsePCH(true), SuppressMissingInputWarning(false) {
+    CCCUsePCH(true), NumParallelJobs(1), SuppressMissingInputWarning(false) {
 
   Name = llvm::sys::path::stem(ClangExecutable);
   Dir  = llvm::sys::path::parent_path(ClangExecutable);
@@ -363,6 +363,12 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
 
   if (const Arg *A = Args->getLastArg(options::OPT_resource_dir))
     ResourceDir = A->getValue();
+  if (const Arg *A = Args->getLastArg(options::OPT_parallel_jobs_EQ)) {
+    StringRef Value = A->getValue();
+    if (Value.getAsInteger(10, NumParallelJobs))
+      Diag(clang::diag::err_drv_invalid_int_value)
+        << A->getAsString(*Args) << Value;
+  }
 
   // Perform the default argument translations.
   DerivedArgList *TranslatedArgs = TranslateInputArgs(*Args);
@@ -592,7 +598,7 @@ int Driver::ExecuteCompilation(Compilation &C,
   // Set up response file names for each command, if necessary
   setUpResponseFiles(C, C.getJobs());
 
-  C.ExecuteJob(C.getJobs(), FailingCommands);
+  C.ExecuteJobs(C.getJobs(), FailingCommands, NumParallelJobs);
 
   // Remove temp files.
   C.CleanupFileList(C.getTempFiles());
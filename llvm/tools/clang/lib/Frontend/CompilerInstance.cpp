@@ -27,6 +27,7 @@
 #include "clang/Frontend/Utils.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/PTHManager.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
@@ -313,6 +314,10 @@ void CompilerInstance::createPreprocessor(TranslationUnitKind TUKind) {
     PP->setPTHManager(PTHMgr);
   }
 
+  if (!PPOpts.HeaderTokenCachePath.empty())
+    PP->setHeaderTokenCache(llvm::make_unique<HeaderTokenCache>(
+        *PP, PPOpts.HeaderTokenCachePath));
+
   if (PPOpts.DetailedRecord)
     PP->createPreprocessingRecord();
 
@@ -0,0 +1,470 @@
+//===--- HeaderTokenCache.cpp - On-disk cache of header tokens ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PTHLexer.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+#include <iterator>
+#include <vector>
+using namespace clang;
+using namespace llvm::support;
+
+// A cache file holds, in little endian:
+//
+//   - the header: the magic number "HTC\0", the version, the key, the size of
+//     the source file, the offset of the conditional table, and the offset
+//     and the number of entries of the identifier table;
+//   - the tokens in the PTH format.  The spelling offset of a literal is its
+//     offset in the source file, and the identifiers are numbered in the order
+//     in which they appear;
+//   - the conditional table in the PTH format;
+//   - the identifier table: the offset and the length of each name;
+//   - the names of the identifiers.
+static const char Magic[4] = { 'H', 'T', 'C', '\0' };
+static const unsigned HeaderSize = 4 + 4 + 8 + 4 * 4;
+static const unsigned StoredTokenSize = 4 * 3;
+
+//===----------------------------------------------------------------------===//
+// CachedFile
+//===----------------------------------------------------------------------===//
+
+/// The cached tokens of a header, read from a cache file.
+class HeaderTokenCache::CachedFile : public PTHTokenSource {
+  Preprocessor &PP;
+  std::unique_ptr<llvm::MemoryBuffer> Buf;
+  const unsigned char *IdTable;
+
+  /// The IdentifierInfo of each identifier, resolved lazily.
+  std::vector<IdentifierInfo *> Identifiers;
+
+  CachedFile(Preprocessor &PP, const char *SourceBase,
+             std::unique_ptr<llvm::MemoryBuffer> Buf,
+             const unsigned char *TokenData, const unsigned char *PPCond,
+             const unsigned char *IdTable, unsigned NumIds)
+    : PTHTokenSource((const unsigned char *)SourceBase), PP(PP),
+      Buf(std::move(Buf)), IdTable(IdTable), Identifiers(NumIds),
+      TokenData(TokenData), PPCond(PPCond) {}
+
+public:
+  const unsigned char *const TokenData;
+  /// The conditional table, or null if it is empty.
+  const unsigned char *const PPCond;
+
+  /// \brief Return the cached tokens held by \p Buf, or null if \p Buf is
+  /// not the cache file of the source file \p Source with key \p Key.
+  static CachedFile *Create(Preprocessor &PP, StringRef Source,
+                            std::unique_ptr<llvm::MemoryBuffer> Buf,
+                            uint64_t Key);
+
+  IdentifierInfo *GetIdentifierInfo(unsigned PersistentID) override {
+    IdentifierInfo *&II = Identifiers[PersistentID];
+    if (!II) {
+      const unsigned char *P = IdTable + PersistentID * 8;
+      uint32_t Offset = endian::readNext<uint32_t, little, aligned>(P);
+      uint32_t Len = endian::readNext<uint32_t, little, aligned>(P);
+      II = PP.getIdentifierInfo(
+          StringRef(Buf->getBufferStart() + Offset, Len));
+    }
+    return II;
+  }
+};
+
+HeaderTokenCache::CachedFile *
+HeaderTokenCache::CachedFile::Create(Preprocessor &PP, StringRef Source,
+                                     std::unique_ptr<llvm::MemoryBuffer> Buf,
+                                     uint64_t Key) {
+  const unsigned char *BufBeg = (const unsigned char *)Buf->getBufferStart();
+  uint64_t Size = Buf->getBufferSize();
+  if (Size < HeaderSize || memcmp(BufBeg, Magic, sizeof(Magic)))
+    return nullptr;
+
+  const unsigned char *P = BufBeg + sizeof(Magic);
+  if (endian::readNext<uint32_t, little, aligned>(P) != Version ||
+      endian::readNext<uint64_t, little, aligned>(P) != Key ||
+      endian::readNext<uint32_t, little, aligned>(P) != Source.size())
+    return nullptr;
+  uint32_t PPCondOffset = endian::readNext<uint32_t, little, aligned>(P);
+  uint32_t IdTableOffset = endian::readNext<uint32_t, little, aligned>(P);
+  uint32_t NumIds = endian::readNext<uint32_t, little, aligned>(P);
+
+  // Check that the tables are within the file and the token data ends with
+  // the end of file, as they are read without bounds checks.
+  if (PPCondOffset < HeaderSize + StoredTokenSize ||
+      (PPCondOffset - HeaderSize) % StoredTokenSize ||
+      PPCondOffset + 4 > IdTableOffset || IdTableOffset % 4 ||
+      IdTableOffset + uint64_t(NumIds) * 8 > Size)
+    return nullptr;
+  if ((tok::TokenKind)BufBeg[PPCondOffset - StoredTokenSize] != tok::eof)
+    return nullptr;
+  const unsigned char *PPCond = BufBeg + PPCondOffset;
+  uint32_t NumConds = endian::readNext<uint32_t, little, aligned>(PPCond);
+  if (PPCondOffset + 4 + uint64_t(NumConds) * 8 > IdTableOffset)
+    return nullptr;
+  const unsigned char *IdTable = BufBeg + IdTableOffset;
+  for (P = IdTable; P != IdTable + NumIds * 8;) {
+    uint64_t Offset = endian::readNext<uint32_t, little, aligned>(P);
+    if (Offset + endian::readNext<uint32_t, little, aligned>(P) > Size)
+      return nullptr;
+  }
+
+  return new CachedFile(PP, Source.data(), std::move(Buf),
+                        BufBeg + HeaderSize, NumConds ? PPCond : nullptr,
+                        IdTable, NumIds);
+}
+
+//===----------------------------------------------------------------------===//
+// Storing the tokens of a header
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Accumulates the tokens of a header in the format of the cache files.
+class TokenWriter {
+  const SourceManager &SM;
+
+public:
+  /// The token data, three words per token.
+  SmallVector<uint32_t, 1024> Tokens;
+  /// The identifiers, in the order of their persistent IDs.
+  std::vector<const IdentifierInfo *> Identifiers;
+  llvm::DenseMap<const IdentifierInfo *, uint32_t> IdentifierIDs;
+  /// Whether a token is too long for the token data.
+  bool TooLong;
+
+  explicit TokenWriter(const SourceManager &SM) : SM(SM), TooLong(false) {}
+
+  /// The offset of the next token in the token data.
+  uint32_t getOffset() const { return Tokens.size() * sizeof(uint32_t); }
+
+  void EmitToken(const Token &T) {
+    if (T.getLength() > 0xFFFF)
+      TooLong = true;
+    uint32_t FileOffset = SM.getFileOffset(T.getLocation());
+    // The spellings of the literals are read from the source file.  The
+    // identifiers are stored with the kind tok::identifier, which fits in the
+    // byte of the kind unlike some keywords, and PTHLexer sets their kind
+    // from their IdentifierInfo.
+    uint32_t Data = 0;
+    tok::TokenKind Kind = T.getKind();
+    if (T.isLiteral()) {
+      Data = FileOffset;
+    } else if (const IdentifierInfo *II = T.getIdentifierInfo()) {
+      Data = ResolveID(II);
+      Kind = tok::identifier;
+    }
+    Tokens.push_back((uint32_t)Kind | ((uint32_t)T.getFlags() << 8) |
+                     ((uint32_t)T.getLength() << 16));
+    Tokens.push_back(Data);
+    Tokens.push_back(FileOffset);
+  }
+
+  /// Return the persistent ID of \p II, plus one as 0 means no identifier.
+  uint32_t ResolveID(const IdentifierInfo *II) {
+    uint32_t &ID = IdentifierIDs[II];
+    if (!ID) {
+      Identifiers.push_back(II);
+      ID = Identifiers.size();
+    }
+    return ID;
+  }
+};
+}
+
+std::string HeaderTokenCache::LexTokens(FileID FID, uint64_t Key) {
+  SourceManager &SM = PP.getSourceManager();
+  Lexer L(FID, SM.getBuffer(FID), SM, PP.getLangOpts());
+  TokenWriter W(SM);
+
+  // This follows PTHWriter::LexTokens, except that the eod tokens are formed
+  // by the Lexer at the newline ending each directive, as when lexing from
+  // the source, and that a file whose conditionals are not balanced is not
+  // cached instead of asserting.
+
+  // Keep track of matching '#if' ... '#endif'.
+  typedef std::vector<std::pair<uint32_t, unsigned> > PPCondTable;
+  PPCondTable PPCond;
+  std::vector<unsigned> PPStartCond;
+  Token Tok;
+
+  do {
+    L.LexFromRawLexer(Tok);
+  NextToken:
+
+    if (Tok.is(tok::raw_identifier)) {
+      PP.LookUpIdentifierInfo(Tok);
+      W.EmitToken(Tok);
+      continue;
+    }
+
+    if (Tok.is(tok::hash) && Tok.isAtStartOfLine()) {
+      uint32_t HashOff = W.getOffset();
+
+      Token NextTok;
+      L.LexFromRawLexer(NextTok);
+
+      // A null directive "#": discard the '#'.
+      if (NextTok.isAtStartOfLine() || NextTok.is(tok::eof)) {
+        Tok = NextTok;
+        goto NextToken;
+      }
+
+      // Lex the rest of the line, up to the eod, in directive mode.
+      W.EmitToken(Tok);
+      Tok = NextTok;
+      L.setParsingPreprocessorDirective(true);
+
+      if (Tok.isNot(tok::raw_identifier)) {
+        W.EmitToken(Tok);
+        continue;
+      }
+
+      IdentifierInfo *II = PP.LookUpIdentifierInfo(Tok);
+      switch (II->getPPKeywordID()) {
+      default:
+        break;
+
+      case tok::pp_include:
+      case tok::pp_import:
+      case tok::pp_include_next:
+        // Lex the next token as an include string.
+        W.EmitToken(Tok);
+        L.LexIncludeFilename(Tok);
+        if (Tok.is(tok::raw_identifier))
+          PP.LookUpIdentifierInfo(Tok);
+        break;
+
+      case tok::pp_if:
+      case tok::pp_ifdef:
+      case tok::pp_ifndef:
+        // The target index is backpatched at the matching #elif, #else or
+        // #endif.
+        PPStartCond.push_back(PPCond.size());
+        PPCond.push_back(std::make_pair(HashOff, 0U));
+        break;
+
+      case tok::pp_endif: {
+        if (PPStartCond.empty())
+          return std::string();
+        unsigned Index = PPCond.size();
+        PPCond[PPStartCond.back()].second = Index;
+        PPStartCond.pop_back();
+        // The target index of an #endif is set to itself, and is written as
+        // zero.
+        PPCond.push_back(std::make_pair(HashOff, Index));
+        W.EmitToken(Tok);
+
+        // PTHLexer::SkipBlock expects the eod right after the 'endif', so
+        // discard the tokens on the rest of the line.
+        do
+          L.LexFromRawLexer(Tok);
+        while (Tok.isNot(tok::eod));
+        break;
+      }
+
+      case tok::pp_elif:
+      case tok::pp_else: {
+        // This closes the previous block and opens a new one.
+        if (PPStartCond.empty())
+          return std::string();
+        unsigned Index = PPCond.size();
+        PPCond[PPStartCond.back()].second = Index;
+        PPStartCond.pop_back();
+        PPCond.push_back(std::make_pair(HashOff, 0U));
+        PPStartCond.push_back(Index);
+        break;
+      }
+      }
+    }
+
+    W.EmitToken(Tok);
+  } while (Tok.isNot(tok::eof));
+
+  if (!PPStartCond.empty() || W.TooLong)
+    return std::string();
+
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  endian::Writer<little> LE(OS);
+
+  uint32_t PPCondOffset = HeaderSize + W.getOffset();
+  uint32_t IdTableOffset = PPCondOffset + 4 + PPCond.size() * 8;
+  uint32_t NumIds = W.Identifiers.size();
+
+  OS.write(Magic, sizeof(Magic));
+  LE.write<uint32_t>(Version);
+  LE.write<uint64_t>(Key);
+  LE.write<uint32_t>(SM.getBufferData(FID).size());
+  LE.write<uint32_t>(PPCondOffset);
+  LE.write<uint32_t>(IdTableOffset);
+  LE.write<uint32_t>(NumIds);
+
+  for (uint32_t Word : W.Tokens)
+    LE.write<uint32_t>(Word);
+
+  LE.write<uint32_t>(PPCond.size());
+  for (unsigned I = 0, E = PPCond.size(); I != E; ++I) {
+    LE.write<uint32_t>(PPCond[I].first);
+    LE.write<uint32_t>(PPCond[I].second == I ? 0 : PPCond[I].second);
+  }
+
+  uint32_t NameOffset = IdTableOffset + NumIds * 8;
+  for (const IdentifierInfo *II : W.Identifiers) {
+    LE.write<uint32_t>(NameOffset);
+    LE.write<uint32_t>(II->getLength());
+    NameOffset += II->getLength();
+  }
+  for (const IdentifierInfo *II : W.Identifiers)
+    OS << II->getName();
+
+  return OS.str();
+}
+
+bool HeaderTokenCache::WriteCacheFile(StringRef Name, StringRef Data) {
+  if (llvm::sys::fs::create_directories(Path))
+    return false;
+
+  // Write a temporary file and rename it, so that the translation units which
+  // run concurrently never read a partial file.
+  SmallString<128> TempPath;
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(Name + "-%%%%%%%%", FD, TempPath))
+    return false;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath.str());
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath.str(), Name)) {
+    llvm::sys::fs::remove(TempPath.str());
+    return false;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// HeaderTokenCache
+//===----------------------------------------------------------------------===//
+
+HeaderTokenCache::HeaderTokenCache(Preprocessor &PP, StringRef Path)
+  : PP(PP), Path(Path), NumHits(0), NumStores(0) {
+  // The options read by the Lexer; the keywords are resolved when the tokens
+  // are read back.
+  const LangOptions &LO = PP.getLangOpts();
+  unsigned Opts[] = {
+    LO.AsmPreprocessor, LO.C11, LO.C99, LO.CPlusPlus, LO.CPlusPlus11,
+    LO.CPlusPlus1z, LO.CUDA, LO.Digraphs, LO.DollarIdents, LO.LineComment,
+    LO.MicrosoftExt, LO.ObjC1, LO.TraditionalCPP, LO.Trigraphs
+  };
+  LangOptsHash = llvm::hash_combine_range(std::begin(Opts), std::end(Opts));
+}
+
+HeaderTokenCache::~HeaderTokenCache() {
+  llvm::DeleteContainerSeconds(Files);
+}
+
+PTHLexer *HeaderTokenCache::CreateLexer(FileID FID) {
+  SourceManager &SM = PP.getSourceManager();
+  const FileEntry *FE = SM.getFileEntryForID(FID);
+  if (!FE)
+    return nullptr;
+
+  CachedFile *F;
+  llvm::DenseMap<const FileEntry *, CachedFile *>::iterator I = Files.find(FE);
+  if (I != Files.end()) {
+    F = I->second;
+  } else {
+    bool Invalid = false;
+    StringRef Source = SM.getBufferData(FID, &Invalid);
+    if (Invalid)
+      return nullptr;
+
+    uint64_t Key = llvm::hash_combine(unsigned(Version), LangOptsHash,
+                                      Source.size(), llvm::hash_value(Source));
+    SmallString<128> Name(Path);
+    llvm::sys::path::append(Name, llvm::utohexstr(Key) + ".htc");
+
+    F = nullptr;
+    if (llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buf =
+            llvm::MemoryBuffer::getFile(Name.str(), /*FileSize=*/-1,
+                                        /*RequiresNullTerminator=*/false))
+      F = CachedFile::Create(PP, Source, std::move(*Buf), Key);
+
+    if (!F) {
+      // Lex the header from the source this time, so that the diagnostics of
+      // the lexer are issued, and store it at its end if there are none.
+      std::string Data = LexTokens(FID, Key);
+      if (Data.empty()) {
+        Files[FE] = nullptr;
+      } else {
+        PendingFile &P = Pending[FID];
+        P.Key = Key;
+        P.Name = Name.str();
+        P.Data.swap(Data);
+      }
+      return nullptr;
+    }
+    Files[FE] = F;
+  }
+
+  if (!F)
+    return nullptr;
+  ++NumHits;
+  return new PTHLexer(PP, FID, F->TokenData, F->PPCond, *F);
+}
+
+void HeaderTokenCache::ExitSourceFile(const Lexer &L) {
+  llvm::DenseMap<FileID, PendingFile>::iterator I =
+      Pending.find(L.getFileID());
+  if (I == Pending.end())
+    return;
+
+  SourceManager &SM = PP.getSourceManager();
+  const PendingFile &P = I->second;
+  CachedFile *F = nullptr;
+  // The translation units which read the tokens of the header back would
+  // not issue the diagnostics of the lexer, so such a header is lexed from
+  // the source every time.  Entering it again otherwise reads the tokens just
+  // stored.
+  if (!L.hasIssuedDiagnostics()) {
+    if (WriteCacheFile(P.Name, P.Data))
+      ++NumStores;
+    F = CachedFile::Create(
+        PP, SM.getBufferData(L.getFileID()),
+        llvm::MemoryBuffer::getMemBufferCopy(P.Data, P.Name), P.Key);
+  }
+  Files[SM.getFileEntryForID(L.getFileID())] = F;
+  Pending.erase(I);
+}
+
+void HeaderTokenCache::PrintStats() const {
+  llvm::errs() << "\n*** Header Token Cache Stats:\n";
+  llvm::errs() << NumHits << " headers read from the cache.\n";
+  llvm::errs() << NumStores << " headers stored in the cache.\n";
+}
@@ -85,6 +85,7 @@ void Lexer::InitLexer(const char *BufStart, const char *BufPtr,
 
   HasLeadingSpace = false;
   HasLeadingEmptyMacro = false;
+  HasIssuedDiagnostics = false;
 
   // We are not after parsing a #.
   ParsingPreprocessorDirective = false;
@@ -1066,6 +1067,7 @@ SourceLocation Lexer::getSourceLocation(const char *Loc,
 /// Diag - Forwarding function for diagnostics.  This translate a source
 /// position in the current buffer into a SourceLocation object for rendering.
 DiagnosticBuilder Lexer::Diag(const char *Loc, unsigned DiagID) const {
+  HasIssuedDiagnostics = true;
   return PP->Diag(getSourceLocation(Loc), DiagID);
 }
 
@@ -1347,6 +1349,153 @@ Slash:
 // Helper methods for lexing.
 //===----------------------------------------------------------------------===//
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
+// The scanners below skip over the characters which need no decoding a whole
+// vector at a time, and stop where the scalar code has to take over: at the
+// character which ends the construct, and at the '\\', '?' and non-ASCII
+// characters which may start an escaped newline, a trigraph or a UCN in it.
+// They only load complete vectors before BufferEnd and leave the remainder to
+// the scalar loops of their callers, which do all the work on targets without
+// SSE2.
+#ifdef __SSE2__
+namespace {
+#ifdef __AVX2__
+typedef __m256i CharVec;
+const unsigned CharVecSize = 32;
+inline CharVec loadChars(const char *Ptr) {
+  return _mm256_loadu_si256((const __m256i *)Ptr);
+}
+inline CharVec splatChar(char C) { return _mm256_set1_epi8(C); }
+inline CharVec cmpEq(CharVec A, CharVec B) { return _mm256_cmpeq_epi8(A, B); }
+inline CharVec cmpGt(CharVec A, CharVec B) { return _mm256_cmpgt_epi8(A, B); }
+inline CharVec orChars(CharVec A, CharVec B) { return _mm256_or_si256(A, B); }
+inline CharVec andChars(CharVec A, CharVec B) {
+  return _mm256_and_si256(A, B);
+}
+inline uint32_t getMask(CharVec V) { return _mm256_movemask_epi8(V); }
+#else
+typedef __m128i CharVec;
+const unsigned CharVecSize = 16;
+inline CharVec loadChars(const char *Ptr) {
+  return _mm_loadu_si128((const __m128i *)Ptr);
+}
+inline CharVec splatChar(char C) { return _mm_set1_epi8(C); }
+inline CharVec cmpEq(CharVec A, CharVec B) { return _mm_cmpeq_epi8(A, B); }
+inline CharVec cmpGt(CharVec A, CharVec B) { return _mm_cmpgt_epi8(A, B); }
+inline CharVec orChars(CharVec A, CharVec B) { return _mm_or_si128(A, B); }
+inline CharVec andChars(CharVec A, CharVec B) { return _mm_and_si128(A, B); }
+inline uint32_t getMask(CharVec V) { return _mm_movemask_epi8(V); }
+#endif
+
+/// The mask of a vector whose characters all match.
+const uint32_t AllCharsMask = uint32_t((1ULL << CharVecSize) - 1);
+
+/// Return the mask of the characters of \p V which are in [_A-Za-z0-9].
+/// The comparisons are signed, so the non-ASCII characters are in none of
+/// the ranges.
+inline uint32_t getIdentifierBodyMask(CharVec V) {
+  CharVec Lower = orChars(V, splatChar(0x20));
+  CharVec Letter = andChars(cmpGt(Lower, splatChar('a' - 1)),
+                            cmpGt(splatChar('z' + 1), Lower));
+  CharVec Digit = andChars(cmpGt(V, splatChar('0' - 1)),
+                           cmpGt(splatChar('9' + 1), V));
+  return getMask(orChars(orChars(Letter, Digit), cmpEq(V, splatChar('_'))));
+}
+
+/// Return the mask of the characters of \p V which are ' ', '\\t', '\\f' or
+/// '\\v'.
+inline uint32_t getHorizontalWhitespaceMask(CharVec V) {
+  return getMask(orChars(orChars(cmpEq(V, splatChar(' ')),
+                                 cmpEq(V, splatChar('\t'))),
+                         orChars(cmpEq(V, splatChar('\f')),
+                                 cmpEq(V, splatChar('\v')))));
+}
+
+/// Return the mask of the characters of \p V which end the fast scan of a
+/// line comment: '\\n', '\\r' and '\\0'.
+inline uint32_t getLineCommentEndMask(CharVec V) {
+  return getMask(orChars(orChars(cmpEq(V, splatChar('\n')),
+                                 cmpEq(V, splatChar('\r'))),
+                         cmpEq(V, splatChar('\0'))));
+}
+
+/// Return the mask of the characters of \p V which getAndAdvanceChar must
+/// see in a string literal: the closing quote, escapes, trigraphs, newlines
+/// and nul characters.
+inline uint32_t getStringLiteralStopMask(CharVec V) {
+  CharVec Stop = orChars(cmpEq(V, splatChar('"')), cmpEq(V, splatChar('\\')));
+  Stop = orChars(Stop, cmpEq(V, splatChar('?')));
+  Stop = orChars(Stop, cmpEq(V, splatChar('\n')));
+  Stop = orChars(Stop, cmpEq(V, splatChar('\r')));
+  return getMask(orChars(Stop, cmpEq(V, splatChar('\0'))));
+}
+} // end anonymous namespace
+#endif
+
+/// Skip the characters from \p CurPtr on which are in [_A-Za-z0-9], and
+/// return a pointer to the first one which is not, or to the remainder
+/// shorter than a vector.
+static const char *skipIdentifierBody(const char *CurPtr,
+                                      const char *BufferEnd) {
+#ifdef __SSE2__
+  for (; CurPtr + CharVecSize <= BufferEnd; CurPtr += CharVecSize) {
+    uint32_t Stop = ~getIdentifierBodyMask(loadChars(CurPtr)) & AllCharsMask;
+    if (Stop)
+      return CurPtr + llvm::countTrailingZeros(Stop);
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the horizontal whitespace from \p CurPtr on, as skipIdentifierBody.
+static const char *skipHorizontalWhitespace(const char *CurPtr,
+                                            const char *BufferEnd) {
+#ifdef __SSE2__
+  for (; CurPtr + CharVecSize <= BufferEnd; CurPtr += CharVecSize) {
+    uint32_t Stop =
+        ~getHorizontalWhitespaceMask(loadChars(CurPtr)) & AllCharsMask;
+    if (Stop)
+      return CurPtr + llvm::countTrailingZeros(Stop);
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the body of a line comment from \p CurPtr on, up to the first
+/// '\\n', '\\r' or '\\0', as skipIdentifierBody.
+static const char *skipLineCommentBody(const char *CurPtr,
+                                       const char *BufferEnd) {
+#ifdef __SSE2__
+  for (; CurPtr + CharVecSize <= BufferEnd; CurPtr += CharVecSize) {
+    if (uint32_t Stop = getLineCommentEndMask(loadChars(CurPtr)))
+      return CurPtr + llvm::countTrailingZeros(Stop);
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the characters of a string literal from \p CurPtr on which need no
+/// decoding, as skipIdentifierBody.
+static const char *skipStringLiteralBody(const char *CurPtr,
+                                         const char *BufferEnd) {
+#ifdef __SSE2__
+  for (; CurPtr + CharVecSize <= BufferEnd; CurPtr += CharVecSize) {
+    if (uint32_t Stop = getStringLiteralStopMask(loadChars(CurPtr)))
+      return CurPtr + llvm::countTrailingZeros(Stop);
+  }
+#endif
+  return CurPtr;
+}
+
 /// \brief Routine that indiscriminately skips bytes in the source file.
 void Lexer::SkipBytes(unsigned Bytes, bool StartOfLine) {
   BufferPtr += Bytes;
@@ -1438,10 +1587,12 @@ bool Lexer::tryConsumeIdentifierUCN(const char *&CurPtr, unsigned Size,
   if (CodePoint == 0 || !isAllowedIDChar(CodePoint, LangOpts))
     return false;
 
-  if (!isLexingRawMode())
+  if (!isLexingRawMode()) {
+    HasIssuedDiagnostics = true;
     maybeDiagnoseIDCharCompat(PP->getDiagnostics(), CodePoint,
                               makeCharRange(*this, CurPtr, UCNPtr),
                               /*IsFirst=*/false);
+  }
 
   Result.setFlag(Token::HasUCN);
   if ((UCNPtr - CurPtr ==  6 && CurPtr[1] == 'u') ||
@@ -1465,10 +1616,12 @@ bool Lexer::tryConsumeIdentifierUTF8Char(const char *&CurPtr) {
       !isAllowedIDChar(static_cast<uint32_t>(CodePoint), LangOpts))
     return false;
 
-  if (!isLexingRawMode())
+  if (!isLexingRawMode()) {
+    HasIssuedDiagnostics = true;
     maybeDiagnoseIDCharCompat(PP->getDiagnostics(), CodePoint,
                               makeCharRange(*this, CurPtr, UnicodePtr),
                               /*IsFirst=*/false);
+  }
 
   CurPtr = UnicodePtr;
   return true;
@@ -1477,6 +1630,7 @@ bool Lexer::tryConsumeIdentifierUTF8Char(const char *&CurPtr) {
 bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
   unsigned char C = *CurPtr++;
   while (isIdentifierBody(C))
     C = *CurPtr++;
@@ -1728,6 +1882,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
            ? diag::warn_cxx98_compat_unicode_literal
            : diag::warn_c99_compat_unicode_literal);
 
+  CurPtr = skipStringLiteralBody(CurPtr, BufferEnd);
   char C = getAndAdvanceChar(CurPtr, Result);
   while (C != '"') {
     // Skip escaped characters.  Escaped newlines will already be processed by
@@ -1753,6 +1908,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = skipStringLiteralBody(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1968,6 +2124,8 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
   // Skip consecutive spaces efficiently.
   while (1) {
     // Skip horizontal whitespace very aggressively.
+    CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+    Char = *CurPtr;
     while (isHorizontalWhitespace(Char))
       Char = *++CurPtr;
 
@@ -2034,6 +2192,7 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    CurPtr = skipLineCommentBody(CurPtr, BufferEnd);
     C = *CurPtr;
     // Skip over characters in the fast loop.
     while (C != 0 &&                // Potentially EOF.
@@ -2239,13 +2398,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2506,9 +2658,11 @@ bool Lexer::LexEndOfFile(Token &Result, const char *CurPtr) {
 
   // If we are in a #if directive, emit an error.
   while (!ConditionalStack.empty()) {
-    if (PP->getCodeCompletionFileLoc() != FileLoc)
+    if (PP->getCodeCompletionFileLoc() != FileLoc) {
+      HasIssuedDiagnostics = true;
       PP->Diag(ConditionalStack.back().IfLoc,
                diag::err_pp_unterminated_conditional);
+    }
     ConditionalStack.pop_back();
   }
 
@@ -2825,6 +2979,7 @@ bool Lexer::LexUnicode(Token &Result, uint32_t C, const char *CurPtr) {
   if (isAllowedIDChar(C, LangOpts) && isAllowedInitiallyIDChar(C, LangOpts)) {
     if (!isLexingRawMode() && !ParsingPreprocessorDirective &&
         !PP->isPreprocessedOutput()) {
+      HasIssuedDiagnostics = true;
       maybeDiagnoseIDCharCompat(PP->getDiagnostics(), C,
                                 makeCharRange(*this, BufferPtr, CurPtr),
                                 /*IsFirst=*/true);
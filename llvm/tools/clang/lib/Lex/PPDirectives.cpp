@@ -1143,17 +1143,17 @@ void Preprocessor::HandleDigitDirective(Token &DigitTok) {
 ///
 void Preprocessor::HandleUserDiagnosticDirective(Token &Tok,
                                                  bool isWarning) {
-  // PTH doesn't emit #warning or #error directives.
-  if (CurPTHLexer)
-    return CurPTHLexer->DiscardToEndOfLine();
-
   // Read the rest of the line raw.  We do this because we don't want macros
   // to be expanded and we don't require that the tokens be valid preprocessing
   // tokens.  For example, this is allowed: "#warning `   'foo".  GCC does
   // collapse multiple consequtive white space between tokens, but this isn't
   // specified by the standard.
   SmallString<128> Message;
-  CurLexer->ReadToEndOfLine(&Message);
+  if (CurLexer)
+    CurLexer->ReadToEndOfLine(&Message);
+  else if (!CurPTHLexer->ReadToEndOfLine(Message))
+    // PTH doesn't emit #warning or #error directives without the source.
+    return;
 
   // Find the first non-whitespace character, so that we can make the
   // diagnostic more succinct.
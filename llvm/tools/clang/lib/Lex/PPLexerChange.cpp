@@ -16,6 +16,7 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/MacroInfo.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -82,6 +83,17 @@ bool Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
       return false;
     }
   }
+
+  // Read the tokens of a header from the header token cache.  The cached
+  // tokens hold no comments nor code completion point, and the end of the
+  // file of a module is only formed by a Lexer.
+  if (HeaderTokens && FID != SourceMgr.getMainFileID() && !KeepComments &&
+      !isCodeCompletionEnabled() && !getLangOpts().Modules) {
+    if (PTHLexer *PL = HeaderTokens->CreateLexer(FID)) {
+      EnterSourceFileWithPTH(PL, CurDir);
+      return false;
+    }
+  }
   
   // Get the MemoryBuffer for this FID, if it fails, we fail.
   bool Invalid = false;
@@ -261,6 +273,10 @@ void Preprocessor::PropagateLineStartLeadingSpaceInfo(Token &Result) {
     CurLexer->PropagateLineStartLeadingSpaceInfo(Result);
     return;
   }
+  if (CurPTHLexer) {
+    CurPTHLexer->PropagateLineStartLeadingSpaceInfo(Result);
+    return;
+  }
   // FIXME: Handle other kinds of lexers?  It generally shouldn't matter,
   // but it might if they're empty?
 }
@@ -295,6 +311,10 @@ bool Preprocessor::HandleEndOfFile(Token &Result, bool isEndOfMacro) {
   assert(!CurTokenLexer &&
          "Ending a file when currently in a macro!");
 
+  // A header lexed from the source can now be stored in the token cache.
+  if (HeaderTokens && CurLexer)
+    HeaderTokens->ExitSourceFile(*CurLexer);
+
   // See if this file had a controlling macro.
   if (CurPPLexer) {  // Not ending a macro, ignore it.
     if (const IdentifierInfo *ControllingMacro =
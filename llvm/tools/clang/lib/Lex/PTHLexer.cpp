@@ -34,10 +34,13 @@ static const unsigned StoredTokenSize = 1 + 1 + 2 + 4 + 4;
 // PTHLexer methods.
 //===----------------------------------------------------------------------===//
 
+PTHTokenSource::~PTHTokenSource() {}
+
 PTHLexer::PTHLexer(Preprocessor &PP, FileID FID, const unsigned char *D,
-                   const unsigned char *ppcond, PTHManager &PM)
+                   const unsigned char *ppcond, PTHTokenSource &S)
   : PreprocessorLexer(&PP, FID), TokBuf(D), CurPtr(D), LastHashTokPtr(nullptr),
-    PPCond(ppcond), CurPPCondPtr(ppcond), PTHMgr(PM) {
+    PPCond(ppcond), CurPPCondPtr(ppcond), PropagatedFlags(0),
+    Source(S) {
 
   FileStartLoc = PP.getSourceManager().getLocForStartOfFile(FID);
 }
@@ -71,17 +74,22 @@ bool PTHLexer::Lex(Token& Tok) {
   Tok.startToken();
   Tok.setKind(TKind);
   Tok.setFlag(TFlags);
+  if (PropagatedFlags) {
+    Tok.setFlag((Token::TokenFlags) PropagatedFlags);
+    PropagatedFlags = 0;
+  }
   assert(!LexingRawMode);
   Tok.setLocation(FileStartLoc.getLocWithOffset(FileOffset));
   Tok.setLength(Len);
 
   // Handle identifiers.
   if (Tok.isLiteral()) {
-    Tok.setLiteralData((const char*) (PTHMgr.SpellingBase + IdentifierID));
+    Tok.setLiteralData((const char*) (Source.getSpellingBase() +
+                                      IdentifierID));
   }
   else if (IdentifierID) {
     MIOpt.ReadToken();
-    IdentifierInfo *II = PTHMgr.GetIdentifierInfo(IdentifierID-1);
+    IdentifierInfo *II = Source.GetIdentifierInfo(IdentifierID-1);
 
     Tok.setIdentifierInfo(II);
 
@@ -108,7 +116,7 @@ bool PTHLexer::Lex(Token& Tok) {
     return LexEndOfFile(Tok);
   }
 
-  if (TKind == tok::hash && Tok.isAtStartOfLine()) {
+  if (TKind == tok::hash && (TFlags & Token::StartOfLine)) {
     LastHashTokPtr = CurPtr - StoredTokenSize;
     assert(!LexingRawMode);
     PP->HandleDirective(Tok);
@@ -126,6 +134,16 @@ bool PTHLexer::Lex(Token& Tok) {
   return true;
 }
 
+void PTHLexer::PropagateLineStartLeadingSpaceInfo(Token &Result) {
+  PropagatedFlags = 0;
+  if (Result.isAtStartOfLine())
+    PropagatedFlags |= Token::StartOfLine;
+  if (Result.hasLeadingSpace())
+    PropagatedFlags |= Token::LeadingSpace;
+  if (Result.hasLeadingEmptyMacro())
+    PropagatedFlags |= Token::LeadingEmptyMacro;
+}
+
 bool PTHLexer::LexEndOfFile(Token &Result) {
   // If we hit the end of the file while parsing a preprocessor directive,
   // end the preprocessor directive first.  The next token returned will
@@ -184,6 +202,46 @@ void PTHLexer::DiscardToEndOfLine() {
   CurPtr = p;
 }
 
+bool PTHLexer::ReadToEndOfLine(SmallVectorImpl<char> &Result) {
+  using namespace llvm::support;
+  assert(CurPtr != TokBuf && "No directive name read yet!");
+
+  // The line is read from the end of the last token read, the name of the
+  // directive, as the token data does not hold the text of #error and
+  // #warning directives.
+  const unsigned char *LastTokPtr = CurPtr - StoredTokenSize;
+  uint32_t Len = endian::readNext<uint32_t, little, aligned>(LastTokPtr) >> 16;
+  LastTokPtr += sizeof(uint32_t);
+  uint32_t Offset = endian::readNext<uint32_t, little, aligned>(LastTokPtr);
+
+  bool Invalid = false;
+  StringRef Buffer =
+      PP->getSourceManager().getBufferData(getFileID(), &Invalid);
+  if (Invalid) {
+    DiscardToEndOfLine();
+    return false;
+  }
+
+  for (unsigned I = Offset + Len, E = Buffer.size(); I < E; ++I) {
+    char C = Buffer[I];
+    // Skip escaped newlines, including \r\n and \n\r.
+    if (C == '\\' && I + 1 < E &&
+        (Buffer[I + 1] == '\n' || Buffer[I + 1] == '\r')) {
+      ++I;
+      if (I + 1 < E && (Buffer[I + 1] == '\n' || Buffer[I + 1] == '\r') &&
+          Buffer[I + 1] != Buffer[I])
+        ++I;
+      continue;
+    }
+    if (C == '\n' || C == '\r')
+      break;
+    Result.push_back(C);
+  }
+
+  DiscardToEndOfLine();
+  return true;
+}
+
 /// SkipBlock - Used by Preprocessor to skip the current conditional block.
 bool PTHLexer::SkipBlock() {
   using namespace llvm::support;
@@ -293,6 +351,20 @@ SourceLocation PTHLexer::getSourceLocation() {
 
   const unsigned char *OffsetPtr = CurPtr + (StoredTokenSize - 4);
   uint32_t Offset = endian::readNext<uint32_t, little, aligned>(OffsetPtr);
+
+  // After a directive, the Lexer is at the start of the next line.  The eod
+  // tokens of the header token cache are at the newline, and end there; those
+  // of PTH files are at the next token.
+  if (CurPtr != TokBuf) {
+    const unsigned char *EodPtr = CurPtr - StoredTokenSize;
+    uint32_t Word0 = endian::readNext<uint32_t, little, aligned>(EodPtr);
+    EodPtr += sizeof(uint32_t);
+    uint32_t EodEnd = endian::readNext<uint32_t, little, aligned>(EodPtr) +
+                      (Word0 >> 16);
+    if ((tok::TokenKind)(Word0 & 0xFF) == tok::eod && EodEnd <= Offset)
+      Offset = EodEnd;
+  }
+
   return FileStartLoc.getLocWithOffset(Offset);
 }
 
@@ -419,10 +491,11 @@ PTHManager::PTHManager(
     std::unique_ptr<IdentifierInfo *[], llvm::FreeDeleter> perIDCache,
     std::unique_ptr<PTHStringIdLookup> stringIdLookup, unsigned numIds,
     const unsigned char *spellingBase, const char *originalSourceFile)
-    : Buf(std::move(buf)), PerIDCache(std::move(perIDCache)),
+    : PTHTokenSource(spellingBase), Buf(std::move(buf)),
+      PerIDCache(std::move(perIDCache)),
       FileLookup(std::move(fileLookup)), IdDataTable(idDataTable),
       StringIdLookup(std::move(stringIdLookup)), NumIds(numIds), PP(nullptr),
-      SpellingBase(spellingBase), OriginalSourceFile(originalSourceFile) {}
+      OriginalSourceFile(originalSourceFile) {}
 
 PTHManager::~PTHManager() {
 }
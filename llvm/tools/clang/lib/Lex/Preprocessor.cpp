@@ -33,6 +33,7 @@
 #include "clang/Lex/CodeCompletionHandler.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/LiteralSupport.h"
 #include "clang/Lex/MacroArgs.h"
@@ -202,6 +203,11 @@ void Preprocessor::setPTHManager(PTHManager* pm) {
   FileMgr.addStatCache(PTH->createStatCache());
 }
 
+void Preprocessor::setHeaderTokenCache(
+    std::unique_ptr<HeaderTokenCache> Cache) {
+  HeaderTokens = std::move(Cache);
+}
+
 void Preprocessor::DumpToken(const Token &Tok, bool DumpFlags) const {
   llvm::errs() << tok::getTokenName(Tok.getKind()) << " '"
                << getSpelling(Tok) << "'";
@@ -273,6 +279,9 @@ void Preprocessor::PrintStats() {
                << llvm::capacity_in_bytes(PoisonReasons);
   llvm::errs() << "\n  Comment Handlers: "
                << llvm::capacity_in_bytes(CommentHandlers) << "\n";
+
+  if (HeaderTokens)
+    HeaderTokens->PrintStats();
 }
 
 Preprocessor::macro_iterator
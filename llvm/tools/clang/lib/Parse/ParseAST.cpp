@@ -17,6 +17,7 @@
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/ExternalASTSource.h"
 #include "clang/AST/Stmt.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Parse/ParseDiagnostic.h"
 #include "clang/Parse/Parser.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
@@ -24,6 +25,7 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
 #include <memory>
 
@@ -72,6 +74,60 @@ void PrettyStackTraceParserEntry::print(raw_ostream &OS) const {
   }
 }
 
+/// Records the headers included while parsing as sections of the time trace
+/// (-ftime-trace), so that the trace shows which headers are expensive.
+class TimeTraceIncludes : public PPCallbacks {
+  SourceManager &SM;
+  /// The number of sections opened and not closed yet.
+  unsigned Depth;
+  bool Finished;
+
+public:
+  explicit TimeTraceIncludes(SourceManager &SM)
+      : SM(SM), Depth(0), Finished(false) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Finished)
+      return;
+    if (Reason == EnterFile) {
+      // The main file and the predefines are not included.
+      FileID FID = SM.getFileID(Loc);
+      if (SM.getIncludeLoc(FID).isInvalid())
+        return;
+      const FileEntry *FE = SM.getFileEntryForID(FID);
+      llvm::timeTraceProfilerBegin("Source", FE ? FE->getName()
+                                                : StringRef("<unknown>"));
+      ++Depth;
+    } else if (Reason == ExitFile && Depth) {
+      llvm::timeTraceProfilerEnd();
+      --Depth;
+    }
+  }
+
+  /// Closes the sections of the headers which have not been left, if the
+  /// parser stopped early, and stops recording.
+  void finish() {
+    for (; Depth; --Depth)
+      llvm::timeTraceProfilerEnd();
+    Finished = true;
+  }
+};
+
+/// Calls TimeTraceIncludes::finish on scope exit.
+class FinishTimeTraceIncludes {
+  TimeTraceIncludes *Includes;
+
+public:
+  explicit FinishTimeTraceIncludes(TimeTraceIncludes *Includes)
+      : Includes(Includes) {}
+  ~FinishTimeTraceIncludes() {
+    if (Includes)
+      Includes->finish();
+  }
+};
+
 }  // namespace
 
 //===----------------------------------------------------------------------===//
@@ -120,29 +176,40 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   llvm::CrashRecoveryContextCleanupRegistrar<Parser>
     CleanupParser(ParseOP.get());
 
-  S.getPreprocessor().EnterMainSourceFile();
-  P.Initialize();
-
-  // C11 6.9p1 says translation units must have at least one top-level
-  // declaration. C++ doesn't have this restriction. We also don't want to
-  // complain if we have a precompiled header, although technically if the PCH
-  // is empty we should still emit the (pedantic) diagnostic.
-  Parser::DeclGroupPtrTy ADecl;
-  ExternalASTSource *External = S.getASTContext().getExternalSource();
-  if (External)
-    External->StartTranslationUnit(Consumer);
-
-  if (P.ParseTopLevelDecl(ADecl)) {
-    if (!External && !S.getLangOpts().CPlusPlus)
-      P.Diag(diag::ext_empty_translation_unit);
-  } else {
-    do {
-      // If we got a null return and something *was* parsed, ignore it.  This
-      // is due to a top-level semicolon, an action override, or a parse error
-      // skipping something.
-      if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
-        return;
-    } while (!P.ParseTopLevelDecl(ADecl));
+  {
+    llvm::TimeTraceScope TimeScope("Frontend");
+    TimeTraceIncludes *Includes = nullptr;
+    if (llvm::timeTraceProfilerEnabled()) {
+      Includes = new TimeTraceIncludes(S.getSourceManager());
+      S.getPreprocessor().addPPCallbacks(
+          std::unique_ptr<PPCallbacks>(Includes));
+    }
+    FinishTimeTraceIncludes FinishIncludes(Includes);
+
+    S.getPreprocessor().EnterMainSourceFile();
+    P.Initialize();
+
+    // C11 6.9p1 says translation units must have at least one top-level
+    // declaration. C++ doesn't have this restriction. We also don't want to
+    // complain if we have a precompiled header, although technically if the
+    // PCH is empty we should still emit the (pedantic) diagnostic.
+    Parser::DeclGroupPtrTy ADecl;
+    ExternalASTSource *External = S.getASTContext().getExternalSource();
+    if (External)
+      External->StartTranslationUnit(Consumer);
+
+    if (P.ParseTopLevelDecl(ADecl)) {
+      if (!External && !S.getLangOpts().CPlusPlus)
+        P.Diag(diag::ext_empty_translation_unit);
+    } else {
+      do {
+        // If we got a null return and something *was* parsed, ignore it.
+        // This is due to a top-level semicolon, an action override, or a
+        // parse error skipping something.
+        if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
+          return;
+      } while (!P.ParseTopLevelDecl(ADecl));
+    }
   }
 
   // Process any TopLevelDecls generated by #pragma weak.
@@ -26,6 +26,7 @@
 #include "clang/Sema/Scope.h"
 #include "clang/Sema/SemaDiagnostic.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/TimeProfiler.h"
 using namespace clang;
 
 /// ParseNamespace - We know that the current token is a namespace keyword. This
@@ -2629,6 +2630,11 @@ void Parser::ParseCXXMemberSpecification(SourceLocation RecordLoc,
 
   PrettyDeclStackTraceEntry CrashInfo(Actions, TagDecl, RecordLoc,
                                       "parsing struct/union/class body");
+  llvm::TimeTraceScope TimeScope("ParseClass", [&]() -> std::string {
+    if (const NamedDecl *ND = dyn_cast_or_null<NamedDecl>(TagDecl))
+      return ND->getQualifiedNameAsString();
+    return std::string("<anonymous>");
+  });
 
   // Determine whether this is a non-nested class. Note that local
   // classes are *not* considered to be nested classes.
@@ -9,82 +9,218 @@
 //
 // This file defines PathCondExtractor, which prints out path conditions
 // for each return code.
+//
+// By default the conditions are reported through the BugReporter and
+// llvm::errs() once a top level function has been analyzed. With
+// '-analyzer-config pathcond-stream=<file>' they are instead appended to
+// <file> as the binary records described in PathCondStream.h, as soon as a
+// return is reached.
+//
+// Paths reaching the returns of a function share most of their constraints
+// and historical events, so every distinct @CONDITION and @LOG_* line is
+// rendered once per top level function and a path is kept as a list of
+// fragment numbers.
+//
+// With '-analyzer-config pathcond-summaries=true' the top level functions are
+// analyzed callees first, and the paths reaching the returns of a function
+// are also recorded as a summary (see PathCondSummary.h), which is applied at
+// the call sites of the function instead of inlining it.
 //===----------------------------------------------------------------------===//
 
 #include "ClangSACheckers.h"
+#include "PathCondSummary.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
 #include "clang/StaticAnalyzer/Core/BugReporter/BugType.h"
 #include "clang/StaticAnalyzer/Core/Checker.h"
 #include "clang/StaticAnalyzer/Core/CheckerManager.h"
+#include "clang/StaticAnalyzer/Core/PathCondStream.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/CallEvent.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/CheckerContext.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/FssStmtPrinter.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <memory>
 #include <utility>
+#include <vector>
 
 using namespace clang;
 using namespace ento;
 
 namespace {
-class PathCondExtractor : public Checker< check::PreStmt<ReturnStmt>, 
-                                          check::PreStmt<BinaryOperator>,
-                                          check::PreStmt<UnaryOperator>,
-                                          check::PreStmt<CallExpr>,
-                                          check::EndFunction,
-                                          check::EndAnalysis > {
+/// The operators recorded as historical events; the others are filtered out
+/// by the checker manager before calling the checker.
+static bool isAssignment(const BinaryOperator *BO) {
+  return HistoricalEvent::getKind(BO) == HistoricalEvent::BO_ASSIGN;
+}
+static bool isAssignment(const UnaryOperator *UO) {
+  return HistoricalEvent::getKind(UO) == HistoricalEvent::UO_ASSIGN;
+}
+
+/// Orders constraints by the symbols they constrain, in the order the
+/// symbols were created, which unlike their addresses does not depend on
+/// the allocations of the analysis.
+static bool compareConstraintKeys(const ConstraintManager::ConstraintKey &A,
+                                  const ConstraintManager::ConstraintKey &B) {
+  return A.first->getSymbolID() < B.first->getSymbolID();
+}
+
+class PathCondExtractor
+  : public Checker< check::PreStmt<ReturnStmt>,
+                    check::PreStmtIf<BinaryOperator, isAssignment>,
+                    check::PreStmtIf<UnaryOperator, isAssignment>,
+                    check::PreStmt<CallExpr>,
+                    check::EndFunction,
+                    check::EndAnalysis,
+                    eval::Call > {
 public:
-  PathCondExtractor();
+  PathCondExtractor(AnalyzerOptions &Opts);
   void checkPreStmt(const ReturnStmt *RS, CheckerContext &C) const;
   void checkPreStmt(const BinaryOperator *BO, CheckerContext &C) const; 
   void checkPreStmt(const UnaryOperator *UO, CheckerContext &C) const;
   void checkPreStmt(const CallExpr *CE, CheckerContext &C) const;
   void checkEndFunction(CheckerContext &C) const;
   void checkEndAnalysis(ExplodedGraph &G, BugReporter &BR, ExprEngine &N) const;
+  bool evalCall(const CallExpr *CE, CheckerContext &C) const;
 private:
   // Bug type 
   std::unique_ptr<BugType> PathCondReportType;
 
+  // A path condition, as the fragment numbers of its lines.
+  typedef llvm::SmallVector<unsigned, 16> FragmentListTy;
+
   // RetMap = {return location + return value, 
   //               {path condition, node}* }*
-  typedef std::pair<std::string, ExplodedNode *> RetCondPairTy; 
+  typedef std::pair<FragmentListTy, ExplodedNode *> RetCondPairTy; 
   typedef llvm::SmallVector<RetCondPairTy, 16> RetCondsTy;
   typedef llvm::StringMap<RetCondsTy> RetMapTy;
   mutable RetMapTy RetMap;
 
+  // Binary record stream, if requested. The records of a top level function
+  // are collected in StreamBuf and appended to StreamFile in a single write,
+  // so that concurrent analyzer processes can share the file.
+  std::unique_ptr<llvm::raw_fd_ostream> StreamFile;
+  mutable std::string StreamBuf;
+  mutable llvm::raw_string_ostream StreamOS;
+  mutable PathCondStreamWriter Stream;
+
+  // Signature numbers of the current top level function in the stream.
+  mutable llvm::StringMap<unsigned> StreamSigIDs;
+  mutable bool InStreamFunction;
+  // Fragments [0, NumStreamedFragments) have been written to the stream.
+  mutable unsigned NumStreamedFragments;
+
+  // Fragments of the current top level function. FragmentIDs hash-conses
+  // the text; Fragments maps a fragment number back to it.
+  mutable llvm::StringMap<unsigned> FragmentIDs;
+  mutable std::vector<StringRef> Fragments;
+
+  // Rendered constraints, keyed by symbol and range set, and rendered
+  // historical events. The states the keys came from are retained in
+  // FragmentStates, so that the addresses used as keys are not reused by
+  // other range sets or events.
+  typedef ConstraintManager::ConstraintKey ConstraintKey;
+  mutable llvm::DenseMap<ConstraintKey, unsigned> ConstraintFragments;
+  mutable llvm::DenseMap<const HistoricalEvent *, unsigned> EventFragments;
+  mutable std::vector<ProgramStateRef> FragmentStates;
+
+  // Return path summaries, in 'pathcond-summaries' mode. CurSummary collects
+  // the paths of the top level function SummaryFD.
+  std::unique_ptr<pathcond::SummaryStore> Summaries;
+  mutable const FunctionDecl *SummaryFD;
+  mutable pathcond::Summary CurSummary;
+
 private: 
   void emitPathInfo(CheckerContext &C,
                     const FunctionDecl *FD, 
                     const ReturnStmt *RS,
                     ExplodedNode *N) const;
-  void addToRetCond(const std::string &Key, 
-                    const std::string &Value, 
+  void addToRetCond(StringRef Key,
+                    const FragmentListTy &Value,
                     ExplodedNode  *N) const;
-  void condcat(llvm::raw_string_ostream &OS, RetCondsTy &Conds) const;
+  void addToStream(const FunctionDecl *FD, StringRef Key,
+                   const FragmentListTy &Value) const;
+  void flushStream() const;
+  unsigned internFragment(StringRef Text) const;
+  void clearFragments() const;
+  void condcat(llvm::raw_string_ostream &OS, StringRef Key,
+               const RetCondsTy &Conds) const;
   void getRetSig(llvm::raw_string_ostream &OS, const FunctionDecl *FD,
                  const ReturnStmt *RS, CheckerContext &C) const;
-  bool getPathCond(llvm::raw_string_ostream &OS, const FunctionDecl *FD,
-                   std::string &Sig, CheckerContext &C) const;
-  int getFunctionSummary(llvm::raw_string_ostream &OS, const FunctionDecl *FD,
+  bool getPathCond(FragmentListTy &Frags, const FunctionDecl *FD,
+                   CheckerContext &C) const;
+  int getFunctionSummary(FragmentListTy &Frags, const FunctionDecl *FD,
                          CheckerContext &C) const;
+  void addToSummary(CheckerContext &C, const FunctionDecl *FD,
+                    const ReturnStmt *RS, ArrayRef<unsigned> EventFrags) const;
   bool isInBlackList(CheckerContext &C, const FunctionDecl *FD) const;
 
   mutable IdentifierInfo *II___builtin_expect;
 };
 } // end anonymous namespace
 
-PathCondExtractor::PathCondExtractor() 
-  : II___builtin_expect(nullptr) {
+// The summary paths applied at the calls along a path, most recent first.
+REGISTER_LIST_WITH_PROGRAMSTATE(AppliedSummaryPaths,
+                                const pathcond::SummaryPath *)
+
+PathCondExtractor::PathCondExtractor(AnalyzerOptions &Opts)
+  : StreamOS(StreamBuf), Stream(StreamOS), InStreamFunction(false),
+    NumStreamedFragments(0), SummaryFD(nullptr),
+    II___builtin_expect(nullptr) {
   PathCondReportType.reset(
   new BugType(this, "Return path condition", "fs-semantics path condition extractor"));
+  // The conditions are only consumed as text.
+  PathCondReportType->setMessageOnly(true);
+
+  StringRef StreamPath = Opts.getOptionAsString("pathcond-stream", "");
+  if (!StreamPath.empty()) {
+    std::error_code EC;
+    StreamFile.reset(new llvm::raw_fd_ostream(StreamPath, EC,
+                                              llvm::sys::fs::F_Append));
+    if (EC) {
+      llvm::errs() << "Error opening '" << StreamPath << "': "
+                   << EC.message() << '\n';
+      StreamFile.reset();
+    } else {
+      // Write every function block with a single write(), which the other
+      // processes appending to the file cannot interleave with their own.
+      StreamFile->SetUnbuffered();
+      StreamFile->SetUseAtomicWrites(true);
+    }
+  }
+
+  if (Opts.shouldUsePathCondSummaries())
+    Summaries.reset(new pathcond::SummaryStore(
+        Opts.getOptionAsString("pathcond-summary-dir", "")));
 }
 
-void PathCondExtractor::addToRetCond(const std::string &Key, 
-                                     const std::string &Value, 
+void PathCondExtractor::addToRetCond(StringRef Key,
+                                     const FragmentListTy &Value,
                                      ExplodedNode *N) const {
   RetMap[Key].push_back( std::make_pair(Value, N) );
 }
 
+unsigned PathCondExtractor::internFragment(StringRef Text) const {
+  std::pair<llvm::StringMap<unsigned>::iterator, bool> Res =
+    FragmentIDs.insert(std::make_pair(Text, (unsigned)Fragments.size()));
+  if (Res.second)
+    Fragments.push_back(Res.first->getKey());
+  return Res.first->second;
+}
+
+void PathCondExtractor::clearFragments() const {
+  FragmentIDs.clear();
+  Fragments.clear();
+  ConstraintFragments.clear();
+  EventFragments.clear();
+  FragmentStates.clear();
+  NumStreamedFragments = 0;
+}
+
 static 
 void GetFuncName(llvm::raw_string_ostream &OS, const FunctionDecl *FD) {
   OS << FD->getDeclName().getAsString() << '('; 
@@ -103,6 +239,42 @@ void GetFuncName(llvm::raw_string_ostream &OS, const FunctionDecl *FD) {
   OS << ')';
 }
 
+void PathCondExtractor::addToStream(const FunctionDecl *FD,
+                                    StringRef Key,
+                                    const FragmentListTy &Value) const {
+  if (!InStreamFunction) {
+    std::string FuncName;
+    llvm::raw_string_ostream FS(FuncName);
+    GetFuncName(FS, FD);
+    Stream.writeBeginFunction(FS.str());
+    InStreamFunction = true;
+  }
+
+  for (unsigned E = Fragments.size(); NumStreamedFragments != E;
+       ++NumStreamedFragments)
+    Stream.writeFragment(Fragments[NumStreamedFragments]);
+
+  unsigned NextID = StreamSigIDs.size();
+  std::pair<llvm::StringMap<unsigned>::iterator, bool> Res =
+    StreamSigIDs.insert(std::make_pair(Key, NextID));
+  if (Res.second)
+    Stream.writeSignature(Key);
+  Stream.writePath(Res.first->second, Value);
+}
+
+void PathCondExtractor::flushStream() const {
+  if (!InStreamFunction)
+    return;
+
+  Stream.writeEndFunction();
+  StreamOS.flush();
+  StreamFile->write(StreamBuf.data(), StreamBuf.size());
+
+  StreamBuf.clear();
+  StreamSigIDs.clear();
+  InStreamFunction = false;
+}
+
 void PathCondExtractor::getRetSig(llvm::raw_string_ostream &OS,
                                   const FunctionDecl *FD,
                                   const ReturnStmt *RS, 
@@ -127,27 +299,39 @@ void PathCondExtractor::getRetSig(llvm::raw_string_ostream &OS,
   }
 }
 
-bool PathCondExtractor::getPathCond(llvm::raw_string_ostream &OS,
+bool PathCondExtractor::getPathCond(FragmentListTy &Frags,
                                     const FunctionDecl *FD, 
-                                    std::string &Sig, 
                                     CheckerContext &C) const {
   ProgramStateRef State = C.getState();
   ProgramStateManager &Mgr = State->getStateManager();
   ConstraintManager &ConstMgr = Mgr.getConstraintManager();
-  bool rc;
 
-  OS << "\n@LOCATION: " << Sig;
-  OS << "\n";
-
-  if (!FD->getReturnType()->isVoidType()) {
-    ConstMgr.print(C, State, OS);
-    rc = true;
+  if (FD->getReturnType()->isVoidType()) {
+    Frags.push_back(internFragment("@CONDITION: nil\n"));
+    return false;
   }
-  else {
-    OS << "@CONDITION: nil\n";
-    rc = false;
+
+  SmallVector<ConstraintKey, 16> Keys;
+  ConstMgr.getConstraintKeys(State, Keys);
+  std::sort(Keys.begin(), Keys.end(), compareConstraintKeys);
+  if (Keys.empty())
+    Frags.push_back(internFragment("@CONDITION: nil\n"));
+
+  for (SmallVectorImpl<ConstraintKey>::const_iterator I = Keys.begin(),
+         E = Keys.end(); I != E; ++I) {
+    llvm::DenseMap<ConstraintKey, unsigned>::iterator CI =
+      ConstraintFragments.find(*I);
+    if (CI == ConstraintFragments.end()) {
+      std::string Cond;
+      llvm::raw_string_ostream CS(Cond);
+      ConstMgr.printConstraint(State, I->first, CS);
+      CI = ConstraintFragments.insert(
+             std::make_pair(*I, internFragment(CS.str()))).first;
+      FragmentStates.push_back(State);
+    }
+    Frags.push_back(CI->second);
   }
-  return rc;
+  return true;
 }
 
 
@@ -165,23 +349,54 @@ const char *getHistoricalEventKindString(const HistoricalEvent *hxev) {
   }
 }
 
-int PathCondExtractor::getFunctionSummary(llvm::raw_string_ostream &OS,
+int PathCondExtractor::getFunctionSummary(FragmentListTy &Frags,
                                            const FunctionDecl *FD, 
                                            CheckerContext &C) const {
   ProgramStateRef state = C.getState();
+  SmallVector<const HistoricalEvent *, 64> Events;
+  state->getStateManager().getHistoricalEventManager().getHistoricalEvents(
+    C.getPredecessor(), Events);
 
   int i = 0;
-  for (ProgramState::hxev_const_iterator I = state->hxev_begin(),
-         E = state->hxev_end(); I != E; ++I, ++i) {
-    ProgramStateRef hxevState = *I;
-    const HistoricalEvent *hxev = hxevState->getHistoricalEvent();
-
-    FssStmtPrinter Printer(OS, hxev->LCtx, hxevState, 0, true);
-    OS << "@LOG_" << getHistoricalEventKindString(hxev) << ": "; 
-    Printer.Visit(const_cast<Stmt*>(hxev->S));
-    OS << " @LOCATION: " 
-       << hxev->S->getLocStart().printToString( C.getSourceManager() )
-       << '\n';
+  for (SmallVectorImpl<const HistoricalEvent *>::const_iterator
+         I = Events.begin(), E = Events.end(); I != E; ++I, ++i) {
+    const HistoricalEvent *hxev = *I;
+
+    // An event is rendered against the state recording it, so every path
+    // sharing the event renders it the same way.
+    llvm::DenseMap<const HistoricalEvent *, unsigned>::iterator EI =
+      EventFragments.find(hxev);
+    if (EI == EventFragments.end()) {
+      ProgramStateRef hxevState = hxev->getState();
+      std::string Event;
+      llvm::raw_string_ostream OS(Event);
+
+      FssStmtPrinter Printer(OS, hxev->LCtx, hxevState, 0, true);
+      OS << "@LOG_" << getHistoricalEventKindString(hxev) << ": "; 
+      Printer.Visit(const_cast<Stmt*>(hxev->S));
+      OS << " @LOCATION: " 
+         << hxev->S->getLocStart().printToString( C.getSourceManager() )
+         << '\n';
+
+      EI = EventFragments.insert(
+             std::make_pair(hxev, internFragment(OS.str()))).first;
+      FragmentStates.push_back(state);
+    }
+    Frags.push_back(EI->second);
+  }
+
+  // The events of the callees whose summaries were applied follow the events
+  // of the path itself, in the order the calls were made.
+  AppliedSummaryPathsTy Applied = state->get<AppliedSummaryPaths>();
+  SmallVector<const pathcond::SummaryPath *, 8> AppliedPaths;
+  for (AppliedSummaryPathsTy::iterator I = Applied.begin(), E = Applied.end();
+       I != E; ++I)
+    AppliedPaths.push_back(*I);
+  for (SmallVectorImpl<const pathcond::SummaryPath *>::reverse_iterator
+         I = AppliedPaths.rbegin(), E = AppliedPaths.rend(); I != E; ++I) {
+    const std::vector<std::string> &SummaryEvents = (*I)->Events;
+    for (unsigned J = 0, JE = SummaryEvents.size(); J != JE; ++J, ++i)
+      Frags.push_back(internFragment(SummaryEvents[J]));
   }
   return i;
 }
@@ -193,9 +408,6 @@ void PathCondExtractor::checkPreStmt(const BinaryOperator *BO,
     return;
 #endif 
 
-  if ( HistoricalEvent::getKind(BO) != HistoricalEvent::BO_ASSIGN )
-    return;
-
   C.getState()->recordHistoricalEvent(C,
                                       HistoricalEvent::BO_ASSIGN,
                                       static_cast<const Stmt*>(BO));
@@ -208,9 +420,6 @@ void PathCondExtractor::checkPreStmt(const UnaryOperator *UO,
     return;
 #endif
 
-  if ( HistoricalEvent::getKind(UO) != HistoricalEvent::UO_ASSIGN )
-    return;
-
   C.getState()->recordHistoricalEvent(C,
                                       HistoricalEvent::UO_ASSIGN,
                                       static_cast<const Stmt*>(UO));
@@ -253,17 +462,26 @@ void PathCondExtractor::emitPathInfo(CheckerContext &C,
                                      const FunctionDecl *FD, 
                                      const ReturnStmt *RS,
                                      ExplodedNode *N) const {
-  std::string *Key = new std::string;
-  std::string *Value = new std::string;
-  llvm::raw_string_ostream KS(*Key);
-  llvm::raw_string_ostream VS(*Value);
+  std::string Key;
+  llvm::raw_string_ostream KS(Key);
+  FragmentListTy Value;
 
   getRetSig(KS, FD, RS, C);
-  bool havePathCond = getPathCond(VS, FD, KS.str(), C); 
-  int numFuncSummary = getFunctionSummary(VS, FD, C);
 
-  if (havePathCond || numFuncSummary > 0) 
-    addToRetCond(KS.str(), VS.str(), N);
+  bool havePathCond = getPathCond(Value, FD, C); 
+  int numFuncSummary = getFunctionSummary(Value, FD, C);
+
+  if (Summaries)
+    addToSummary(C, FD, RS,
+                 makeArrayRef(Value).slice(Value.size() - numFuncSummary));
+
+  if (!havePathCond && numFuncSummary == 0)
+    return;
+
+  if (StreamFile)
+    addToStream(FD, KS.str(), Value);
+  else
+    addToRetCond(KS.str(), Value, N);
 }
 
 void PathCondExtractor::checkPreStmt(const ReturnStmt *RS,
@@ -293,27 +511,45 @@ void PathCondExtractor::checkEndFunction(CheckerContext &C) const {
 }
 
 void PathCondExtractor::condcat(llvm::raw_string_ostream &OS, 
-                                RetCondsTy &Conds) const {
+                                StringRef Key,
+                                const RetCondsTy &Conds) const {
   for (RetCondsTy::const_iterator CI = Conds.begin(), 
          CE = Conds.end(); CI != CE; ++CI) {
-    OS << CI->first; 
+    OS << "\n@LOCATION: " << Key << "\n";
+    const FragmentListTy &Frags = CI->first;
+    for (unsigned F = 0, FE = Frags.size(); F != FE; ++F)
+      OS << Fragments[Frags[F]];
   }
 }
 
 void PathCondExtractor::checkEndAnalysis(ExplodedGraph &G,
                                          BugReporter &BR,
                                          ExprEngine &N) const {
+  if (SummaryFD) {
+    // The summary of a function whose exploration ran out of nodes would
+    // miss returns; its callers keep inlining it instead.
+    if (N.hasEmptyWorkList())
+      Summaries->add(SummaryFD, CurSummary);
+    SummaryFD = nullptr;
+    CurSummary.Paths.clear();
+  }
+
+  if (StreamFile) {
+    flushStream();
+    clearFragments();
+    return;
+  }
+
   // Print our extracted path conditions
   for (RetMapTy::const_iterator I = RetMap.begin(), 
          E = RetMap.end(); I != E; ++I) {
-    std::string Sig = I->getKey();
-    RetCondsTy Conds = I->second;
+    const RetCondsTy &Conds = I->second;
     ExplodedNode *N = Conds.begin()->second;
 
     std::string PathCond; 
     llvm::raw_string_ostream PS(PathCond); 
     PS << "\n@@<<\n"; 
-    condcat(PS, Conds);
+    condcat(PS, I->getKey(), Conds);
     PS << "\n@@>>\n"; 
 
     BugReport *R = new BugReport(*PathCondReportType, PS.str(), N);
@@ -321,8 +557,179 @@ void PathCondExtractor::checkEndAnalysis(ExplodedGraph &G,
     BR.emitReport(R);
   }
   RetMap.clear();
+  clearFragments();
+}
+
+/// Collects the ranges of values \p V is known to be in. Returns false if
+/// \p V is unconstrained.
+static bool getValueRanges(ProgramStateRef State, SVal V,
+                           pathcond::ValueRangesTy &Ranges) {
+  if (Optional<nonloc::ConcreteInt> CI = V.getAs<nonloc::ConcreteInt>()) {
+    Ranges.push_back(ConstraintManager::ValueRange(CI->getValue(),
+                                                   CI->getValue()));
+    return true;
+  }
+  if (Optional<loc::ConcreteInt> CI = V.getAs<loc::ConcreteInt>()) {
+    Ranges.push_back(ConstraintManager::ValueRange(CI->getValue(),
+                                                   CI->getValue()));
+    return true;
+  }
+
+  SymbolRef Sym = V.getAsSymbol();
+  if (!Sym)
+    return false;
+  ConstraintManager &CM = State->getStateManager().getConstraintManager();
+  return CM.getSymbolRanges(State, Sym, Ranges);
+}
+
+void PathCondExtractor::addToSummary(CheckerContext &C,
+                                     const FunctionDecl *FD,
+                                     const ReturnStmt *RS,
+                                     ArrayRef<unsigned> EventFrags) const {
+  ProgramStateRef State = C.getState();
+  const LocationContext *LCtx = C.getLocationContext();
+  pathcond::SummaryPath P;
+
+  if (const Expr *RE = RS ? RS->getRetValue() : nullptr)
+    getValueRanges(State, State->getSVal(RE, LCtx), P.Ret);
+
+  // The parameters are constrained through the symbols of their initial
+  // values.
+  SValBuilder &SVB = C.getSValBuilder();
+  for (unsigned I = 0, E = FD->getNumParams(); I != E; ++I) {
+    const ParmVarDecl *PVD = FD->getParamDecl(I);
+    QualType T = PVD->getType();
+    if (!T->isIntegralOrEnumerationType() && !Loc::isLocType(T))
+      continue;
+
+    pathcond::ValueRangesTy Ranges;
+    SVal Init = SVB.getRegionValueSymbolVal(State->getRegion(PVD, LCtx));
+    if (getValueRanges(State, Init, Ranges))
+      P.Params.push_back(std::make_pair(I, Ranges));
+  }
+
+  for (unsigned I = 0, E = EventFrags.size(); I != E; ++I)
+    P.Events.push_back(Fragments[EventFrags[I]].str());
+
+  SummaryFD = FD;
+  CurSummary.addPath(P);
+}
+
+static ProgramStateRef assumeCompare(CheckerContext &C, ProgramStateRef St,
+                                     NonLoc V, BinaryOperatorKind Op,
+                                     const llvm::APSInt &X) {
+  if (!St)
+    return St;
+  SValBuilder &SVB = C.getSValBuilder();
+  SVal Cond = SVB.evalBinOpNN(St, Op, V, SVB.makeIntVal(X),
+                              SVB.getConditionType());
+  if (Optional<DefinedSVal> DC = Cond.getAs<DefinedSVal>())
+    return St->assume(*DC, true);
+  return St;
+}
+
+/// Constrains \p V, of type \p T, to the union of \p Ranges. Only gaps of
+/// a single value between the ranges are excluded, and pointers are only
+/// told apart from null, so wider gaps are over-approximated.
+static ProgramStateRef assumeInRanges(CheckerContext &C, ProgramStateRef St,
+                                      SVal V, QualType T,
+                                      const pathcond::ValueRangesTy &Ranges) {
+  if (!St || Ranges.empty())
+    return St;
+
+  if (Optional<Loc> L = V.getAs<Loc>()) {
+    llvm::APSInt Zero(Ranges[0].first.getBitWidth(),
+                      Ranges[0].first.isUnsigned());
+    bool MayBeNull = false, MayBeNonNull = false;
+    for (unsigned I = 0, E = Ranges.size(); I != E; ++I) {
+      const ConstraintManager::ValueRange &R = Ranges[I];
+      if (R.first <= Zero && Zero <= R.second)
+        MayBeNull = true;
+      if (R.first != Zero || R.second != Zero)
+        MayBeNonNull = true;
+    }
+    if (MayBeNull && MayBeNonNull)
+      return St;
+    return St->assume(*L, MayBeNonNull);
+  }
+
+  Optional<NonLoc> NV = V.getAs<NonLoc>();
+  if (!NV || !T->isIntegralOrEnumerationType())
+    return St;
+
+  // Bounds outside of the type of V are clamped to it.
+  APSIntType Ty = C.getSValBuilder().getBasicValueFactory().getAPSIntType(T);
+  llvm::APSInt Min = Ranges.front().first, Max = Ranges.back().second;
+  APSIntType::RangeTestResultKind MinTest = Ty.testInRange(Min, true);
+  APSIntType::RangeTestResultKind MaxTest = Ty.testInRange(Max, true);
+  if (MinTest == APSIntType::RTR_Above || MaxTest == APSIntType::RTR_Below)
+    return nullptr;
+  Min = MinTest == APSIntType::RTR_Below ? Ty.getMinValue() : Ty.convert(Min);
+  Max = MaxTest == APSIntType::RTR_Above ? Ty.getMaxValue() : Ty.convert(Max);
+
+  St = assumeCompare(C, St, *NV, BO_GE, Min);
+  St = assumeCompare(C, St, *NV, BO_LE, Max);
+  for (unsigned I = 1, E = Ranges.size(); St && I != E; ++I) {
+    llvm::APSInt Gap = Ranges[I - 1].second;
+    ++Gap;
+    llvm::APSInt Next = Gap;
+    ++Next;
+    if (Next == Ranges[I].first &&
+        Ty.testInRange(Gap, true) == APSIntType::RTR_Within)
+      St = assumeCompare(C, St, *NV, BO_NE, Ty.convert(Gap));
+  }
+  return St;
+}
+
+bool PathCondExtractor::evalCall(const CallExpr *CE, CheckerContext &C) const {
+  if (!Summaries)
+    return false;
+
+  // Leave the library functions to the checkers modeling them.
+  const FunctionDecl *FD = C.getCalleeDecl(CE);
+  if (!FD || FD->getBuiltinID() || isInBlackList(C, FD))
+    return false;
+  const pathcond::Summary *S = Summaries->lookup(FD);
+  if (!S)
+    return false;
+
+  ProgramStateRef State = C.getState();
+  const LocationContext *LCtx = C.getLocationContext();
+  CallEventRef<> Call =
+    C.getStateManager().getCallEventManager().getSimpleCall(CE, State, LCtx);
+  QualType ResultTy = Call->getResultType();
+  SVal RetVal = C.getSValBuilder().conjureSymbolVal(nullptr, CE, LCtx,
+                                                    ResultTy, C.blockCount());
+
+  // Every path of the summary which is feasible for the arguments becomes a
+  // successor of the call. The regions reachable from the arguments and the
+  // globals are invalidated as for a call which is not inlined.
+  for (std::vector<pathcond::SummaryPath>::const_iterator
+         I = S->Paths.begin(), E = S->Paths.end(); I != E; ++I) {
+    const pathcond::SummaryPath &P = *I;
+    ProgramStateRef St = State;
+    for (unsigned J = 0, JE = P.Params.size(); St && J != JE; ++J) {
+      unsigned Idx = P.Params[J].first;
+      if (Idx >= CE->getNumArgs())
+        continue;
+      const Expr *Arg = CE->getArg(Idx);
+      St = assumeInRanges(C, St, St->getSVal(Arg, LCtx), Arg->getType(),
+                          P.Params[J].second);
+    }
+    if (!St)
+      continue;
+
+    St = Call->invalidateRegions(C.blockCount(), St);
+    St = St->BindExpr(CE, LCtx, RetVal);
+    St = assumeInRanges(C, St, RetVal, ResultTy, P.Ret);
+    if (!St)
+      continue;
+
+    C.addTransition(St->add<AppliedSummaryPaths>(&P));
+  }
+  return true;
 }
 
 void ento::registerPathCondExtractor(CheckerManager &mgr) {
-  mgr.registerChecker<PathCondExtractor>();
+  mgr.registerChecker<PathCondExtractor>(mgr.getAnalyzerOptions());
 }
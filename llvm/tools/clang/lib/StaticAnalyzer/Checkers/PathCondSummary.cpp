@@ -0,0 +1,292 @@
+//== PathCondSummary.cpp - Return path summaries ----------------*- C++ -*--==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the store of the return path summaries computed by
+//  PathCondExtractor. A summary file is a text file:
+//
+//    PCSUM 1
+//    path
+//    ret s32:-5:-1 s32:1:1
+//    param 0 u64:1:18446744073709551615
+//    event @LOG_CALL: ...
+//
+//  with a "path" line starting every path, the return value and parameter
+//  ranges as <signedness><bits>:<min>:<max>, and the event lines with '\' and
+//  newlines escaped.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PathCondSummary.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/StaticAnalyzer/Core/FunctionDigest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace ento;
+using namespace pathcond;
+
+static const char SummaryMagic[] = "PCSUM 1";
+
+//===----------------------------------------------------------------------===//
+// Summary
+//===----------------------------------------------------------------------===//
+
+static bool isSameRanges(const ValueRangesTy &LHS, const ValueRangesTy &RHS) {
+  if (LHS.size() != RHS.size())
+    return false;
+  for (unsigned I = 0, E = LHS.size(); I != E; ++I)
+    if (!llvm::APSInt::isSameValue(LHS[I].first, RHS[I].first) ||
+        !llvm::APSInt::isSameValue(LHS[I].second, RHS[I].second))
+      return false;
+  return true;
+}
+
+bool SummaryPath::operator==(const SummaryPath &RHS) const {
+  if (!isSameRanges(Ret, RHS.Ret) || Params.size() != RHS.Params.size() ||
+      Events != RHS.Events)
+    return false;
+  for (unsigned I = 0, E = Params.size(); I != E; ++I)
+    if (Params[I].first != RHS.Params[I].first ||
+        !isSameRanges(Params[I].second, RHS.Params[I].second))
+      return false;
+  return true;
+}
+
+void Summary::addPath(const SummaryPath &P) {
+  for (unsigned I = 0, E = Paths.size(); I != E; ++I)
+    if (Paths[I] == P)
+      return;
+  Paths.push_back(P);
+}
+
+//===----------------------------------------------------------------------===//
+// Summary files
+//===----------------------------------------------------------------------===//
+
+static void printRanges(raw_ostream &OS, const ValueRangesTy &Ranges) {
+  for (unsigned I = 0, E = Ranges.size(); I != E; ++I) {
+    const llvm::APSInt &Min = Ranges[I].first;
+    const llvm::APSInt &Max = Ranges[I].second;
+    OS << ' ' << (Min.isUnsigned() ? 'u' : 's') << Min.getBitWidth() << ':'
+       << Min.toString(10) << ':' << Max.toString(10);
+  }
+}
+
+static bool parseRanges(StringRef Text, ValueRangesTy &Ranges) {
+  SmallVector<StringRef, 4> Tokens;
+  Text.split(Tokens, " ", -1, false);
+  for (unsigned I = 0, E = Tokens.size(); I != E; ++I) {
+    StringRef Type, Min, Max;
+    std::tie(Type, Max) = Tokens[I].split(':');
+    std::tie(Min, Max) = Max.split(':');
+    unsigned Bits;
+    if (Type.size() < 2 || (Type[0] != 's' && Type[0] != 'u') ||
+        Type.drop_front().getAsInteger(10, Bits) || Bits == 0 ||
+        Min.empty() || Max.empty())
+      return false;
+    bool IsUnsigned = Type[0] == 'u';
+    Ranges.push_back(ConstraintManager::ValueRange(
+        llvm::APSInt(llvm::APInt(Bits, Min, 10), IsUnsigned),
+        llvm::APSInt(llvm::APInt(Bits, Max, 10), IsUnsigned)));
+  }
+  return true;
+}
+
+static void printEscaped(raw_ostream &OS, StringRef Text) {
+  for (unsigned I = 0, E = Text.size(); I != E; ++I) {
+    if (Text[I] == '\\')
+      OS << "\\\\";
+    else if (Text[I] == '\n')
+      OS << "\\n";
+    else
+      OS << Text[I];
+  }
+}
+
+static std::string unescape(StringRef Text) {
+  std::string Result;
+  for (unsigned I = 0, E = Text.size(); I != E; ++I) {
+    if (Text[I] == '\\' && I + 1 != E) {
+      ++I;
+      Result += Text[I] == 'n' ? '\n' : Text[I];
+      continue;
+    }
+    Result += Text[I];
+  }
+  return Result;
+}
+
+static bool parseSummary(StringRef Buffer, Summary &S) {
+  SmallVector<StringRef, 32> Lines;
+  Buffer.split(Lines, "\n", -1, false);
+  if (Lines.empty() || Lines[0] != SummaryMagic)
+    return false;
+
+  for (unsigned I = 1, E = Lines.size(); I != E; ++I) {
+    StringRef Kind, Rest;
+    std::tie(Kind, Rest) = Lines[I].split(' ');
+    if (Kind == "path") {
+      S.Paths.push_back(SummaryPath());
+      continue;
+    }
+    if (S.Paths.empty())
+      return false;
+
+    SummaryPath &P = S.Paths.back();
+    if (Kind == "ret") {
+      if (!parseRanges(Rest, P.Ret))
+        return false;
+    } else if (Kind == "param") {
+      StringRef Index;
+      std::tie(Index, Rest) = Rest.split(' ');
+      P.Params.push_back(std::make_pair(0u, ValueRangesTy()));
+      if (Index.getAsInteger(10, P.Params.back().first) ||
+          !parseRanges(Rest, P.Params.back().second))
+        return false;
+    } else if (Kind == "event") {
+      P.Events.push_back(unescape(Rest));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+const Summary *SummaryStore::load(StringRef FileName) {
+  llvm::StringMap<const Summary *>::iterator I = Loaded.find(FileName);
+  if (I != Loaded.end())
+    return I->second;
+
+  const Summary *Result = nullptr;
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, FileName);
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > Buffer =
+    llvm::MemoryBuffer::getFile(Path.str());
+  if (Buffer) {
+    std::unique_ptr<Summary> S(new Summary());
+    if (parseSummary((*Buffer)->getBuffer(), *S)) {
+      Result = S.get();
+      Owned.push_back(std::move(S));
+    }
+  }
+  Loaded[FileName] = Result;
+  return Result;
+}
+
+void SummaryStore::write(StringRef FileName, const Summary &S) const {
+  SmallString<128> Path(Dir), TmpPath;
+  llvm::sys::path::append(Path, FileName);
+
+  // Several analyzer processes may write the same summary; write it to a
+  // private file first so that readers never see a partial one.
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(Path.str() + "-%%%%%%.tmp", FD,
+                                      TmpPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << SummaryMagic << '\n';
+    for (unsigned I = 0, E = S.Paths.size(); I != E; ++I) {
+      const SummaryPath &P = S.Paths[I];
+      OS << "path\n";
+      if (!P.Ret.empty()) {
+        OS << "ret";
+        printRanges(OS, P.Ret);
+        OS << '\n';
+      }
+      for (unsigned J = 0, JE = P.Params.size(); J != JE; ++J) {
+        OS << "param " << P.Params[J].first;
+        printRanges(OS, P.Params[J].second);
+        OS << '\n';
+      }
+      for (unsigned J = 0, JE = P.Events.size(); J != JE; ++J) {
+        OS << "event ";
+        printEscaped(OS, P.Events[J]);
+        OS << '\n';
+      }
+    }
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TmpPath.str());
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TmpPath.str(), Path.str()))
+    llvm::sys::fs::remove(TmpPath.str());
+}
+
+//===----------------------------------------------------------------------===//
+// SummaryStore
+//===----------------------------------------------------------------------===//
+
+/// Returns the name of \p FD with the characters which cannot appear in a
+/// file name replaced.
+static std::string getFileNameBase(const FunctionDecl *FD) {
+  std::string Name = FD->getQualifiedNameAsString();
+  for (unsigned I = 0, E = Name.size(); I != E; ++I)
+    if (!isalnum(static_cast<unsigned char>(Name[I])) && Name[I] != '_')
+      Name[I] = '_';
+  return Name;
+}
+
+/// Returns the file name of the summary of the definition \p Def, which
+/// includes its digest, so that a summary is not applied to a changed
+/// function.
+static std::string getBodyFileName(const FunctionDecl *Def) {
+  return getFileNameBase(Def) + "-" + getFunctionDigest(Def) + ".pcsum";
+}
+
+/// Returns whether the summary of \p FD may be looked up by name, from the
+/// translation units which only see its declaration.
+static bool isSummarizedByName(const FunctionDecl *FD) {
+  return FD->isExternallyVisible() &&
+         !FD->getASTContext().getLangOpts().CPlusPlus;
+}
+
+SummaryStore::SummaryStore(StringRef Dir) : Dir(Dir) {
+  if (!Dir.empty())
+    llvm::sys::fs::create_directories(Dir);
+}
+
+const Summary *SummaryStore::lookup(const FunctionDecl *FD) {
+  llvm::DenseMap<const FunctionDecl *, const Summary *>::iterator I =
+    Local.find(FD->getCanonicalDecl());
+  if (I != Local.end())
+    return I->second;
+
+  if (Dir.empty())
+    return nullptr;
+
+  const FunctionDecl *Def;
+  if (FD->hasBody(Def))
+    return load(getBodyFileName(Def));
+  if (isSummarizedByName(FD))
+    return load(getFileNameBase(FD) + ".pcsum");
+  return nullptr;
+}
+
+void SummaryStore::add(const FunctionDecl *FD, const Summary &S) {
+  Owned.push_back(std::unique_ptr<Summary>(new Summary(S)));
+  Local[FD->getCanonicalDecl()] = Owned.back().get();
+
+  if (Dir.empty())
+    return;
+
+  const FunctionDecl *Def;
+  if (FD->hasBody(Def))
+    write(getBodyFileName(Def), S);
+  if (isSummarizedByName(FD))
+    write(getFileNameBase(FD) + ".pcsum", S);
+}
@@ -0,0 +1,99 @@
+//== PathCondSummary.h - Return path summaries ------------------*- C++ -*--==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the return path summaries PathCondExtractor computes for
+// the top level functions in '-analyzer-config pathcond-summaries=true' mode
+// and applies at their call sites instead of inlining the callees, and the
+// store keeping them in memory and, optionally, in a directory shared by
+// analyzer runs ('-analyzer-config pathcond-summary-dir=<dir>').
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_STATICANALYZER_CHECKERS_PATHCONDSUMMARY_H
+#define LLVM_CLANG_LIB_STATICANALYZER_CHECKERS_PATHCONDSUMMARY_H
+
+#include "clang/StaticAnalyzer/Core/PathSensitive/ConstraintManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+
+class FunctionDecl;
+
+namespace ento {
+namespace pathcond {
+
+/// The disjoint ranges of values a return value or a parameter is
+/// constrained to, in ascending order. Empty if it is unconstrained.
+typedef SmallVector<ConstraintManager::ValueRange, 2> ValueRangesTy;
+
+/// A path reaching a return of a function.
+struct SummaryPath {
+  /// The values returned along the path.
+  ValueRangesTy Ret;
+  /// The constraints the path places on the initial values of the
+  /// parameters, by parameter index.
+  SmallVector<std::pair<unsigned, ValueRangesTy>, 2> Params;
+  /// The @LOG_* lines of the historical events of the path, in order.
+  std::vector<std::string> Events;
+
+  bool operator==(const SummaryPath &RHS) const;
+};
+
+/// The paths reaching the returns of a function, deduplicated.
+struct Summary {
+  std::vector<SummaryPath> Paths;
+
+  void addPath(const SummaryPath &P);
+};
+
+/// \brief Owns the summaries of a translation unit.
+///
+/// The summaries of the functions analyzed in this translation unit are
+/// looked up by declaration. If a directory is given, every summary is also
+/// written to it, under the name and the digest (see getFunctionDigest) of
+/// the function, and under the name alone if the function is externally
+/// visible. A callee which has not been summarized here is then looked up by
+/// name and digest if its body is available, and by name otherwise, so that the
+/// helpers defined in other translation units are summarized as well.
+///
+/// A summary is not invalidated when one of the summaries applied while
+/// computing it changes; clear the directory after changing a callee.
+class SummaryStore {
+  std::string Dir;
+  std::vector<std::unique_ptr<Summary> > Owned;
+  llvm::DenseMap<const FunctionDecl *, const Summary *> Local;
+  /// Summaries read from Dir by file name; null if there is none.
+  llvm::StringMap<const Summary *> Loaded;
+
+  const Summary *load(StringRef FileName);
+  void write(StringRef FileName, const Summary &S) const;
+
+public:
+  /// \param Dir The directory shared by analyzer runs, or empty.
+  explicit SummaryStore(StringRef Dir);
+
+  /// Returns the summary of \p FD, or null if it has none.
+  const Summary *lookup(const FunctionDecl *FD);
+
+  /// Records the summary of \p FD, which has been analyzed as a top level
+  /// function.
+  void add(const FunctionDecl *FD, const Summary &S);
+};
+
+} // end namespace pathcond
+} // end namespace ento
+} // end namespace clang
+
+#endif
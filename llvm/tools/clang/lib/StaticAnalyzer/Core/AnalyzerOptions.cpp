@@ -67,6 +67,21 @@ IPAKind AnalyzerOptions::getIPAMode() {
   return IPAMode;
 }
 
+ExplorationStrategyKind AnalyzerOptions::getExplorationStrategy() {
+  if (ExplorationStrategy == ESK_NotSet) {
+    StringRef StratStr = getOptionAsString("exploration_strategy", "dfs");
+    ExplorationStrategy = llvm::StringSwitch<ExplorationStrategyKind>(StratStr)
+      .Case("dfs", ESK_DFS)
+      .Case("bfs", ESK_BFS)
+      .Case("bfs_block_dfs_contents", ESK_BFSBlockDFSContents)
+      .Case("unexplored_returns_first", ESK_UnexploredReturnsFirst)
+      .Default(ESK_NotSet);
+    assert(ExplorationStrategy != ESK_NotSet &&
+           "Exploration strategy is invalid.");
+  }
+  return ExplorationStrategy;
+}
+
 bool
 AnalyzerOptions::mayInlineCXXMemberFunction(CXXInlineableMemberKind K) {
   if (getIPAMode() < IPAK_Inlining)
@@ -212,6 +227,11 @@ int AnalyzerOptions::getOptionAsInteger(StringRef Name, int DefaultVal) {
   return Res;
 }
 
+StringRef AnalyzerOptions::getOptionAsString(StringRef Name,
+                                             StringRef DefaultVal) {
+  return Config.insert(std::make_pair(Name, DefaultVal)).first->second;
+}
+
 unsigned AnalyzerOptions::getAlwaysInlineSize() {
   if (!AlwaysInlineSize.hasValue())
     AlwaysInlineSize = getOptionAsInteger("ipa-always-inline-size", 3);
@@ -270,6 +290,28 @@ unsigned AnalyzerOptions::getMaxNodesPerTopLevelFunction() {
   return MaxNodesPerTopLevelFunction.getValue();
 }
 
+unsigned AnalyzerOptions::getMaxMemoryMB() {
+  if (!MaxMemoryMB.hasValue())
+    MaxMemoryMB = getOptionAsInteger("max-memory-mb", 0);
+  return MaxMemoryMB.getValue();
+}
+
+unsigned AnalyzerOptions::getNumAnalysisJobs() {
+  if (!NumAnalysisJobs.hasValue())
+    NumAnalysisJobs = getOptionAsInteger("jobs", 1);
+  return NumAnalysisJobs.getValue();
+}
+
+unsigned AnalyzerOptions::getMaxPathDiagnostics() {
+  if (!MaxPathDiagnostics.hasValue())
+    MaxPathDiagnostics = getOptionAsInteger("max-path-diagnostics", 0);
+  return MaxPathDiagnostics.getValue();
+}
+
+bool AnalyzerOptions::shouldUsePathCondSummaries() {
+  return getBooleanOption("pathcond-summaries", false);
+}
+
 bool AnalyzerOptions::shouldSynthesizeBodies() {
   return getBooleanOption("faux-bodies", true);
 }
@@ -45,6 +45,8 @@ STATISTIC(MaxBugClassSize,
 STATISTIC(MaxValidBugClassSize,
           "The maximum number of bug reports in the same equivalence class "
           "where at least one report is valid (not suppressed)");
+STATISTIC(NumMessageOnlyReports,
+          "The # of bug reports flushed without generating a path");
 
 BugReporterVisitor::~BugReporterVisitor() {}
 
@@ -2771,12 +2773,16 @@ void BugReporter::FlushReports() {
     const_cast<BugType*>(*I)->FlushReports(*this);
 
   // We need to flush reports in deterministic order to ensure the order
-  // of the reports is consistent between runs.
+  // of the reports is consistent between runs. Past the path budget, the
+  // reports are flushed with their message only.
+  unsigned MaxPaths = getAnalyzerOptions().getMaxPathDiagnostics();
+  unsigned NumPaths = 0;
   typedef std::vector<BugReportEquivClass *> ContVecTy;
   for (ContVecTy::iterator EI=EQClassesVector.begin(), EE=EQClassesVector.end();
        EI != EE; ++EI){
     BugReportEquivClass& EQ = **EI;
-    FlushReport(EQ);
+    if (FlushReport(EQ, MaxPaths == 0 || NumPaths < MaxPaths))
+      ++NumPaths;
   }
 
   // BugReporter owns and deletes only BugTypes created implicitly through
@@ -3386,19 +3392,26 @@ FindReportInEquivalenceClass(BugReportEquivClass& EQ,
   return exampleReport;
 }
 
-void BugReporter::FlushReport(BugReportEquivClass& EQ) {
+bool BugReporter::FlushReport(BugReportEquivClass& EQ, bool WithPath) {
   SmallVector<BugReport*, 10> bugReports;
   BugReport *exampleReport = FindReportInEquivalenceClass(EQ, bugReports);
-  if (exampleReport) {
-    for (PathDiagnosticConsumer *PDC : getPathDiagnosticConsumers()) {
-      FlushReport(exampleReport, *PDC, bugReports);
-    }
+  if (!exampleReport)
+    return false;
+
+  if (exampleReport->getBugType().isMessageOnly())
+    WithPath = false;
+  if (!WithPath)
+    ++NumMessageOnlyReports;
+  for (PathDiagnosticConsumer *PDC : getPathDiagnosticConsumers()) {
+    FlushReport(exampleReport, *PDC, bugReports, WithPath);
   }
+  return WithPath;
 }
 
 void BugReporter::FlushReport(BugReport *exampleReport,
                               PathDiagnosticConsumer &PD,
-                              ArrayRef<BugReport*> bugReports) {
+                              ArrayRef<BugReport*> bugReports,
+                              bool WithPath) {
 
   // FIXME: Make sure we use the 'R' for the path that was actually used.
   // Probably doesn't make a difference in practice.
@@ -3418,8 +3431,9 @@ void BugReporter::FlushReport(BugReport *exampleReport,
   // Generate the full path diagnostic, using the generation scheme
   // specified by the PathDiagnosticConsumer. Note that we have to generate
   // path diagnostics even for consumers which do not support paths, because
-  // the BugReporterVisitors may mark this bug as a false positive.
-  if (!bugReports.empty())
+  // the BugReporterVisitors may mark this bug as a false positive, unless
+  // the report is to be flushed with its message only.
+  if (WithPath && !bugReports.empty())
     if (!generatePathDiagnostic(*D.get(), PD, bugReports))
       return;
 
@@ -13,14 +13,38 @@
 
 #include "clang/StaticAnalyzer/Core/CheckerManager.h"
 #include "clang/AST/DeclBase.h"
+#include "clang/AST/Expr.h"
 #include "clang/Analysis/ProgramPoint.h"
 #include "clang/StaticAnalyzer/Core/Checker.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/CallEvent.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/CheckerContext.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 using namespace ento;
 
+namespace {
+/// Times the callbacks of one kind of one checker while it is in scope, if
+/// the checker timers are enabled.
+class CallbackTimer {
+  CheckerManager::CheckerTimer *T;
+
+public:
+  CallbackTimer(CheckerManager &Mgr, const CheckerBase *Checker,
+                CheckerManager::CallbackKind K, unsigned NumCalls = 1)
+    : T(Mgr.getCheckerTimer(Checker, K)) {
+    if (T)
+      T->start(NumCalls);
+  }
+  ~CallbackTimer() {
+    if (T)
+      T->stop();
+  }
+};
+}
+
 bool CheckerManager::hasPathSensitiveCheckers() const {
   return !StmtCheckers.empty()              ||
          !PreObjCMessageCheckers.empty()    ||
@@ -74,16 +98,20 @@ void CheckerManager::runCheckersOnASTDecl(const Decl *D, AnalysisManager& mgr,
 
   assert(checkers);
   for (CachedDeclCheckers::iterator
-         I = checkers->begin(), E = checkers->end(); I != E; ++I)
+         I = checkers->begin(), E = checkers->end(); I != E; ++I) {
+    CallbackTimer T(*this, I->Checker, CK_ASTDecl);
     (*I)(D, mgr, BR);
+  }
 }
 
 void CheckerManager::runCheckersOnASTBody(const Decl *D, AnalysisManager& mgr,
                                           BugReporter &BR) {
   assert(D && D->hasBody());
 
-  for (unsigned i = 0, e = BodyCheckers.size(); i != e; ++i)
+  for (unsigned i = 0, e = BodyCheckers.size(); i != e; ++i) {
+    CallbackTimer T(*this, BodyCheckers[i].Checker, CK_ASTBody);
     BodyCheckers[i](D, mgr, BR);
+  }
 }
 
 //===----------------------------------------------------------------------===//
@@ -92,6 +120,7 @@ void CheckerManager::runCheckersOnASTBody(const Decl *D, AnalysisManager& mgr,
 
 template <typename CHECK_CTX>
 static void expandGraphWithCheckers(CHECK_CTX checkCtx,
+                                    CheckerManager::CallbackKind Kind,
                                     ExplodedNodeSet &Dst,
                                     const ExplodedNodeSet &Src) {
   const NodeBuilderContext &BldrCtx = checkCtx.Eng.getBuilderContext();
@@ -118,6 +147,8 @@ static void expandGraphWithCheckers(CHECK_CTX checkCtx,
     }
 
     NodeBuilder B(*PrevSet, *CurrSet, BldrCtx);
+    CallbackTimer T(checkCtx.Eng.getCheckerManager(), I->Checker, Kind,
+                    PrevSet->size());
     for (ExplodedNodeSet::iterator NI = PrevSet->begin(), NE = PrevSet->end();
          NI != NE; ++NI) {
       checkCtx.runChecker(*I, B, *NI);
@@ -171,7 +202,7 @@ void CheckerManager::runCheckersForStmt(bool isPreVisit,
                                         bool WasInlined) {
   CheckStmtContext C(isPreVisit, getCachedStmtCheckersFor(S, isPreVisit),
                      S, Eng, WasInlined);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, isPreVisit ? CK_PreStmt : CK_PostStmt, Dst, Src);
 }
 
 namespace {
@@ -212,7 +243,9 @@ void CheckerManager::runCheckersForObjCMessage(bool isPreVisit,
                             isPreVisit ? PreObjCMessageCheckers
                                        : PostObjCMessageCheckers,
                             msg, Eng, WasInlined);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, isPreVisit ? CK_PreObjCMessage
+                                        : CK_PostObjCMessage,
+                          Dst, Src);
 }
 
 namespace {
@@ -255,7 +288,7 @@ void CheckerManager::runCheckersForCallEvent(bool isPreVisit,
                      isPreVisit ? PreCallCheckers
                                 : PostCallCheckers,
                      Call, Eng, WasInlined);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, isPreVisit ? CK_PreCall : CK_PostCall, Dst, Src);
 }
 
 namespace {
@@ -302,7 +335,7 @@ void CheckerManager::runCheckersForLocation(ExplodedNodeSet &Dst,
                                             ExprEngine &Eng) {
   CheckLocationContext C(LocationCheckers, location, isLoad, NodeEx,
                          BoundEx, Eng);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, CK_Location, Dst, Src);
 }
 
 namespace {
@@ -340,14 +373,16 @@ void CheckerManager::runCheckersForBind(ExplodedNodeSet &Dst,
                                         const Stmt *S, ExprEngine &Eng,
                                         const ProgramPoint &PP) {
   CheckBindContext C(BindCheckers, location, val, S, Eng, PP);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, CK_Bind, Dst, Src);
 }
 
 void CheckerManager::runCheckersForEndAnalysis(ExplodedGraph &G,
                                                BugReporter &BR,
                                                ExprEngine &Eng) {
-  for (unsigned i = 0, e = EndAnalysisCheckers.size(); i != e; ++i)
+  for (unsigned i = 0, e = EndAnalysisCheckers.size(); i != e; ++i) {
+    CallbackTimer T(*this, EndAnalysisCheckers[i].Checker, CK_EndAnalysis);
     EndAnalysisCheckers[i](G, BR, Eng);
+  }
 }
 
 /// \brief Run checkers for end of path.
@@ -369,6 +404,7 @@ void CheckerManager::runCheckersForEndFunction(NodeBuilderContext &BC,
                                           Pred->getLocationContext(),
                                           checkFn.Checker);
     CheckerContext C(Bldr, Eng, Pred, L);
+    CallbackTimer T(*this, checkFn.Checker, CK_EndFunction);
     checkFn(C);
   }
 }
@@ -405,14 +441,16 @@ void CheckerManager::runCheckersForBranchCondition(const Stmt *Condition,
   ExplodedNodeSet Src;
   Src.insert(Pred);
   CheckBranchConditionContext C(BranchConditionCheckers, Condition, Eng);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, CK_BranchCondition, Dst, Src);
 }
 
 /// \brief Run checkers for live symbols.
 void CheckerManager::runCheckersForLiveSymbols(ProgramStateRef state,
                                                SymbolReaper &SymReaper) {
-  for (unsigned i = 0, e = LiveSymbolsCheckers.size(); i != e; ++i)
+  for (unsigned i = 0, e = LiveSymbolsCheckers.size(); i != e; ++i) {
+    CallbackTimer T(*this, LiveSymbolsCheckers[i].Checker, CK_LiveSymbols);
     LiveSymbolsCheckers[i](state, SymReaper);
+  }
 }
 
 namespace {
@@ -454,7 +492,7 @@ void CheckerManager::runCheckersForDeadSymbols(ExplodedNodeSet &Dst,
                                                ExprEngine &Eng,
                                                ProgramPoint::Kind K) {
   CheckDeadSymbolsContext C(DeadSymbolsCheckers, SymReaper, S, Eng, K);
-  expandGraphWithCheckers(C, Dst, Src);
+  expandGraphWithCheckers(C, CK_DeadSymbols, Dst, Src);
 }
 
 /// \brief True if at least one checker wants to check region changes.
@@ -478,6 +516,8 @@ CheckerManager::runCheckersForRegionChanges(ProgramStateRef state,
     // bail out.
     if (!state)
       return nullptr;
+    CallbackTimer T(*this, RegionChangesCheckers[i].CheckFn.Checker,
+                    CK_RegionChanges);
     state = RegionChangesCheckers[i].CheckFn(state, invalidated, 
                                              ExplicitRegions, Regions, Call);
   }
@@ -500,6 +540,8 @@ CheckerManager::runCheckersForPointerEscape(ProgramStateRef State,
       //  way), bail out.
       if (!State)
         return nullptr;
+      CallbackTimer T(*this, PointerEscapeCheckers[i].Checker,
+                      CK_PointerEscape);
       State = PointerEscapeCheckers[i](State, Escaped, Call, Kind, ETraits);
     }
   return State;
@@ -514,6 +556,7 @@ CheckerManager::runCheckersForEvalAssume(ProgramStateRef state,
     // bail out.
     if (!state)
       return nullptr;
+    CallbackTimer T(*this, EvalAssumeCheckers[i].Checker, CK_EvalAssume);
     state = EvalAssumeCheckers[i](state, Cond, Assumption);
   }
   return state;
@@ -546,6 +589,7 @@ void CheckerManager::runCheckersForEvalCall(ExplodedNodeSet &Dst,
         // destruction, so introduce the scope to make sure it gets properly
         // populated.
         CheckerContext C(B, Eng, Pred, L);
+        CallbackTimer T(*this, EI->Checker, CK_EvalCall);
         evaluated = (*EI)(CE, C);
       }
       assert(!(evaluated && anyEvaluated)
@@ -572,8 +616,11 @@ void CheckerManager::runCheckersOnEndOfTranslationUnit(
                                                   const TranslationUnitDecl *TU,
                                                   AnalysisManager &mgr,
                                                   BugReporter &BR) {
-  for (unsigned i = 0, e = EndOfTranslationUnitCheckers.size(); i != e; ++i)
+  for (unsigned i = 0, e = EndOfTranslationUnitCheckers.size(); i != e; ++i) {
+    CallbackTimer T(*this, EndOfTranslationUnitCheckers[i].Checker,
+                    CK_EndOfTranslationUnit);
     EndOfTranslationUnitCheckers[i](TU, mgr, BR);
+  }
 }
 
 void CheckerManager::runCheckersForPrintState(raw_ostream &Out,
@@ -684,15 +731,108 @@ void CheckerManager::_registerForEndOfTranslationUnit(
   EndOfTranslationUnitCheckers.push_back(checkfn);
 }
 
+//===----------------------------------------------------------------------===//
+// Checker timers.
+//===----------------------------------------------------------------------===//
+
+StringRef CheckerManager::getCallbackKindName(CallbackKind K) {
+  switch (K) {
+  case CK_ASTDecl: return "ASTDecl";
+  case CK_ASTBody: return "ASTCodeBody";
+  case CK_PreStmt: return "PreStmt";
+  case CK_PostStmt: return "PostStmt";
+  case CK_PreObjCMessage: return "PreObjCMessage";
+  case CK_PostObjCMessage: return "PostObjCMessage";
+  case CK_PreCall: return "PreCall";
+  case CK_PostCall: return "PostCall";
+  case CK_Location: return "Location";
+  case CK_Bind: return "Bind";
+  case CK_EndAnalysis: return "EndAnalysis";
+  case CK_EndFunction: return "EndFunction";
+  case CK_BranchCondition: return "BranchCondition";
+  case CK_LiveSymbols: return "LiveSymbols";
+  case CK_DeadSymbols: return "DeadSymbols";
+  case CK_RegionChanges: return "RegionChanges";
+  case CK_PointerEscape: return "PointerEscape";
+  case CK_EvalAssume: return "EvalAssume";
+  case CK_EvalCall: return "EvalCall";
+  case CK_EndOfTranslationUnit: return "EndOfTranslationUnit";
+  }
+  llvm_unreachable("Unknown callback kind");
+}
+
+CheckerManager::CheckerTimer *
+CheckerManager::getCheckerTimer(const CheckerBase *Checker, CallbackKind K) {
+  if (!Timers)
+    return nullptr;
+
+  CheckerTimer *&T = CheckerTimerMap[std::make_pair(Checker, unsigned(K))];
+  if (!T) {
+    CheckerTimers.push_back(std::unique_ptr<CheckerTimer>(
+        new CheckerTimer(Checker->getCheckName().getName(), K, *Timers)));
+    T = CheckerTimers.back().get();
+  }
+  return T;
+}
+
+static void printTimeRecord(raw_ostream &OS, const llvm::TimeRecord &R) {
+  OS << llvm::format(",%.6f,%.6f,%.6f", R.getUserTime(), R.getSystemTime(),
+                     R.getWallTime());
+}
+
+void CheckerManager::printCheckerTimers(const llvm::TimeRecord &Total) {
+  if (!Timers)
+    return;
+
+  // Write the values first; printing the group resets the timers.
+  StringRef OutputFile = AOptions->CheckerTimersOutput;
+  if (!OutputFile.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(OutputFile, EC, llvm::sys::fs::F_Text);
+    if (EC) {
+      llvm::errs() << "warning: could not create file '" << OutputFile
+                   << "': " << EC.message() << '\n';
+    } else {
+      // The first row is the whole analysis; the time spent in the engine is
+      // what the checkers leave of it.
+      OS << "checker,callback,calls,user,system,wall\n";
+      OS << "-,Analysis,1";
+      printTimeRecord(OS, Total);
+      OS << '\n';
+      for (unsigned I = 0, E = CheckerTimers.size(); I != E; ++I) {
+        const CheckerTimer &T = *CheckerTimers[I];
+        OS << T.getCheckerName() << ',' << getCallbackKindName(T.getKind())
+           << ',' << T.getNumCalls();
+        printTimeRecord(OS, T.getTotalTime());
+        OS << '\n';
+      }
+    }
+  }
+
+  Timers->print(llvm::errs());
+}
+
 //===----------------------------------------------------------------------===//
 // Implementation details.
 //===----------------------------------------------------------------------===//
 
+/// Returns the opcode of \p S if it is an operator, and 0 otherwise.
+static unsigned getStmtOpcode(const Stmt *S) {
+  if (const BinaryOperator *BO = dyn_cast<BinaryOperator>(S))
+    return BO->getOpcode();
+  if (const UnaryOperator *UO = dyn_cast<UnaryOperator>(S))
+    return UO->getOpcode();
+  return 0;
+}
+
 const CheckerManager::CachedStmtCheckers &
 CheckerManager::getCachedStmtCheckersFor(const Stmt *S, bool isPreVisit) {
   assert(S);
 
-  unsigned Key = (S->getStmtClass() << 1) | unsigned(isPreVisit);
+  unsigned Opcode = getStmtOpcode(S);
+  assert(Opcode < 64 && "Opcode does not fit in the cache key");
+  unsigned Key = (((S->getStmtClass() << 6) | Opcode) << 1) |
+                 unsigned(isPreVisit);
   CachedStmtCheckersMapTy::iterator CCI = CachedStmtCheckersMap.find(Key);
   if (CCI != CachedStmtCheckersMap.end())
     return CCI->second;
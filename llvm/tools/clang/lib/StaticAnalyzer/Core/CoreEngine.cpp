@@ -16,8 +16,10 @@
 #include "clang/AST/Expr.h"
 #include "clang/AST/ExprCXX.h"
 #include "clang/AST/StmtCXX.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Casting.h"
@@ -31,8 +33,16 @@ STATISTIC(NumSteps,
             "The # of steps executed.");
 STATISTIC(NumReachedMaxSteps,
             "The # of times we reached the max number of steps.");
+STATISTIC(NumReachedMaxMemory,
+            "The # of times we reached the memory budget.");
+STATISTIC(NumEagerReclamations,
+            "The # of times nodes were reclaimed eagerly because the memory "
+            "budget was close.");
 STATISTIC(NumPathsExplored,
             "The # of paths explored by the analyzer.");
+STATISTIC(NumDemotedUnits,
+            "The # of work list units which could no longer reach an "
+            "unexplored return site when they were dequeued.");
 
 //===----------------------------------------------------------------------===//
 // Worklist classes for exploration of reachable states.
@@ -157,10 +167,217 @@ WorkList* WorkList::makeBFSBlockDFSContents() {
   return new BFSBlockDFSContents();
 }
 
+namespace {
+  /// Explores the units whose basic block can still reach a return site of
+  /// the top level function that no path has left the function through yet,
+  /// so that the distinct returns are reached early when the node budget is
+  /// exhausted before the function is fully explored. A return site is a
+  /// block with an edge to the exit block. Nodes of inlined calls are ranked
+  /// by the block of their call site in the top level function. Both the
+  /// preferred and the remaining units are explored depth-first.
+  class UnexploredReturnsFirst : public WorkList {
+    SmallVector<WorkListUnit,20> Preferred;
+    SmallVector<WorkListUnit,20> Rest;
+
+    /// The CFG of the top level function, which the bit vectors below
+    /// describe.
+    const CFG *TopCFG;
+    /// The return sites each block of TopCFG can reach, indexed by block ID.
+    std::vector<llvm::BitVector> ReachableReturns;
+    /// The return sites no path has left the function through yet.
+    llvm::BitVector UnexploredReturns;
+
+    void computeReachableReturns(const CFG *C);
+    const CFGBlock *getTopFrameBlock(const WorkListUnit &U,
+                                     bool &InTopFrame);
+    bool isPreferred(const WorkListUnit &U);
+    /// Records that a path left the top level function through the return
+    /// site of \p U, if it did.
+    void markExplored(const WorkListUnit &U);
+
+  public:
+    UnexploredReturnsFirst() : TopCFG(nullptr) {}
+
+    bool hasWork() const override {
+      return !Preferred.empty() || !Rest.empty();
+    }
+
+    void enqueue(const WorkListUnit& U) override {
+      if (isPreferred(U))
+        Preferred.push_back(U);
+      else
+        Rest.push_back(U);
+    }
+
+    WorkListUnit dequeue() override;
+
+    bool visitItemsInWorkList(Visitor &V) override {
+      for (SmallVectorImpl<WorkListUnit>::iterator
+           I = Preferred.begin(), E = Preferred.end(); I != E; ++I) {
+        if (V.visit(*I))
+          return true;
+      }
+      for (SmallVectorImpl<WorkListUnit>::iterator
+           I = Rest.begin(), E = Rest.end(); I != E; ++I) {
+        if (V.visit(*I))
+          return true;
+      }
+      return false;
+    }
+  };
+} // end anonymous namespace
+
+void UnexploredReturnsFirst::computeReachableReturns(const CFG *C) {
+  TopCFG = C;
+  unsigned NumBlocks = C->getNumBlockIDs();
+  ReachableReturns.assign(NumBlocks, llvm::BitVector(NumBlocks));
+  UnexploredReturns.reset();
+  UnexploredReturns.resize(NumBlocks);
+
+  // Walk backwards from every return site, marking it reachable from all
+  // of its transitive predecessors.
+  const CFGBlock &Exit = C->getExit();
+  SmallVector<const CFGBlock *, 32> Worklist;
+  for (CFGBlock::const_pred_iterator I = Exit.pred_begin(),
+                                     E = Exit.pred_end(); I != E; ++I) {
+    const CFGBlock *Ret = *I;
+    if (!Ret)
+      continue;
+    unsigned RetID = Ret->getBlockID();
+    UnexploredReturns.set(RetID);
+    ReachableReturns[RetID].set(RetID);
+    Worklist.push_back(Ret);
+    while (!Worklist.empty()) {
+      const CFGBlock *B = Worklist.pop_back_val();
+      for (CFGBlock::const_pred_iterator PI = B->pred_begin(),
+                                         PE = B->pred_end(); PI != PE; ++PI) {
+        const CFGBlock *Pred = *PI;
+        if (!Pred || ReachableReturns[Pred->getBlockID()].test(RetID))
+          continue;
+        ReachableReturns[Pred->getBlockID()].set(RetID);
+        Worklist.push_back(Pred);
+      }
+    }
+  }
+}
+
+const CFGBlock *
+UnexploredReturnsFirst::getTopFrameBlock(const WorkListUnit &U,
+                                         bool &InTopFrame) {
+  const CFGBlock *B = U.getBlock();
+  ProgramPoint Loc = U.getNode()->getLocation();
+  if (!B) {
+    if (Optional<BlockEdge> BE = Loc.getAs<BlockEdge>())
+      B = BE->getDst();
+    else if (Optional<BlockEntrance> BEnt = Loc.getAs<BlockEntrance>())
+      B = BEnt->getBlock();
+  }
+
+  const StackFrameContext *SFC = Loc.getLocationContext()->
+                                   getCurrentStackFrame();
+  InTopFrame = SFC->inTopFrame();
+  while (!SFC->inTopFrame()) {
+    B = SFC->getCallSiteBlock();
+    SFC = SFC->getParent()->getCurrentStackFrame();
+  }
+
+  if (SFC->getCFG() != TopCFG)
+    computeReachableReturns(SFC->getCFG());
+  return B;
+}
+
+bool UnexploredReturnsFirst::isPreferred(const WorkListUnit &U) {
+  bool InTopFrame;
+  const CFGBlock *B = getTopFrameBlock(U, InTopFrame);
+
+  // Keep following the path when its position is unknown, or when it is
+  // leaving the function; its return is recorded at the exit.
+  if (!B || B == &TopCFG->getExit())
+    return true;
+
+  return ReachableReturns[B->getBlockID()].anyCommon(UnexploredReturns);
+}
+
+void UnexploredReturnsFirst::markExplored(const WorkListUnit &U) {
+  Optional<BlockEdge> BE = U.getNode()->getLocation().getAs<BlockEdge>();
+  if (!BE || !BE->getLocationContext()->getCurrentStackFrame()->inTopFrame())
+    return;
+  if (BE->getDst() == &TopCFG->getExit())
+    UnexploredReturns.reset(BE->getSrc()->getBlockID());
+}
+
+WorkListUnit UnexploredReturnsFirst::dequeue() {
+  // The set of unexplored returns only shrinks, so a unit of Rest never
+  // becomes preferred again, but a preferred unit may have to be demoted.
+  while (!Preferred.empty()) {
+    WorkListUnit U = Preferred.pop_back_val();
+    if (isPreferred(U)) {
+      markExplored(U);
+      return U;
+    }
+    ++NumDemotedUnits;
+    Rest.push_back(U);
+  }
+
+  assert(!Rest.empty());
+  WorkListUnit U = Rest.pop_back_val();
+  markExplored(U);
+  return U;
+}
+
+WorkList *WorkList::makeUnexploredReturnsFirst() {
+  return new UnexploredReturnsFirst();
+}
+
 //===----------------------------------------------------------------------===//
 // Core analysis engine.
 //===----------------------------------------------------------------------===//
 
+static WorkList *generateWorkList(AnalyzerOptions &Opts) {
+  switch (Opts.getExplorationStrategy()) {
+  case ESK_DFS:
+    return WorkList::makeDFS();
+  case ESK_BFS:
+    return WorkList::makeBFS();
+  case ESK_BFSBlockDFSContents:
+    return WorkList::makeBFSBlockDFSContents();
+  case ESK_UnexploredReturnsFirst:
+    return WorkList::makeUnexploredReturnsFirst();
+  case ESK_NotSet:
+    break;
+  }
+  llvm_unreachable("Unknown AnalyzerOptions::ExplorationStrategy");
+}
+
+CoreEngine::CoreEngine(SubEngine &subengine, FunctionSummariesTy *FS,
+                       AnalyzerOptions &Opts)
+    : SubEng(subengine), WList(generateWorkList(Opts)),
+      BCounterFactory(G.getAllocator()), FunctionSummaries(FS),
+      MaxMemory(uint64_t(Opts.getMaxMemoryMB()) << 20),
+      ReclaimingEagerly(false) {}
+
+/// The number of steps between two checks of the memory budget. Computing
+/// the memory taken by the graph walks all the slabs of its allocator.
+static const unsigned MemoryCheckInterval = 256;
+
+bool CoreEngine::isOverMemoryBudget() {
+  // The nodes, the states, the stores, the constraints and the symbols are
+  // all allocated in the graph's allocator, which never frees memory.
+  uint64_t Used = G.getAllocator().getTotalMemory();
+  if (Used >= MaxMemory)
+    return true;
+
+  // Past three quarters of the budget, reclaim the uninteresting nodes after
+  // every statement so that their memory is reused for the new nodes.
+  if (!ReclaimingEagerly && Used >= MaxMemory / 4 * 3 &&
+      G.isReclaimingNodes()) {
+    G.enableNodeReclamation(1);
+    ReclaimingEagerly = true;
+    NumEagerReclamations++;
+  }
+  return false;
+}
+
 /// ExecuteWorkList - Run the worklist algorithm for a maximum number of steps.
 bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
                                    ProgramStateRef InitState) {
@@ -200,6 +417,7 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
 
   // Check if we have a steps limit
   bool UnlimitedSteps = Steps == 0;
+  unsigned StepsToMemoryCheck = MemoryCheckInterval;
 
   while (WList->hasWork()) {
     if (!UnlimitedSteps) {
@@ -210,6 +428,16 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
       --Steps;
     }
 
+    // Like the steps limit, the memory budget stops the exploration of new
+    // paths; the reports of the paths explored so far are still flushed.
+    if (MaxMemory && --StepsToMemoryCheck == 0) {
+      StepsToMemoryCheck = MemoryCheckInterval;
+      if (isOverMemoryBudget()) {
+        NumReachedMaxMemory++;
+        break;
+      }
+    }
+
     NumSteps++;
 
     const WorkListUnit& WU = WList->dequeue();
@@ -48,7 +48,7 @@ void ExplodedNode::SetAuditor(ExplodedNode::Auditor* A) {
 //===----------------------------------------------------------------------===//
 
 ExplodedGraph::ExplodedGraph()
-  : NumNodes(0), ReclaimNodeInterval(0) {}
+  : NumNodes(0), NumMerges(0), ReclaimNodeInterval(0) {}
 
 ExplodedGraph::~ExplodedGraph() {}
 
@@ -217,6 +217,8 @@ typedef llvm::PointerUnion<ExplodedNode *, ExplodedNodeVector *> GroupStorage;
 
 void ExplodedNode::addPredecessor(ExplodedNode *V, ExplodedGraph &G) {
   assert (!V->isSink());
+  if (!Preds.empty())
+    ++G.NumMerges;
   Preds.addNode(V, G);
   V->Succs.addNode(this, G);
 #ifndef NDEBUG
@@ -249,9 +251,11 @@ void ExplodedNode::NodeGroup::addNode(ExplodedNode *N, ExplodedGraph &G) {
     // Switch from single-node to multi-node representation.
     ExplodedNode *Old = Storage.get<ExplodedNode *>();
 
+    // Nodes with several predecessors or successors mostly have two, from
+    // the two branches of a condition.
     BumpVectorContext &Ctx = G.getNodeAllocator();
     V = G.getAllocator().Allocate<ExplodedNodeVector>();
-    new (V) ExplodedNodeVector(Ctx, 4);
+    new (V) ExplodedNodeVector(Ctx, 2);
     V->push_back(Old, Ctx);
 
     Storage = V;
@@ -274,6 +278,16 @@ unsigned ExplodedNode::NodeGroup::size() const {
   return 1;
 }
 
+size_t ExplodedNode::NodeGroup::getMemoryUsage() const {
+  if (getFlag())
+    return 0;
+
+  const GroupStorage &Storage = reinterpret_cast<const GroupStorage &>(P);
+  if (ExplodedNodeVector *V = Storage.dyn_cast<ExplodedNodeVector *>())
+    return sizeof(ExplodedNodeVector) + V->capacity() * sizeof(ExplodedNode *);
+  return 0;
+}
+
 ExplodedNode * const *ExplodedNode::NodeGroup::begin() const {
   if (getFlag())
     return nullptr;
@@ -336,6 +350,13 @@ ExplodedNode *ExplodedGraph::getNode(const ProgramPoint &L,
   return V;
 }
 
+uint64_t ExplodedGraph::getNodeMemoryUsage() const {
+  uint64_t Bytes = (NumNodes + FreeNodes.size()) * sizeof(ExplodedNode);
+  for (const_node_iterator I = nodes_begin(), E = nodes_end(); I != E; ++I)
+    Bytes += I->Preds.getMemoryUsage() + I->Succs.getMemoryUsage();
+  return Bytes;
+}
+
 std::unique_ptr<ExplodedGraph>
 ExplodedGraph::trim(ArrayRef<const NodeTy *> Sinks,
                     InterExplodedGraphMap *ForwardMap,
@@ -50,6 +50,20 @@ STATISTIC(NumMaxBlockCountReachedInInlined,
             "an inlined function");
 STATISTIC(NumTimesRetriedWithoutInlining,
             "The # of times we re-evaluated a call without inlining");
+STATISTIC(BytesPerNode, "The average # of bytes per exploded node");
+STATISTIC(BytesPerState,
+            "The average # of bytes per program state, including its store");
+STATISTIC(BytesPerStoreCluster,
+            "The average # of bytes per store binding cluster");
+STATISTIC(MaxGraphKBytes,
+            "The maximum # of kilobytes allocated for an exploded graph and "
+            "its states");
+
+// The totals the averages above are computed from, over all the analyzed
+// functions.
+static uint64_t TotalNodes, TotalNodeBytes;
+static uint64_t TotalStates, TotalStateBytes;
+static uint64_t TotalClusters, TotalClusterBytes;
 
 typedef std::pair<const CXXBindTemporaryExpr *, const StackFrameContext *>
     CXXBindTemporaryContext;
@@ -72,7 +86,7 @@ ExprEngine::ExprEngine(AnalysisManager &mgr, bool gcEnabled,
                        InliningModes HowToInlineIn)
   : AMgr(mgr),
     AnalysisDeclContexts(mgr.getAnalysisDeclContextManager()),
-    Engine(*this, FS),
+    Engine(*this, FS, mgr.getAnalyzerOptions()),
     G(Engine.getGraph()),
     StateMgr(getContext(), mgr.getStoreManagerCreator(),
              mgr.getConstraintManagerCreator(), G.getAllocator(),
@@ -90,6 +104,8 @@ ExprEngine::ExprEngine(AnalysisManager &mgr, bool gcEnabled,
     // Enable eager node reclaimation when constructing the ExplodedGraph.
     G.enableNodeReclamation(TrimInterval);
   }
+
+  StateMgr.getHistoricalEventManager().setGraph(&G);
 }
 
 ExprEngine::~ExprEngine() {
@@ -281,9 +297,36 @@ void ExprEngine::printState(raw_ostream &Out, ProgramStateRef State,
 }
 
 void ExprEngine::processEndWorklist(bool hasWorkRemaining) {
+  if (AMgr.options.PrintStats)
+    updateMemoryStatistics();
   getCheckerManager().runCheckersForEndAnalysis(G, BR, *this);
 }
 
+void ExprEngine::updateMemoryStatistics() {
+  uint64_t GraphBytes = G.getAllocator().getTotalMemory();
+  uint64_t NodeBytes = G.getNodeMemoryUsage();
+  StoreMemoryUsage Usage;
+  StateMgr.addStoreMemoryUsage(Usage);
+
+  TotalNodes += G.size();
+  TotalNodeBytes += NodeBytes;
+  // The rest of the allocator holds the states: the state objects, their
+  // environments, stores and generic data, and the symbols and regions.
+  TotalStates += StateMgr.getNumStates();
+  TotalStateBytes += GraphBytes > NodeBytes ? GraphBytes - NodeBytes : 0;
+  TotalClusters += Usage.NumClusters;
+  TotalClusterBytes += Usage.ClusterBytes;
+
+  if (TotalNodes)
+    BytesPerNode = TotalNodeBytes / TotalNodes;
+  if (TotalStates)
+    BytesPerState = TotalStateBytes / TotalStates;
+  if (TotalClusters)
+    BytesPerStoreCluster = TotalClusterBytes / TotalClusters;
+  if (GraphBytes / 1024 > MaxGraphKBytes)
+    MaxGraphKBytes = GraphBytes / 1024;
+}
+
 void ExprEngine::processCFGElement(const CFGElement E, ExplodedNode *Pred,
                                    unsigned StmtIdx, NodeBuilderContext *Ctx) {
   PrettyStackTraceLocationContext CrashInfo(Pred->getLocationContext());
@@ -401,8 +444,11 @@ void ExprEngine::removeDead(ExplodedNode *Pred, ExplodedNodeSet &Out,
       ProgramStateRef CheckerState = (*I)->getState();
 
       // The constraint manager has not been cleaned up yet, so clean up now.
-      CheckerState = getConstraintManager().removeDeadBindings(CheckerState,
-                                                               SymReaper);
+      // With -analyzer-purge=keep-path-relevant the constraints of dead
+      // symbols stay, so that the path conditions are those of PurgeNone.
+      if (AMgr.options.AnalysisPurgeOpt != PurgePathRelevant)
+        CheckerState = getConstraintManager().removeDeadBindings(CheckerState,
+                                                                 SymReaper);
 
       assert(StateMgr.haveEqualEnvironments(CheckerState, Pred->getState()) &&
         "Checkers are not allowed to modify the Environment as a part of "
@@ -13,10 +13,81 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/StaticAnalyzer/Core/PathSensitive/FssStmtPrinter.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace clang;
 using namespace ento;
 
+#define DEBUG_TYPE "FssStmtPrinter"
+
+STATISTIC(NumRenderCacheHits,
+            "The # of symbols and regions printed from the render cache");
+STATISTIC(NumRenderCacheMisses,
+            "The # of symbols and regions rendered");
+
+//===----------------------------------------------------------------------===//
+//  FssRenderCache
+//===----------------------------------------------------------------------===//
+
+StringRef FssRenderCache::save(StringRef Text) {
+  char *Mem = Alloc.Allocate<char>(Text.size());
+  std::copy(Text.begin(), Text.end(), Mem);
+  return StringRef(Mem, Text.size());
+}
+
+void FssRenderCache::print(raw_ostream &OS, const SymExpr *Sym, int Level) {
+  // Only the outermost level of a symbol is printed differently.
+  KeyTy Key(Sym, Level == 0 ? EK_TopLevelSymbol : EK_NestedSymbol);
+  llvm::DenseMap<KeyTy, StringRef>::iterator I = Cache.find(Key);
+  if (I != Cache.end()) {
+    ++NumRenderCacheHits;
+    OS << I->second;
+    return;
+  }
+
+  ++NumRenderCacheMisses;
+  std::string Text;
+  llvm::raw_string_ostream TS(Text);
+  Sym->dumpToStream(TS, Level);
+  StringRef Saved = save(TS.str());
+  Cache[Key] = Saved;
+  OS << Saved;
+}
+
+void FssRenderCache::print(raw_ostream &OS, SVal V, int Level) {
+  if (Optional<nonloc::SymbolVal> SV = V.getAs<nonloc::SymbolVal>()) {
+    print(OS, SV->getSymbol(), Level);
+    return;
+  }
+
+  // Regions are printed the same way at every level.
+  Optional<loc::MemRegionVal> RV = V.getAs<loc::MemRegionVal>();
+  if (!RV) {
+    V.dumpToStream(OS, Level);
+    return;
+  }
+
+  KeyTy Key(RV->getRegion(), EK_Region);
+  llvm::DenseMap<KeyTy, StringRef>::iterator I = Cache.find(Key);
+  if (I != Cache.end()) {
+    ++NumRenderCacheHits;
+    OS << I->second;
+    return;
+  }
+
+  ++NumRenderCacheMisses;
+  std::string Text;
+  llvm::raw_string_ostream TS(Text);
+  V.dumpToStream(TS, Level);
+  StringRef Saved = save(TS.str());
+  Cache[Key] = Saved;
+  OS << Saved;
+}
+
+//===----------------------------------------------------------------------===//
+//  FssStmtPrinter
+//===----------------------------------------------------------------------===//
+
 #define TRY_TO_EVALUATE_SYMEXPR_OR_SVAL(__x) do {       \
     const Stmt *__s = dyn_cast<Stmt>(__x);              \
     if (__s != nullptr && tryToEvalSymExprOrSVal(__s))  \
@@ -38,7 +109,7 @@ bool FssStmtPrinter::tryToEvalSymExprOrSVal(const Stmt *S) {
       if (dyn_cast<SymbolConjured>(SE))
         return false;
       ++Level;
-      SE->dumpToStream(OS, Level);
+      PS->getStateManager().getRenderCache().print(OS, SE, Level);
       --Level;
       return true;
     }
@@ -50,7 +121,7 @@ bool FssStmtPrinter::tryToEvalSymExprOrSVal(const Stmt *S) {
       return false;
 #endif
     ++Level;
-    SV.dumpToStream(OS, Level);
+    PS->getStateManager().getRenderCache().print(OS, SV, Level);
     --Level;
   return true; 
 }
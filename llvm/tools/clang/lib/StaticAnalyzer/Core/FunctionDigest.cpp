@@ -0,0 +1,50 @@
+//== FunctionDigest.cpp - Stable digests of function definitions -*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements a digest of a function definition which is stable
+//  across analyzer runs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/FunctionDigest.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/PrettyPrinter.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace ento;
+
+std::string ento::getFunctionDigest(const FunctionDecl *FD) {
+  const ASTContext &Ctx = FD->getASTContext();
+  const SourceManager &SM = Ctx.getSourceManager();
+  const LangOptions &LangOpts = Ctx.getLangOpts();
+
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  OS << FD->getLocStart().printToString(SM) << '\n'
+     << FD->getType().getAsString() << '\n'
+     << Lexer::getSourceText(
+            CharSourceRange::getTokenRange(FD->getSourceRange()), SM, LangOpts)
+     << '\n';
+  if (const Stmt *Body = FD->getBody())
+    Body->printPretty(OS, nullptr, PrintingPolicy(LangOpts));
+
+  llvm::MD5 Hash;
+  Hash.update(OS.str());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+  return Digest.str();
+}
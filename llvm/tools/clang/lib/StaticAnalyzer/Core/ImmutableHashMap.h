@@ -0,0 +1,418 @@
+//==- ImmutableHashMap.h - Persistent hash array mapped trie -------*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines ImmutableHashMap, a persistent map implemented as a hash
+// array mapped trie. Unlike llvm::ImmutableMap, which is an AVL tree, a lookup
+// or an update takes one step per 5 bits of the hash of the key rather than
+// one step per binary decision, so maps with hundreds of entries are at most
+// two or three nodes deep.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_STATICANALYZER_CORE_IMMUTABLEHASHMAP_H
+#define LLVM_CLANG_LIB_STATICANALYZER_CORE_IMMUTABLEHASHMAP_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <utility>
+
+namespace clang {
+namespace ento {
+
+/// \brief A persistent map from \p KeyT to \p DataT, implemented as a hash
+/// array mapped trie with path copying.
+///
+/// Every node holds up to 32 slots, selected by 5 bits of the hash of the
+/// key, and each slot holds either an entry or a child node; the keys whose
+/// 32 bits of hash are all equal are kept sorted in a collision node. A child
+/// holding a single entry is always replaced by the entry (the compressed
+/// layout of CHAMP), so that the layout of a map depends only on its contents.
+/// The nodes are uniqued by the factory, so two maps are equal if and only if
+/// they have the same root, as for llvm::ImmutableMap.
+///
+/// \p InfoT provides 'static unsigned getHashValue(const KeyT &)'. Keys are
+/// compared with == and <; keys and data are profiled with Profile().
+template <typename KeyT, typename DataT, typename InfoT>
+class ImmutableHashMap {
+public:
+  typedef std::pair<KeyT, DataT> value_type;
+
+  /// A node of the trie: the entries, in slot order, followed by the
+  /// children, in slot order.
+  class Node : public llvm::FoldingSetNode {
+    friend class ImmutableHashMap;
+
+    /// The slots holding an entry, and the slots holding a child node.
+    /// Both are 0 in a collision node.
+    uint32_t DataMap, NodeMap;
+    unsigned NumData, NumChildren;
+
+    Node(uint32_t DataMap, uint32_t NodeMap, unsigned NumData,
+         unsigned NumChildren)
+      : DataMap(DataMap), NodeMap(NodeMap), NumData(NumData),
+        NumChildren(NumChildren) {}
+
+    static size_t getDataOffset() {
+      return llvm::RoundUpToAlignment(sizeof(Node),
+                                      llvm::alignOf<value_type>());
+    }
+    static size_t getChildrenOffset(unsigned NumData) {
+      return llvm::RoundUpToAlignment(
+          getDataOffset() + NumData * sizeof(value_type),
+          llvm::alignOf<const Node *>());
+    }
+
+  public:
+    const value_type *data() const {
+      return reinterpret_cast<const value_type *>(
+          reinterpret_cast<const char *>(this) + getDataOffset());
+    }
+    const Node *const *children() const {
+      return reinterpret_cast<const Node *const *>(
+          reinterpret_cast<const char *>(this) + getChildrenOffset(NumData));
+    }
+
+    unsigned getNumData() const { return NumData; }
+    unsigned getNumChildren() const { return NumChildren; }
+    const Node *getChild(unsigned I) const { return children()[I]; }
+
+    /// Returns the number of bytes allocated for the node.
+    size_t getSize() const {
+      return getChildrenOffset(NumData) + NumChildren * sizeof(const Node *);
+    }
+
+    static void Profile(llvm::FoldingSetNodeID &ID, uint32_t DataMap,
+                        uint32_t NodeMap, ArrayRef<value_type> Data,
+                        ArrayRef<const Node *> Children) {
+      ID.AddInteger(DataMap);
+      ID.AddInteger(NodeMap);
+      ID.AddInteger(Data.size());
+      for (unsigned I = 0, E = Data.size(); I != E; ++I) {
+        Data[I].first.Profile(ID);
+        Data[I].second.Profile(ID);
+      }
+      for (unsigned I = 0, E = Children.size(); I != E; ++I)
+        ID.AddPointer(Children[I]);
+    }
+
+    void Profile(llvm::FoldingSetNodeID &ID) const {
+      Profile(ID, DataMap, NodeMap, llvm::makeArrayRef(data(), NumData),
+              llvm::makeArrayRef(children(), NumChildren));
+    }
+  };
+
+private:
+  const Node *Root;
+
+  enum { BitsPerLevel = 5, SlotMask = (1 << BitsPerLevel) - 1 };
+
+  /// The shift at which the 32 bits of hash are exhausted, and the nodes are
+  /// collision nodes.
+  enum { CollisionShift = 35 };
+
+  static uint32_t getSlotBit(unsigned Hash, unsigned Shift) {
+    return 1u << ((Hash >> Shift) & SlotMask);
+  }
+
+  /// Returns the index of the entry or the child of slot \p Bit in \p Map.
+  static unsigned getIndex(uint32_t Map, uint32_t Bit) {
+    return llvm::CountPopulation_32(Map & (Bit - 1));
+  }
+
+public:
+  explicit ImmutableHashMap(const Node *R) : Root(R) {}
+
+  class Factory {
+    llvm::BumpPtrAllocator &Allocator;
+    llvm::FoldingSet<Node> Cache;
+
+    Factory(const Factory &) LLVM_DELETED_FUNCTION;
+    void operator=(const Factory &) LLVM_DELETED_FUNCTION;
+
+    const Node *getNode(uint32_t DataMap, uint32_t NodeMap,
+                        ArrayRef<value_type> Data,
+                        ArrayRef<const Node *> Children) {
+      if (Data.empty() && Children.empty())
+        return nullptr;
+
+      llvm::FoldingSetNodeID ID;
+      Node::Profile(ID, DataMap, NodeMap, Data, Children);
+      void *InsertPos;
+      if (Node *N = Cache.FindNodeOrInsertPos(ID, InsertPos))
+        return N;
+
+      size_t Size = Node::getChildrenOffset(Data.size()) +
+                    Children.size() * sizeof(const Node *);
+      void *Mem = Allocator.Allocate(Size, llvm::alignOf<Node>());
+      Node *N = new (Mem) Node(DataMap, NodeMap, Data.size(),
+                               Children.size());
+      value_type *NewData = const_cast<value_type *>(N->data());
+      for (unsigned I = 0, E = Data.size(); I != E; ++I)
+        new (&NewData[I]) value_type(Data[I]);
+      std::copy(Children.begin(), Children.end(),
+                const_cast<const Node **>(N->children()));
+      Cache.InsertNode(N, InsertPos);
+      return N;
+    }
+
+    /// Returns the node holding the two entries \p A and \p B, whose keys
+    /// are distinct but agree on the bits of hash below \p Shift.
+    const Node *mergeEntries(const value_type &A, unsigned HashA,
+                             const value_type &B, unsigned HashB,
+                             unsigned Shift) {
+      if (Shift >= CollisionShift) {
+        value_type Data[2] = { A, B };
+        if (B.first < A.first)
+          std::swap(Data[0], Data[1]);
+        return getNode(0, 0, Data, None);
+      }
+
+      uint32_t BitA = getSlotBit(HashA, Shift), BitB = getSlotBit(HashB, Shift);
+      if (BitA == BitB) {
+        const Node *Child =
+          mergeEntries(A, HashA, B, HashB, Shift + BitsPerLevel);
+        return getNode(0, BitA, None, Child);
+      }
+
+      value_type Data[2] = { A, B };
+      if (BitB < BitA)
+        std::swap(Data[0], Data[1]);
+      return getNode(BitA | BitB, 0, Data, None);
+    }
+
+    const Node *add(const Node *N, const value_type &V, unsigned Hash,
+                    unsigned Shift) {
+      if (!N)
+        return getNode(getSlotBit(Hash, Shift), 0, V, None);
+
+      ArrayRef<value_type> Data(N->data(), N->NumData);
+      ArrayRef<const Node *> Children(N->children(), N->NumChildren);
+
+      if (Shift >= CollisionShift) {
+        SmallVector<value_type, 4> NewData(Data.begin(), Data.end());
+        typename SmallVectorImpl<value_type>::iterator I = NewData.begin();
+        while (I != NewData.end() && I->first < V.first)
+          ++I;
+        if (I != NewData.end() && I->first == V.first) {
+          if (I->second == V.second)
+            return N;
+          *I = V;
+        } else {
+          NewData.insert(I, V);
+        }
+        return getNode(0, 0, NewData, None);
+      }
+
+      uint32_t Bit = getSlotBit(Hash, Shift);
+      if (N->DataMap & Bit) {
+        unsigned Idx = getIndex(N->DataMap, Bit);
+        const value_type &Old = Data[Idx];
+        SmallVector<value_type, 8> NewData(Data.begin(), Data.end());
+        if (Old.first == V.first) {
+          if (Old.second == V.second)
+            return N;
+          NewData[Idx] = V;
+          return getNode(N->DataMap, N->NodeMap, NewData, Children);
+        }
+
+        // Push both entries down into a new child.
+        const Node *Child = mergeEntries(Old, InfoT::getHashValue(Old.first),
+                                         V, Hash, Shift + BitsPerLevel);
+        NewData.erase(NewData.begin() + Idx);
+        SmallVector<const Node *, 8> NewChildren(Children.begin(),
+                                                 Children.end());
+        NewChildren.insert(NewChildren.begin() + getIndex(N->NodeMap, Bit),
+                           Child);
+        return getNode(N->DataMap & ~Bit, N->NodeMap | Bit, NewData,
+                       NewChildren);
+      }
+
+      if (N->NodeMap & Bit) {
+        unsigned Idx = getIndex(N->NodeMap, Bit);
+        const Node *Child = add(Children[Idx], V, Hash, Shift + BitsPerLevel);
+        if (Child == Children[Idx])
+          return N;
+        SmallVector<const Node *, 8> NewChildren(Children.begin(),
+                                                 Children.end());
+        NewChildren[Idx] = Child;
+        return getNode(N->DataMap, N->NodeMap, Data, NewChildren);
+      }
+
+      SmallVector<value_type, 8> NewData(Data.begin(), Data.end());
+      NewData.insert(NewData.begin() + getIndex(N->DataMap, Bit), V);
+      return getNode(N->DataMap | Bit, N->NodeMap, NewData, Children);
+    }
+
+    const Node *remove(const Node *N, const KeyT &K, unsigned Hash,
+                       unsigned Shift) {
+      if (!N)
+        return N;
+
+      ArrayRef<value_type> Data(N->data(), N->NumData);
+      ArrayRef<const Node *> Children(N->children(), N->NumChildren);
+
+      if (Shift >= CollisionShift) {
+        SmallVector<value_type, 4> NewData;
+        for (unsigned I = 0, E = Data.size(); I != E; ++I)
+          if (!(Data[I].first == K))
+            NewData.push_back(Data[I]);
+        if (NewData.size() == Data.size())
+          return N;
+        return getNode(0, 0, NewData, None);
+      }
+
+      uint32_t Bit = getSlotBit(Hash, Shift);
+      if (N->DataMap & Bit) {
+        unsigned Idx = getIndex(N->DataMap, Bit);
+        if (!(Data[Idx].first == K))
+          return N;
+        SmallVector<value_type, 8> NewData(Data.begin(), Data.end());
+        NewData.erase(NewData.begin() + Idx);
+        return getNode(N->DataMap & ~Bit, N->NodeMap, NewData, Children);
+      }
+
+      if (!(N->NodeMap & Bit))
+        return N;
+
+      unsigned Idx = getIndex(N->NodeMap, Bit);
+      const Node *Child = remove(Children[Idx], K, Hash, Shift + BitsPerLevel);
+      if (Child == Children[Idx])
+        return N;
+
+      SmallVector<const Node *, 8> NewChildren(Children.begin(),
+                                               Children.end());
+      // Replace a child left with a single entry by the entry.
+      if (!Child || (Child->NumData == 1 && Child->NumChildren == 0)) {
+        NewChildren.erase(NewChildren.begin() + Idx);
+        if (!Child)
+          return getNode(N->DataMap, N->NodeMap & ~Bit, Data, NewChildren);
+        SmallVector<value_type, 8> NewData(Data.begin(), Data.end());
+        NewData.insert(NewData.begin() + getIndex(N->DataMap, Bit),
+                       Child->data()[0]);
+        return getNode(N->DataMap | Bit, N->NodeMap & ~Bit, NewData,
+                       NewChildren);
+      }
+
+      NewChildren[Idx] = Child;
+      return getNode(N->DataMap, N->NodeMap, Data, NewChildren);
+    }
+
+  public:
+    explicit Factory(llvm::BumpPtrAllocator &Alloc) : Allocator(Alloc) {}
+
+    ImmutableHashMap getEmptyMap() { return ImmutableHashMap(nullptr); }
+
+    ImmutableHashMap add(ImmutableHashMap Old, const KeyT &K, const DataT &D) {
+      return ImmutableHashMap(
+          add(Old.Root, value_type(K, D), InfoT::getHashValue(K), 0));
+    }
+
+    ImmutableHashMap remove(ImmutableHashMap Old, const KeyT &K) {
+      return ImmutableHashMap(remove(Old.Root, K, InfoT::getHashValue(K), 0));
+    }
+  };
+
+  const DataT *lookup(const KeyT &K) const {
+    unsigned Hash = InfoT::getHashValue(K);
+    const Node *N = Root;
+    for (unsigned Shift = 0; N; Shift += BitsPerLevel) {
+      if (Shift >= CollisionShift) {
+        for (unsigned I = 0, E = N->NumData; I != E; ++I)
+          if (N->data()[I].first == K)
+            return &N->data()[I].second;
+        return nullptr;
+      }
+
+      uint32_t Bit = getSlotBit(Hash, Shift);
+      if (N->DataMap & Bit) {
+        const value_type &V = N->data()[getIndex(N->DataMap, Bit)];
+        return V.first == K ? &V.second : nullptr;
+      }
+      if (!(N->NodeMap & Bit))
+        return nullptr;
+      N = N->children()[getIndex(N->NodeMap, Bit)];
+    }
+    return nullptr;
+  }
+
+  bool isEmpty() const { return !Root; }
+
+  const Node *getRoot() const { return Root; }
+
+  bool operator==(const ImmutableHashMap &RHS) const {
+    return Root == RHS.Root;
+  }
+  bool operator!=(const ImmutableHashMap &RHS) const {
+    return Root != RHS.Root;
+  }
+
+  void Profile(llvm::FoldingSetNodeID &ID) const { ID.AddPointer(Root); }
+
+  /// Iterates over the entries of a map, in the order of the slots of the
+  /// hashes of their keys.
+  class iterator {
+    /// The nodes being visited, with the position of the next entry or child
+    /// to visit in each.
+    SmallVector<std::pair<const Node *, unsigned>, 8> Stack;
+    const value_type *Cur;
+
+    void advance() {
+      while (!Stack.empty()) {
+        const Node *N = Stack.back().first;
+        unsigned Pos = Stack.back().second++;
+        if (Pos < N->getNumData()) {
+          Cur = &N->data()[Pos];
+          return;
+        }
+        Pos -= N->getNumData();
+        if (Pos < N->getNumChildren())
+          Stack.push_back(std::make_pair(N->getChild(Pos), 0u));
+        else
+          Stack.pop_back();
+      }
+      Cur = nullptr;
+    }
+
+  public:
+    iterator() : Cur(nullptr) {}
+    explicit iterator(const Node *Root) : Cur(nullptr) {
+      if (Root) {
+        Stack.push_back(std::make_pair(Root, 0u));
+        advance();
+      }
+    }
+
+    const value_type &operator*() const { return *Cur; }
+    const value_type *operator->() const { return Cur; }
+    const KeyT &getKey() const { return Cur->first; }
+    const DataT &getData() const { return Cur->second; }
+
+    iterator &operator++() {
+      advance();
+      return *this;
+    }
+
+    bool operator==(const iterator &RHS) const { return Cur == RHS.Cur; }
+    bool operator!=(const iterator &RHS) const { return Cur != RHS.Cur; }
+  };
+
+  iterator begin() const { return iterator(Root); }
+  iterator end() const { return iterator(); }
+};
+
+} // end namespace ento
+} // end namespace clang
+
+#endif
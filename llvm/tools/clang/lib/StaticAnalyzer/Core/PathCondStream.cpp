@@ -0,0 +1,227 @@
+//== PathCondStream.cpp - Binary path condition records ---------*- C++ -*--==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the writer and the reader of the binary record stream
+//  written by PathCondExtractor.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/PathCondStream.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace ento;
+using namespace pathcond;
+using namespace llvm::support;
+
+static const char StreamMagic[4] = { 'P', 'C', 'N', 'D' };
+
+/// The size of the kind and length fields preceding every payload.
+static const unsigned RecordHeaderSize = 1 + sizeof(uint32_t);
+
+//===----------------------------------------------------------------------===//
+// PathCondStreamWriter
+//===----------------------------------------------------------------------===//
+
+void PathCondStreamWriter::writeHeader(RecordKind K, unsigned Length) {
+  OS << static_cast<char>(K);
+  endian::Writer<little>(OS).write<uint32_t>(Length);
+}
+
+void PathCondStreamWriter::writeBeginFunction(StringRef FuncName) {
+  writeHeader(RK_BeginFunction,
+              sizeof(StreamMagic) + sizeof(uint32_t) + FuncName.size());
+  OS.write(StreamMagic, sizeof(StreamMagic));
+  endian::Writer<little>(OS).write<uint32_t>(StreamVersion);
+  OS << FuncName;
+}
+
+void PathCondStreamWriter::writeSignature(StringRef Sig) {
+  writeHeader(RK_Signature, Sig.size());
+  OS << Sig;
+}
+
+void PathCondStreamWriter::writeFragment(StringRef Fragment) {
+  writeHeader(RK_Fragment, Fragment.size());
+  OS << Fragment;
+}
+
+void PathCondStreamWriter::writePath(unsigned SigID,
+                                     ArrayRef<unsigned> Fragments) {
+  writeHeader(RK_Path, sizeof(uint32_t) * (1 + Fragments.size()));
+  endian::Writer<little> W(OS);
+  W.write<uint32_t>(SigID);
+  for (unsigned I = 0, E = Fragments.size(); I != E; ++I)
+    W.write<uint32_t>(Fragments[I]);
+}
+
+void PathCondStreamWriter::writeEndFunction() {
+  writeHeader(RK_EndFunction, 0);
+}
+
+//===----------------------------------------------------------------------===//
+// PathCondStreamReader
+//===----------------------------------------------------------------------===//
+
+static uint32_t readLE32(const char *P) {
+  return endian::read<uint32_t, little, unaligned>(P);
+}
+
+unsigned Record::getFragment(unsigned I) const {
+  assert(Kind == RK_Path && I < getNumFragments());
+  return readLE32(Text.data() + I * sizeof(uint32_t));
+}
+
+bool PathCondStreamReader::next(Record &R) {
+  if (Cur == End || hasError())
+    return false;
+
+  if (static_cast<size_t>(End - Cur) < RecordHeaderSize) {
+    Error = "truncated record header";
+    return false;
+  }
+
+  unsigned Kind = static_cast<unsigned char>(Cur[0]);
+  uint32_t Length = readLE32(Cur + 1);
+  const char *Payload = Cur + RecordHeaderSize;
+  if (static_cast<size_t>(End - Payload) < Length) {
+    Error = "truncated record payload";
+    return false;
+  }
+  Cur = Payload + Length;
+
+  R.Kind = static_cast<RecordKind>(Kind);
+  R.SigID = 0;
+  R.Text = StringRef(Payload, Length);
+
+  switch (Kind) {
+  case RK_BeginFunction:
+    if (Length < sizeof(StreamMagic) + sizeof(uint32_t) ||
+        memcmp(Payload, StreamMagic, sizeof(StreamMagic)) != 0) {
+      Error = "not a path condition stream";
+      return false;
+    }
+    if (readLE32(Payload + sizeof(StreamMagic)) != StreamVersion) {
+      Error = "unsupported path condition stream version";
+      return false;
+    }
+    R.Text = R.Text.drop_front(sizeof(StreamMagic) + sizeof(uint32_t));
+    return true;
+  case RK_Path:
+    if (Length < sizeof(uint32_t) || Length % sizeof(uint32_t) != 0) {
+      Error = "malformed path record";
+      return false;
+    }
+    R.SigID = readLE32(Payload);
+    R.Text = R.Text.drop_front(sizeof(uint32_t));
+    return true;
+  case RK_Signature:
+  case RK_Fragment:
+  case RK_EndFunction:
+    return true;
+  default:
+    Error = "unknown record kind";
+    return false;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Conversion to text
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct SignatureInfo {
+  StringRef Sig;
+  /// The RK_Path records of the paths reaching the signature.
+  SmallVector<Record, 4> Paths;
+};
+}
+
+static bool printFunction(ArrayRef<SignatureInfo> Sigs,
+                          ArrayRef<StringRef> Fragments, raw_ostream &OS) {
+  for (unsigned I = 0, E = Sigs.size(); I != E; ++I) {
+    const SignatureInfo &SI = Sigs[I];
+    OS << "###: \n@@<<\n";
+    for (unsigned P = 0, PE = SI.Paths.size(); P != PE; ++P) {
+      const Record &Path = SI.Paths[P];
+      OS << "\n@LOCATION: " << SI.Sig << "\n";
+      for (unsigned F = 0, FE = Path.getNumFragments(); F != FE; ++F) {
+        unsigned ID = Path.getFragment(F);
+        if (ID >= Fragments.size())
+          return false;
+        OS << Fragments[ID];
+      }
+    }
+    OS << "\n@@>>\n\n";
+  }
+  return true;
+}
+
+bool ento::convertPathCondStreamToText(StringRef Buffer, raw_ostream &OS,
+                                       std::string &Error) {
+  PathCondStreamReader Reader(Buffer);
+  SmallVector<SignatureInfo, 16> Sigs;
+  SmallVector<StringRef, 256> Fragments;
+  bool InFunction = false;
+  Record R;
+
+  while (Reader.next(R)) {
+    if (R.Kind != RK_BeginFunction && !InFunction) {
+      Error = "record outside of a function block";
+      return false;
+    }
+
+    switch (R.Kind) {
+    case RK_BeginFunction:
+      if (InFunction) {
+        Error = "unterminated function block";
+        return false;
+      }
+      InFunction = true;
+      Sigs.clear();
+      Fragments.clear();
+      break;
+    case RK_Signature:
+      Sigs.push_back(SignatureInfo());
+      Sigs.back().Sig = R.Text;
+      break;
+    case RK_Fragment:
+      Fragments.push_back(R.Text);
+      break;
+    case RK_Path:
+      if (R.SigID >= Sigs.size()) {
+        Error = "path record refers to an unknown signature";
+        return false;
+      }
+      Sigs[R.SigID].Paths.push_back(R);
+      break;
+    case RK_EndFunction:
+      if (!printFunction(Sigs, Fragments, OS)) {
+        Error = "path record refers to an unknown fragment";
+        return false;
+      }
+      InFunction = false;
+      break;
+    }
+  }
+
+  if (Reader.hasError()) {
+    Error = Reader.getError();
+    return false;
+  }
+  if (InFunction) {
+    Error = "unterminated function block";
+    return false;
+  }
+  return true;
+}
@@ -18,11 +18,19 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/SubEngine.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/TaintManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/CheckerContext.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/FssStmtPrinter.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace clang;
 using namespace ento;
 
+#define DEBUG_TYPE "ProgramState"
+
+STATISTIC(NumProgramStates, "The # of distinct program states created");
+
 namespace clang { namespace  ento {
 /// Increments the number of times this state is referenced.
 
@@ -34,76 +42,133 @@ void ProgramStateRetain(const ProgramState *state) {
 void ProgramStateRelease(const ProgramState *state) {
   assert(state->refCount > 0);
   ProgramState *s = const_cast<ProgramState*>(state);
-  
-  // We never deallocate historical ProgramState and its HistoricalEvent
-  // regardless its reference counter. 
-  // Historical ProgramState and HistoricalEvent will be eventually released
-  // at the destruction of the bump allocator. 
-  if (s->HxEv != nullptr) 
-    return; 
-
   if (--s->refCount == 0) {
     ProgramStateManager &Mgr = s->getStateManager();
     Mgr.StateSet.RemoveNode(s);
-
-    // It is the right place to deallocate HxEv. 
-    if (s->HxEv != nullptr) {
-      llvm::BumpPtrAllocator &A = Mgr.getAllocator();
-      A.Deallocate(s->HxEv, sizeof(*s->HxEv));
-    }
-
     s->~ProgramState();    
     Mgr.freeStates.push_back(s);
   }
 }
 }}
 
+//===----------------------------------------------------------------------===//
+// HistoricalEventManager
+//===----------------------------------------------------------------------===//
+
+const HistoricalEvent *
+HistoricalEventManager::getEvent(HistoricalEvent::Kind k, const Stmt *s,
+                                 const LocationContext *lctx,
+                                 const ProgramState *state) {
+  llvm::FoldingSetNodeID ID;
+  HistoricalEvent::Profile(ID, k, s, lctx, state);
+  void *InsertPos;
+
+  if (HistoricalEvent *E = Events.FindNodeOrInsertPos(ID, InsertPos))
+    return E;
+
+  HistoricalEvent *E = new (Alloc.Allocate<HistoricalEvent>())
+    HistoricalEvent(k, s, lctx, state);
+  ProgramStateRetain(state);
+  Events.InsertNode(E, InsertPos);
+  return E;
+}
+
+void HistoricalEventManager::collectPrevEventNodes(
+    const ExplodedNode *N, SmallVectorImpl<const ExplodedNode *> &Nodes) const {
+  SmallVector<const ExplodedNode *, 16> WorkList(N->pred_begin(),
+                                                 N->pred_end());
+  std::reverse(WorkList.begin(), WorkList.end());
+  llvm::SmallPtrSet<const ExplodedNode *, 32> Visited;
+  while (!WorkList.empty()) {
+    const ExplodedNode *P = WorkList.pop_back_val();
+    if (!Visited.insert(P).second)
+      continue;
+    if (NodeEvents.count(P)) {
+      Nodes.push_back(P);
+      continue;
+    }
+    for (ExplodedNode::const_pred_iterator I = P->pred_end(),
+                                           E = P->pred_begin(); I != E;)
+      WorkList.push_back(*--I);
+  }
+}
+
+const SmallVectorImpl<const ExplodedNode *> &
+HistoricalEventManager::getPrevEventNodes(const ExplodedNode *N) const {
+  std::pair<PrevEventMap::iterator, bool> R = PrevEventNodes.insert(
+    std::make_pair(N, SmallVector<const ExplodedNode *, 1>()));
+  if (R.second)
+    collectPrevEventNodes(N, R.first->second);
+  return R.first->second;
+}
+
+void HistoricalEventManager::getHistoricalEvents(
+    const ExplodedNode *N,
+    SmallVectorImpl<const HistoricalEvent *> &Events) const {
+  assert(Graph && "Event nodes need a graph");
+  if (Graph->getNumMerges() != NumMergesSeen) {
+    PrevEventNodes.clear();
+    NumMergesSeen = Graph->getNumMerges();
+  }
+
+  SmallVector<const ExplodedNode *, 4> Last;
+  if (NodeEvents.count(N))
+    Last.push_back(N);
+  else
+    collectPrevEventNodes(N, Last);
+
+  // Walk the DAG of events back from the last ones, and collect each event
+  // once all the events before it are collected.
+  llvm::SmallPtrSet<const ExplodedNode *, 32> Visited;
+  SmallVector<std::pair<const ExplodedNode *, unsigned>, 32> Stack;
+  for (SmallVectorImpl<const ExplodedNode *>::const_iterator
+         I = Last.begin(), E = Last.end(); I != E; ++I) {
+    if (!Visited.insert(*I).second)
+      continue;
+    Stack.push_back(std::make_pair(*I, 0U));
+    while (!Stack.empty()) {
+      const ExplodedNode *EN = Stack.back().first;
+      const SmallVectorImpl<const ExplodedNode *> &Prevs =
+        getPrevEventNodes(EN);
+      if (Stack.back().second < Prevs.size()) {
+        const ExplodedNode *P = Prevs[Stack.back().second++];
+        if (Visited.insert(P).second)
+          Stack.push_back(std::make_pair(P, 0U));
+        continue;
+      }
+      Events.push_back(NodeEvents.find(EN)->second);
+      Stack.pop_back();
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ProgramState
+//===----------------------------------------------------------------------===//
+
 ProgramState::ProgramState(ProgramStateManager *mgr, const Environment& env,
-                           StoreRef st, GenericDataMap gdm, bool isTransient, 
-                           HistoricalEvent *hxev)
+                 StoreRef st, GenericDataMap gdm)
   : stateMgr(mgr),
     Env(env),
     store(st.getStore()),
     GDM(gdm),
-    refCount(0),
-    PrevState(nullptr),
-    IsTransient(isTransient),
-    HxEv(hxev) {
+    refCount(0) {
   stateMgr->getStoreManager().incrementReferenceCount(store);
 }
 
-ProgramState::ProgramState(const ProgramState &RHS, bool isTransient)
+ProgramState::ProgramState(const ProgramState &RHS)
     : llvm::FoldingSetNode(),
       stateMgr(RHS.stateMgr),
       Env(RHS.Env),
       store(RHS.store),
       GDM(RHS.GDM),
-      refCount(0),
-      PrevState(&RHS),
-      IsTransient(isTransient),
-      HxEv(RHS.HxEv) {
+      refCount(0) {
   stateMgr->getStoreManager().incrementReferenceCount(store);
-
-  // Find my past
-  while (PrevState != nullptr && PrevState->IsTransient) {
-    PrevState = PrevState->PrevState;
-  }
-
-  // And hold my past until I pass away if I am persistent.
-  if (!IsTransient && PrevState != nullptr)
-    ProgramStateRetain(PrevState);
 }
 
 ProgramState::~ProgramState() {
   if (store)
     stateMgr->getStoreManager().decrementReferenceCount(store);
-
-  // Now, let my past go if I was persistent.
-  if (!IsTransient && PrevState != nullptr)
-    ProgramStateRelease(PrevState);
-
-  // Since a single HxEv can pointed by multiple ProgramState, 
-  // we should not free HxEv at here.
 }
 
 ProgramStateManager::ProgramStateManager(ASTContext &Ctx,
@@ -125,6 +190,12 @@ ProgramStateManager::~ProgramStateManager() {
     I->second.second(I->second.first);
 }
 
+FssRenderCache &ProgramStateManager::getRenderCache() {
+  if (!RenderCache)
+    RenderCache.reset(new FssRenderCache());
+  return *RenderCache;
+}
+
 ProgramStateRef 
 ProgramStateManager::removeDeadBindings(ProgramStateRef state,
                                    const StackFrameContext *LCtx,
@@ -144,7 +215,6 @@ ProgramStateManager::removeDeadBindings(ProgramStateRef state,
   StoreRef newStore = StoreMgr->removeDeadBindings(NewState.getStore(), LCtx,
                                                    SymReaper);
   NewState.setStore(newStore);
-  NewState.HxEv = nullptr;
   SymReaper.setReapedStore(newStore);
 
   ProgramStateRef Result = getPersistentState(NewState);
@@ -330,15 +400,18 @@ SVal ProgramState::getSVal(Loc location, QualType T) const {
 ProgramStateRef ProgramState::recordHistoricalEvent(CheckerContext &C, 
                                                     HistoricalEvent::Kind k,
                                                     const Stmt *s) const {
-  const LocationContext *lctx = C.getLocationContext();
-  llvm::BumpPtrAllocator &A = getStateManager().getAllocator();
-  ProgramState newState = *this;
-  newState.HxEv = A.Allocate<HistoricalEvent>();
-  new (newState.HxEv) HistoricalEvent(k, s, lctx);
-
-  ProgramStateRef newPsState = getStateManager().getPersistentState(newState);
-  C.addTransition(newPsState);
-  return newPsState;
+  HistoricalEventManager &HxEvMgr =
+    getStateManager().getHistoricalEventManager();
+  const HistoricalEvent *E =
+    HxEvMgr.getEvent(k, s, C.getLocationContext(), this);
+
+  // Leave the state alone and record the event at a node of its own. If the
+  // node already exists, another path with the same state got here first and
+  // recorded the same event.
+  static SimpleProgramPointTag Tag("ProgramState", "Historical event");
+  if (ExplodedNode *N = C.addTransition(this, &Tag))
+    HxEvMgr.recordAtNode(N, E);
+  return this;
 }
 
 ProgramStateRef ProgramState::BindExpr(const Stmt *S,
@@ -352,7 +425,6 @@ ProgramStateRef ProgramState::BindExpr(const Stmt *S,
 
   ProgramState NewSt = *this;
   NewSt.Env = NewEnv;
-  NewSt.HxEv = nullptr;
   return getStateManager().getPersistentState(NewSt);
 }
 
@@ -420,9 +492,7 @@ ProgramStateRef ProgramStateManager::getInitialState(const LocationContext *Init
   ProgramState State(this,
                      EnvMgr.getInitialEnvironment(),
                      StoreMgr->getInitialStore(InitLoc),
-                     GDMFactory.getEmptyMap(), 
-                     true,
-                     nullptr);
+                     GDMFactory.getEmptyMap());
 
   return getPersistentState(State);
 }
@@ -432,7 +502,6 @@ ProgramStateRef ProgramStateManager::getPersistentStateWithGDM(
                                                      ProgramStateRef GDMState) {
   ProgramState NewState(*FromState);
   NewState.GDM = GDMState->GDM;
-  NewState.HxEv = nullptr;
   return getPersistentState(NewState);
 }
 
@@ -452,15 +521,23 @@ ProgramStateRef ProgramStateManager::getPersistentState(ProgramState &State) {
   else {
     newState = (ProgramState*) Alloc.Allocate<ProgramState>();
   }
-  new (newState) ProgramState(State, false);
+  new (newState) ProgramState(State);
   StateSet.InsertNode(newState, InsertPos);
+  ++NumProgramStates;
   return newState;
 }
 
+void ProgramStateManager::addStoreMemoryUsage(StoreMemoryUsage &Usage) const {
+  llvm::DenseSet<const void *> Visited;
+  for (llvm::FoldingSet<ProgramState>::const_iterator I = StateSet.begin(),
+                                                      E = StateSet.end();
+       I != E; ++I)
+    StoreMgr->addMemoryUsage(I->getStore(), Visited, Usage);
+}
+
 ProgramStateRef ProgramState::makeWithStore(const StoreRef &store) const {
   ProgramState NewSt(*this);
   NewSt.setStore(store);
-  NewSt.HxEv = nullptr;
   return getStateManager().getPersistentState(NewSt);
 }
 
@@ -548,7 +625,6 @@ ProgramStateRef ProgramStateManager::addGDM(ProgramStateRef St, void *Key, void
 
   ProgramState NewSt = *St;
   NewSt.GDM = M2;
-  NewSt.HxEv = nullptr;
   return getPersistentState(NewSt);
 }
 
@@ -561,7 +637,6 @@ ProgramStateRef ProgramStateManager::removeGDM(ProgramStateRef state, void *Key)
 
   ProgramState NewState = *state;
   NewState.GDM = NewM;
-  NewState.HxEv = nullptr;
   return getPersistentState(NewState);
 }
 
@@ -14,16 +14,27 @@
 
 #include "SimpleConstraintManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/APSIntType.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/FssStmtPrinter.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramState.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "llvm/ADT/FoldingSet.h"
-#include "llvm/ADT/ImmutableSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <memory>
 
 using namespace clang;
 using namespace ento;
 
+#define DEBUG_TYPE "RangeConstraintManager"
+
+STATISTIC(NumRangeAssumes,
+          "The # of assumptions on the range of a symbol");
+STATISTIC(NumRangeSets, "The # of distinct range sets created");
+STATISTIC(RangeSetBytes, "The # of bytes allocated for range sets");
+
 /// A Range represents the closed range [from, to].  The caller must
 /// guarantee that from <= to.  Note that Range is immutable, so as not
 /// to subvert RangeSet's immutability.
@@ -55,59 +66,85 @@ public:
 };
 
 
-class RangeTrait : public llvm::ImutContainerInfo<Range> {
-public:
-  // When comparing if one Range is less than another, we should compare
-  // the actual APSInt values instead of their pointers.  This keeps the order
-  // consistent (instead of comparing by pointer values) and can potentially
-  // be used to speed up some of the operations in RangeSet.
-  static inline bool isLess(key_type_ref lhs, key_type_ref rhs) {
-    return *lhs.first < *rhs.first || (!(*rhs.first < *lhs.first) &&
-                                       *lhs.second < *rhs.second);
-  }
-};
-
 /// RangeSet contains a set of ranges. If the set is empty, then
 ///  there the value of a symbol is overly constrained and there are no
 ///  possible values for that symbol.
+///
+/// The ranges are kept sorted and disjoint in a contiguous array, which is
+/// uniqued by the Factory. A RangeSet is therefore a single pointer, and two
+/// sets built by the same factory are equal iff they share the array. Almost
+/// every symbol is constrained to one or two ranges, so an assumption scans a
+/// few adjacent pairs of (BasicValueFactory-owned) APSInt pointers.
 class RangeSet {
-  typedef llvm::ImmutableSet<Range, RangeTrait> PrimRangeSet;
-  PrimRangeSet ranges; // no need to make const, since it is an
-                       // ImmutableSet - this allows default operator=
-                       // to work.
+  /// The uniqued array of ranges, which immediately follows this header.
+  class Storage : public llvm::FoldingSetNode {
+    unsigned NumRanges;
+
+  public:
+    explicit Storage(unsigned NumRanges) : NumRanges(NumRanges) {}
+
+    const Range *begin() const {
+      return reinterpret_cast<const Range *>(this + 1);
+    }
+    const Range *end() const { return begin() + NumRanges; }
+    unsigned size() const { return NumRanges; }
+
+    static void Profile(llvm::FoldingSetNodeID &ID, ArrayRef<Range> Ranges) {
+      ID.AddInteger(Ranges.size());
+      for (unsigned I = 0, E = Ranges.size(); I != E; ++I)
+        Ranges[I].Profile(ID);
+    }
+    void Profile(llvm::FoldingSetNodeID &ID) const {
+      Profile(ID, llvm::makeArrayRef(begin(), end()));
+    }
+  };
+
+  const Storage *ranges;
+
+  RangeSet(const Storage *S) : ranges(S) {}
+
 public:
-  typedef PrimRangeSet::Factory Factory;
-  typedef PrimRangeSet::iterator iterator;
+  class Factory {
+    llvm::BumpPtrAllocator Alloc;
+    llvm::FoldingSet<Storage> Sets;
+
+  public:
+    /// Returns the set of the sorted, disjoint ranges \p Ranges.
+    RangeSet get(ArrayRef<Range> Ranges);
 
-  RangeSet(PrimRangeSet RS) : ranges(RS) {}
+    RangeSet getEmptySet() { return get(None); }
+  };
 
-  iterator begin() const { return ranges.begin(); }
-  iterator end() const { return ranges.end(); }
+  typedef const Range *iterator;
 
-  bool isEmpty() const { return ranges.isEmpty(); }
+  iterator begin() const { return ranges->begin(); }
+  iterator end() const { return ranges->end(); }
+
+  bool isEmpty() const { return ranges->size() == 0; }
 
   /// Construct a new RangeSet representing '{ [from, to] }'.
   RangeSet(Factory &F, const llvm::APSInt &from, const llvm::APSInt &to)
-    : ranges(F.add(F.getEmptySet(), Range(from, to))) {}
+    : ranges(F.get(Range(from, to)).ranges) {}
 
   /// Profile - Generates a hash profile of this RangeSet for use
   ///  by FoldingSet.
-  void Profile(llvm::FoldingSetNodeID &ID) const { ranges.Profile(ID); }
+  void Profile(llvm::FoldingSetNodeID &ID) const { ID.AddPointer(ranges); }
 
   /// getConcreteValue - If a symbol is contrained to equal a specific integer
   ///  constant then this method returns that value.  Otherwise, it returns
   ///  NULL.
   const llvm::APSInt* getConcreteValue() const {
-    return ranges.isSingleton() ? ranges.begin()->getConcreteValue() : nullptr;
+    return ranges->size() == 1 ? begin()->getConcreteValue() : nullptr;
   }
 
 private:
-  void IntersectInRange(BasicValueFactory &BV, Factory &F,
+  typedef SmallVector<Range, 4> RangeVector;
+
+  void IntersectInRange(BasicValueFactory &BV,
                         const llvm::APSInt &Lower,
                         const llvm::APSInt &Upper,
-                        PrimRangeSet &newRanges,
-                        PrimRangeSet::iterator &i,
-                        PrimRangeSet::iterator &e) const {
+                        RangeVector &newRanges,
+                        iterator &i, iterator &e) const {
     // There are six cases for each range R in the set:
     //   1. R is entirely before the intersection range.
     //   2. R is entirely after the intersection range.
@@ -126,24 +163,23 @@ private:
 
       if (i->Includes(Lower)) {
         if (i->Includes(Upper)) {
-          newRanges = F.add(newRanges, Range(BV.getValue(Lower),
-                                             BV.getValue(Upper)));
+          newRanges.push_back(Range(BV.getValue(Lower), BV.getValue(Upper)));
           break;
         } else
-          newRanges = F.add(newRanges, Range(BV.getValue(Lower), i->To()));
+          newRanges.push_back(Range(BV.getValue(Lower), i->To()));
       } else {
         if (i->Includes(Upper)) {
-          newRanges = F.add(newRanges, Range(i->From(), BV.getValue(Upper)));
+          newRanges.push_back(Range(i->From(), BV.getValue(Upper)));
           break;
         } else
-          newRanges = F.add(newRanges, *i);
+          newRanges.push_back(*i);
       }
     }
   }
 
   const llvm::APSInt &getMinValue() const {
     assert(!isEmpty());
-    return ranges.begin()->From();
+    return begin()->From();
   }
 
   bool pin(llvm::APSInt &Lower, llvm::APSInt &Upper) const {
@@ -240,20 +276,21 @@ public:
     if (!pin(Lower, Upper))
       return F.getEmptySet();
 
-    PrimRangeSet newRanges = F.getEmptySet();
+    // The ranges are produced in ascending order.
+    RangeVector newRanges;
 
-    PrimRangeSet::iterator i = begin(), e = end();
+    iterator i = begin(), e = end();
     if (Lower <= Upper)
-      IntersectInRange(BV, F, Lower, Upper, newRanges, i, e);
+      IntersectInRange(BV, Lower, Upper, newRanges, i, e);
     else {
       // The order of the next two statements is important!
       // IntersectInRange() does not reset the iteration state for i and e.
       // Therefore, the lower range most be handled first.
-      IntersectInRange(BV, F, BV.getMinValue(Upper), Upper, newRanges, i, e);
-      IntersectInRange(BV, F, Lower, BV.getMaxValue(Lower), newRanges, i, e);
+      IntersectInRange(BV, BV.getMinValue(Upper), Upper, newRanges, i, e);
+      IntersectInRange(BV, Lower, BV.getMaxValue(Lower), newRanges, i, e);
     }
 
-    return newRanges;
+    return F.get(newRanges);
   }
 
   void print(raw_ostream &os) const {
@@ -274,9 +311,31 @@ public:
   bool operator==(const RangeSet &other) const {
     return ranges == other.ranges;
   }
+
+  /// Returns an identity of this set. Sets built by the same factory have
+  /// the same identity iff they are equal.
+  const void *getIdentity() const { return ranges; }
 };
 } // end anonymous namespace
 
+RangeSet RangeSet::Factory::get(ArrayRef<Range> Ranges) {
+  llvm::FoldingSetNodeID ID;
+  Storage::Profile(ID, Ranges);
+  void *InsertPos;
+  if (Storage *S = Sets.FindNodeOrInsertPos(ID, InsertPos))
+    return S;
+
+  size_t Size = sizeof(Storage) + Ranges.size() * sizeof(Range);
+  void *Mem = Alloc.Allocate(Size, llvm::alignOf<Storage>());
+  Storage *S = new (Mem) Storage(Ranges.size());
+  std::uninitialized_copy(Ranges.begin(), Ranges.end(),
+                          const_cast<Range *>(S->begin()));
+  Sets.InsertNode(S, InsertPos);
+  ++NumRangeSets;
+  RangeSetBytes += Size;
+  return S;
+}
+
 REGISTER_TRAIT_WITH_PROGRAMSTATE(ConstraintRange,
                                  CLANG_ENTO_PROGRAMSTATE_MAP(SymbolRef,
                                                              RangeSet))
@@ -315,6 +374,8 @@ public:
   const llvm::APSInt* getSymVal(ProgramStateRef St,
                                 SymbolRef sym) const override;
   ConditionTruthVal checkNull(ProgramStateRef State, SymbolRef Sym) override;
+  bool getSymbolRanges(ProgramStateRef St, SymbolRef Sym,
+                       SmallVectorImpl<ValueRange> &Ranges) override;
 
   ProgramStateRef removeDeadBindings(ProgramStateRef St,
                                      SymbolReaper& SymReaper) override;
@@ -324,6 +385,12 @@ public:
 
   void print(CheckerContext &C, 
              ProgramStateRef St, raw_ostream &Out) override;
+
+  void getConstraintKeys(ProgramStateRef St,
+                         SmallVectorImpl<ConstraintKey> &Keys) override;
+
+  void printConstraint(ProgramStateRef St, SymbolRef Sym,
+                       raw_ostream &Out) override;
 private:
   RangeSet::Factory F;
 };
@@ -341,6 +408,17 @@ const llvm::APSInt* RangeConstraintManager::getSymVal(ProgramStateRef St,
   return T ? T->getConcreteValue() : nullptr;
 }
 
+bool RangeConstraintManager::getSymbolRanges(
+    ProgramStateRef St, SymbolRef Sym, SmallVectorImpl<ValueRange> &Ranges) {
+  const RangeSet *T = St->get<ConstraintRange>(Sym);
+  if (!T)
+    return false;
+
+  for (RangeSet::iterator I = T->begin(), E = T->end(); I != E; ++I)
+    Ranges.push_back(ValueRange(I->From(), I->To()));
+  return true;
+}
+
 ConditionTruthVal RangeConstraintManager::checkNull(ProgramStateRef State,
                                                     SymbolRef Sym) {
   const RangeSet *Ranges = State->get<ConstraintRange>(Sym);
@@ -433,6 +511,7 @@ RangeConstraintManager::assumeSymNE(ProgramStateRef St, SymbolRef Sym,
 
   // [Int-Adjustment+1, Int-Adjustment-1]
   // Notice that the lower bound is greater than the upper bound.
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, Upper, Lower);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -448,6 +527,7 @@ RangeConstraintManager::assumeSymEQ(ProgramStateRef St, SymbolRef Sym,
 
   // [Int-Adjustment, Int-Adjustment]
   llvm::APSInt AdjInt = AdjustmentType.convert(Int) - Adjustment;
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, AdjInt, AdjInt);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -477,6 +557,7 @@ RangeConstraintManager::assumeSymLT(ProgramStateRef St, SymbolRef Sym,
   llvm::APSInt Upper = ComparisonVal-Adjustment;
   --Upper;
 
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, Lower, Upper);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -506,6 +587,7 @@ RangeConstraintManager::assumeSymGT(ProgramStateRef St, SymbolRef Sym,
   llvm::APSInt Upper = Max-Adjustment;
   ++Lower;
 
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, Lower, Upper);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -535,6 +617,7 @@ RangeConstraintManager::assumeSymGE(ProgramStateRef St, SymbolRef Sym,
   llvm::APSInt Lower = ComparisonVal-Adjustment;
   llvm::APSInt Upper = Max-Adjustment;
 
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, Lower, Upper);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -564,6 +647,7 @@ RangeConstraintManager::assumeSymLE(ProgramStateRef St, SymbolRef Sym,
   llvm::APSInt Lower = Min-Adjustment;
   llvm::APSInt Upper = ComparisonVal-Adjustment;
 
+  ++NumRangeAssumes;
   RangeSet New = GetRange(St, Sym).Intersect(getBasicVals(), F, Lower, Upper);
   return New.isEmpty() ? nullptr : St->set<ConstraintRange>(Sym, New);
 }
@@ -605,3 +689,22 @@ void RangeConstraintManager::print(CheckerContext &C,
     Out << "\n";
   }
 }
+
+void RangeConstraintManager::getConstraintKeys(
+    ProgramStateRef St, SmallVectorImpl<ConstraintKey> &Keys) {
+  ConstraintRangeTy Ranges = St->get<ConstraintRange>();
+  for (ConstraintRangeTy::iterator I=Ranges.begin(), E=Ranges.end(); I!=E; ++I)
+    Keys.push_back(std::make_pair(I.getKey(), I.getData().getIdentity()));
+}
+
+void RangeConstraintManager::printConstraint(ProgramStateRef St,
+                                             SymbolRef Sym,
+                                             raw_ostream &Out) {
+  const RangeSet *Ranges = St->get<ConstraintRange>(Sym);
+  assert(Ranges && "Symbol is not constrained");
+  Out << "@CONDITION: ";
+  St->getStateManager().getRenderCache().print(Out, Sym, 0);
+  Out << " : ";
+  Ranges->print(Out);
+  Out << "\n";
+}
@@ -25,6 +25,8 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramState.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SubEngine.h"
+#include "ImmutableHashMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ImmutableList.h"
 #include "llvm/ADT/ImmutableMap.h"
 #include "llvm/ADT/Optional.h"
@@ -89,6 +91,10 @@ public:
     ID.AddInteger(Data);
   }
 
+  unsigned getHashValue() const {
+    return llvm::hash_combine(P.getOpaqueValue(), Data);
+  }
+
   static BindingKey Make(const MemRegion *R, Kind k);
 
   bool operator<(const BindingKey &X) const {
@@ -139,8 +145,122 @@ LLVM_DUMP_METHOD void BindingKey::dump() const { llvm::errs() << *this; }
 // Actual Store type.
 //===----------------------------------------------------------------------===//
 
-typedef llvm::ImmutableMap<BindingKey, SVal>    ClusterBindings;
-typedef llvm::ImmutableMapRef<BindingKey, SVal> ClusterBindingsRef;
+namespace {
+struct BindingKeyHashInfo {
+  static unsigned getHashValue(const BindingKey &K) {
+    return K.getHashValue();
+  }
+};
+
+/// The bindings of a cluster. They are kept in an AVL tree, or, with
+/// '-analyzer-store=region-hash-trie', in a hash array mapped trie, which
+/// takes fewer steps to look up and update the clusters of the structs with
+/// many fields.
+class ClusterBindings {
+public:
+  typedef llvm::ImmutableMap<BindingKey, SVal> TreeMap;
+  typedef ImmutableHashMap<BindingKey, SVal, BindingKeyHashInfo> TrieMap;
+
+private:
+  /// The representation chosen by the factory; the other one is empty.
+  TreeMap Tree;
+  TrieMap Trie;
+
+  ClusterBindings(TreeMap Tree, TrieMap Trie) : Tree(Tree), Trie(Trie) {}
+
+public:
+  class Factory {
+    TreeMap::Factory TreeF;
+    TrieMap::Factory TrieF;
+    bool UseTrie;
+
+  public:
+    Factory(llvm::BumpPtrAllocator &Alloc, bool UseTrie)
+      : TreeF(Alloc), TrieF(Alloc), UseTrie(UseTrie) {}
+
+    ClusterBindings getEmptyMap() {
+      return ClusterBindings(TreeF.getEmptyMap(), TrieF.getEmptyMap());
+    }
+
+    ClusterBindings add(const ClusterBindings &Old, BindingKey K, SVal V) {
+      if (UseTrie)
+        return ClusterBindings(Old.Tree, TrieF.add(Old.Trie, K, V));
+      return ClusterBindings(TreeF.add(Old.Tree, K, V), Old.Trie);
+    }
+
+    ClusterBindings remove(const ClusterBindings &Old, BindingKey K) {
+      if (UseTrie)
+        return ClusterBindings(Old.Tree, TrieF.remove(Old.Trie, K));
+      return ClusterBindings(TreeF.remove(Old.Tree, K), Old.Trie);
+    }
+  };
+
+  class iterator {
+    TreeMap::iterator TreeI;
+    TrieMap::iterator TrieI;
+    bool InTrie;
+
+  public:
+    iterator(TreeMap::iterator TreeI, TrieMap::iterator TrieI, bool InTrie)
+      : TreeI(TreeI), TrieI(TrieI), InTrie(InTrie) {}
+
+    const BindingKey &getKey() const {
+      return InTrie ? TrieI.getKey() : TreeI.getKey();
+    }
+    const SVal &getData() const {
+      return InTrie ? TrieI.getData() : TreeI.getData();
+    }
+    std::pair<BindingKey, SVal> operator*() const {
+      return std::make_pair(getKey(), getData());
+    }
+
+    iterator &operator++() {
+      if (InTrie)
+        ++TrieI;
+      else
+        ++TreeI;
+      return *this;
+    }
+
+    bool operator==(const iterator &RHS) const {
+      return InTrie ? TrieI == RHS.TrieI : TreeI == RHS.TreeI;
+    }
+    bool operator!=(const iterator &RHS) const { return !(*this == RHS); }
+  };
+
+  iterator begin() const {
+    return iterator(Tree.begin(), Trie.begin(), !Trie.isEmpty());
+  }
+  iterator end() const {
+    return iterator(Tree.end(), Trie.end(), !Trie.isEmpty());
+  }
+
+  const SVal *lookup(BindingKey K) const {
+    if (!Trie.isEmpty())
+      return Trie.lookup(K);
+    return Tree.lookup(K);
+  }
+
+  bool isEmpty() const { return Tree.isEmpty() && Trie.isEmpty(); }
+
+  const TreeMap::TreeTy *getTreeRoot() const {
+    return Tree.getRootWithoutRetain();
+  }
+  const TrieMap::Node *getTrieRoot() const { return Trie.getRoot(); }
+
+  bool operator==(const ClusterBindings &RHS) const {
+    return Tree == RHS.Tree && Trie == RHS.Trie;
+  }
+
+  void Profile(llvm::FoldingSetNodeID &ID) const {
+    if (!Trie.isEmpty())
+      ID.AddPointer(Trie.getRoot());
+    else
+      ID.AddPointer(Tree.getRootWithoutRetain());
+  }
+};
+} // end anonymous namespace
+
 typedef std::pair<BindingKey, SVal> BindingPair;
 
 typedef llvm::ImmutableMap<const MemRegion *, ClusterBindings>
@@ -298,16 +418,23 @@ struct maximal_features_tag {};
 
 class RegionStoreFeatures {
   bool SupportsFields;
+  bool UsesHashTrie;
 public:
   RegionStoreFeatures(minimal_features_tag) :
-    SupportsFields(false) {}
+    SupportsFields(false), UsesHashTrie(false) {}
 
   RegionStoreFeatures(maximal_features_tag) :
-    SupportsFields(true) {}
+    SupportsFields(true), UsesHashTrie(false) {}
 
   void enableFields(bool t) { SupportsFields = t; }
 
   bool supportsFields() const { return SupportsFields; }
+
+  /// Keep the bindings of each cluster in a hash array mapped trie rather
+  /// than an AVL tree.
+  void enableHashTrie(bool t) { UsesHashTrie = t; }
+
+  bool usesHashTrie() const { return UsesHashTrie; }
 };
 }
 
@@ -350,7 +477,8 @@ private:
 public:
   RegionStoreManager(ProgramStateManager& mgr, const RegionStoreFeatures &f)
     : StoreManager(mgr), Features(f),
-      RBFactory(mgr.getAllocator()), CBFactory(mgr.getAllocator()),
+      RBFactory(mgr.getAllocator()),
+      CBFactory(mgr.getAllocator(), f.usesHashTrie()),
       SmallStructLimit(0) {
     if (SubEngine *Eng = StateMgr.getOwningEngine()) {
       AnalyzerOptions &Options = Eng->getAnalysisManager().options;
@@ -585,6 +713,9 @@ public: // Part of public interface to class.
   void print(Store store, raw_ostream &Out, const char* nl,
              const char *sep) override;
 
+  void addMemoryUsage(Store store, llvm::DenseSet<const void *> &Visited,
+                      StoreMemoryUsage &Usage) override;
+
   void iterBindings(Store store, BindingsHandler& f) override {
     RegionBindingsRef B = getRegionBindings(store);
     for (RegionBindingsRef::iterator I = B.begin(), E = B.end(); I != E; ++I) {
@@ -616,6 +747,13 @@ ento::CreateRegionStoreManager(ProgramStateManager &StMgr) {
   return llvm::make_unique<RegionStoreManager>(StMgr, F);
 }
 
+std::unique_ptr<StoreManager>
+ento::CreateHashTrieRegionStoreManager(ProgramStateManager &StMgr) {
+  RegionStoreFeatures F = maximal_features_tag();
+  F.enableHashTrie(true);
+  return llvm::make_unique<RegionStoreManager>(StMgr, F);
+}
+
 std::unique_ptr<StoreManager>
 ento::CreateFieldsOnlyRegionStoreManager(ProgramStateManager &StMgr) {
   RegionStoreFeatures F = minimal_features_tag();
@@ -918,11 +1056,11 @@ RegionStoreManager::removeSubRegionBindings(RegionBindingsConstRef B,
   collectSubRegionBindings(Bindings, svalBuilder, *Cluster, Top, TopKey,
                            /*IncludeAllDefaultBindings=*/false);
 
-  ClusterBindingsRef Result(*Cluster, CBFactory);
+  ClusterBindings Result = *Cluster;
   for (SmallVectorImpl<BindingPair>::const_iterator I = Bindings.begin(),
                                                     E = Bindings.end();
        I != E; ++I)
-    Result = Result.remove(I->first);
+    Result = CBFactory.remove(Result, I->first);
 
   // If we're invalidating a region with a symbolic offset, we need to make sure
   // we don't treat the base region as uninitialized anymore.
@@ -930,13 +1068,14 @@ RegionStoreManager::removeSubRegionBindings(RegionBindingsConstRef B,
   // collectSubRegionBindings.
   if (TopKey.hasSymbolicOffset()) {
     const SubRegion *Concrete = TopKey.getConcreteOffsetRegion();
-    Result = Result.add(BindingKey::Make(Concrete, BindingKey::Default),
-                        UnknownVal());
+    Result = CBFactory.add(Result,
+                           BindingKey::Make(Concrete, BindingKey::Default),
+                           UnknownVal());
   }
 
   if (Result.isEmpty())
     return B.remove(ClusterHead);
-  return B.add(ClusterHead, Result.asImmutableMap());
+  return B.add(ClusterHead, Result);
 }
 
 namespace {
@@ -2361,3 +2500,65 @@ void RegionStoreManager::print(Store store, raw_ostream &OS,
      << " :" << nl;
   B.dump(OS, nl);
 }
+
+/// Adds the bytes of the nodes of the persistent tree \p Root which are not
+/// in \p Visited, and records them there.
+template <typename TreeTy>
+static uint64_t addTreeMemoryUsage(const TreeTy *Root,
+                                   llvm::DenseSet<const void *> &Visited) {
+  uint64_t Bytes = 0;
+  SmallVector<const TreeTy *, 32> WL;
+  WL.push_back(Root);
+  while (!WL.empty()) {
+    const TreeTy *T = WL.pop_back_val();
+    // Trees share their unchanged subtrees, which need not be walked again.
+    if (!T || !Visited.insert(T).second)
+      continue;
+    Bytes += sizeof(TreeTy);
+    WL.push_back(T->getLeft());
+    WL.push_back(T->getRight());
+  }
+  return Bytes;
+}
+
+/// Adds the bytes of the nodes of the hash trie \p Root which are not in
+/// \p Visited, and records them there.
+static uint64_t addTrieMemoryUsage(const ClusterBindings::TrieMap::Node *Root,
+                                   llvm::DenseSet<const void *> &Visited) {
+  uint64_t Bytes = 0;
+  SmallVector<const ClusterBindings::TrieMap::Node *, 32> WL;
+  WL.push_back(Root);
+  while (!WL.empty()) {
+    const ClusterBindings::TrieMap::Node *N = WL.pop_back_val();
+    if (!N || !Visited.insert(N).second)
+      continue;
+    Bytes += N->getSize();
+    for (unsigned I = 0, E = N->getNumChildren(); I != E; ++I)
+      WL.push_back(N->getChild(I));
+  }
+  return Bytes;
+}
+
+void RegionStoreManager::addMemoryUsage(Store store,
+                                        llvm::DenseSet<const void *> &Visited,
+                                        StoreMemoryUsage &Usage) {
+  SmallVector<const RegionBindings::TreeTy *, 32> WL;
+  WL.push_back(static_cast<const RegionBindings::TreeTy *>(store));
+  while (!WL.empty()) {
+    const RegionBindings::TreeTy *T = WL.pop_back_val();
+    if (!T || !Visited.insert(T).second)
+      continue;
+    Usage.MapBytes += sizeof(RegionBindings::TreeTy);
+    WL.push_back(T->getLeft());
+    WL.push_back(T->getRight());
+
+    const ClusterBindings &Cluster = T->getValue().second;
+    const void *ClusterRoot = Cluster.getTreeRoot();
+    if (!ClusterRoot)
+      ClusterRoot = Cluster.getTrieRoot();
+    if (ClusterRoot && !Visited.count(ClusterRoot))
+      ++Usage.NumClusters;
+    Usage.ClusterBytes += addTreeMemoryUsage(Cluster.getTreeRoot(), Visited);
+    Usage.ClusterBytes += addTrieMemoryUsage(Cluster.getTrieRoot(), Visited);
+  }
+}
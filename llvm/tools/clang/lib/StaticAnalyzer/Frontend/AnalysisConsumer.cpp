@@ -24,12 +24,14 @@
 #include "clang/Analysis/CallGraph.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/StaticAnalyzer/Checkers/LocalCheckers.h"
 #include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
 #include "clang/StaticAnalyzer/Core/BugReporter/BugReporter.h"
 #include "clang/StaticAnalyzer/Core/BugReporter/PathDiagnostic.h"
 #include "clang/StaticAnalyzer/Core/CheckerManager.h"
+#include "clang/StaticAnalyzer/Core/FunctionDigest.h"
 #include "clang/StaticAnalyzer/Core/PathDiagnosticConsumers.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
@@ -39,15 +41,28 @@
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Config/config.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "ModelInjector.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <memory>
 #include <queue>
 
+#ifdef LLVM_ON_UNIX
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace clang;
 using namespace ento;
 using llvm::SmallPtrSet;
@@ -86,12 +101,206 @@ void ento::createTextPathDiagnosticConsumer(AnalyzerOptions &AnalyzerOpts,
 }
 
 namespace {
+/// \brief A diagnostic of the ClangDiags consumer, reduced to the messages it
+/// prints and to what orders it among the others, so that it can be written
+/// to a file and emitted by another process sharing the source manager.
+struct FlatDiagnostic {
+  struct Message {
+    bool IsNote;
+    SourceLocation Loc;
+    SmallVector<SourceRange, 4> Ranges;
+    std::string Text;
+  };
+
+  SourceLocation Loc;
+  SourceLocation DeclLoc;
+  std::string BugType;
+  std::string Category;
+  std::string VerboseDescription;
+  std::string ShortDescription;
+  std::vector<Message> Messages;
+};
+
+static void writeString(raw_ostream &OS, StringRef S) {
+  OS << S.size() << ':' << S << '\n';
+}
+
+static void writeLocation(raw_ostream &OS, SourceLocation Loc) {
+  OS << Loc.getRawEncoding() << '\n';
+}
+
+/// Reads the number at the start of \p Buffer, up to \p Delimiter.
+static bool readNumber(StringRef &Buffer, unsigned &N, char Delimiter = '\n') {
+  size_t End = Buffer.find(Delimiter);
+  if (End == StringRef::npos || Buffer.substr(0, End).getAsInteger(10, N))
+    return false;
+  Buffer = Buffer.drop_front(End + 1);
+  return true;
+}
+
+static bool readString(StringRef &Buffer, std::string &S) {
+  unsigned Size;
+  if (!readNumber(Buffer, Size, ':') || Buffer.size() < Size + 1 ||
+      Buffer[Size] != '\n')
+    return false;
+  S = Buffer.substr(0, Size);
+  Buffer = Buffer.drop_front(Size + 1);
+  return true;
+}
+
+static bool readLocation(StringRef &Buffer, SourceLocation &Loc) {
+  unsigned Raw;
+  if (!readNumber(Buffer, Raw))
+    return false;
+  Loc = SourceLocation::getFromRawEncoding(Raw);
+  return true;
+}
+
+static void writeFlatDiagnostic(raw_ostream &OS, const FlatDiagnostic &D) {
+  writeLocation(OS, D.Loc);
+  writeLocation(OS, D.DeclLoc);
+  writeString(OS, D.BugType);
+  writeString(OS, D.Category);
+  writeString(OS, D.VerboseDescription);
+  writeString(OS, D.ShortDescription);
+  OS << D.Messages.size() << '\n';
+  for (const FlatDiagnostic::Message &M : D.Messages) {
+    OS << M.IsNote << '\n';
+    writeLocation(OS, M.Loc);
+    OS << M.Ranges.size() << '\n';
+    for (SourceRange R : M.Ranges) {
+      writeLocation(OS, R.getBegin());
+      writeLocation(OS, R.getEnd());
+    }
+    writeString(OS, M.Text);
+  }
+}
+
+static bool readFlatDiagnostic(StringRef &Buffer, FlatDiagnostic &D) {
+  unsigned NumMessages;
+  if (!readLocation(Buffer, D.Loc) || !readLocation(Buffer, D.DeclLoc) ||
+      !readString(Buffer, D.BugType) || !readString(Buffer, D.Category) ||
+      !readString(Buffer, D.VerboseDescription) ||
+      !readString(Buffer, D.ShortDescription) ||
+      !readNumber(Buffer, NumMessages))
+    return false;
+  D.Messages.resize(NumMessages);
+  for (FlatDiagnostic::Message &M : D.Messages) {
+    unsigned IsNote, NumRanges;
+    if (!readNumber(Buffer, IsNote) || !readLocation(Buffer, M.Loc) ||
+        !readNumber(Buffer, NumRanges))
+      return false;
+    M.IsNote = IsNote;
+    M.Ranges.resize(NumRanges);
+    for (SourceRange &R : M.Ranges) {
+      SourceLocation Begin, End;
+      if (!readLocation(Buffer, Begin) || !readLocation(Buffer, End))
+        return false;
+      R = SourceRange(Begin, End);
+    }
+    if (!readString(Buffer, M.Text))
+      return false;
+  }
+  return true;
+}
+
+static Optional<bool> compareLocations(const SourceManager &SM,
+                                       SourceLocation X, SourceLocation Y) {
+  if (X == Y)
+    return None;
+  if (X.isInvalid() || Y.isInvalid())
+    return X.isInvalid();
+  return SM.isBeforeInTranslationUnit(X, Y);
+}
+
+/// Orders the diagnostics as PathDiagnosticConsumer::FlushDiagnostics does,
+/// except that the paths are only compared by their messages.
+static bool compareFlatDiagnostics(const SourceManager &SM,
+                                   const FlatDiagnostic &X,
+                                   const FlatDiagnostic &Y) {
+  if (Optional<bool> B = compareLocations(SM, X.Loc, Y.Loc))
+    return *B;
+  if (X.BugType != Y.BugType)
+    return X.BugType < Y.BugType;
+  if (X.Category != Y.Category)
+    return X.Category < Y.Category;
+  if (X.VerboseDescription != Y.VerboseDescription)
+    return X.VerboseDescription < Y.VerboseDescription;
+  if (X.ShortDescription != Y.ShortDescription)
+    return X.ShortDescription < Y.ShortDescription;
+  if (Optional<bool> B = compareLocations(SM, X.DeclLoc, Y.DeclLoc))
+    return *B;
+  if (X.Messages.size() != Y.Messages.size())
+    return X.Messages.size() < Y.Messages.size();
+  for (unsigned I = 0, E = X.Messages.size(); I != E; ++I) {
+    if (Optional<bool> B =
+            compareLocations(SM, X.Messages[I].Loc, Y.Messages[I].Loc))
+      return *B;
+    if (X.Messages[I].Text != Y.Messages[I].Text)
+      return X.Messages[I].Text < Y.Messages[I].Text;
+  }
+  return false;
+}
+
 class ClangDiagPathDiagConsumer : public PathDiagnosticConsumer {
   DiagnosticsEngine &Diag;
   bool IncludePath;
+
+  /// The diagnostics read from other processes, which are emitted with the
+  /// ones of this process.
+  std::vector<FlatDiagnostic> ReadDiags;
+
+  /// If set, the diagnostics are written to this stream instead of emitted.
+  raw_ostream *WriteOS;
+
+  FlatDiagnostic flatten(const PathDiagnostic &PD) const {
+    FlatDiagnostic D;
+    D.Loc = PD.getLocation().asLocation();
+    if (const Decl *DeclWithIssue = PD.getDeclWithIssue())
+      D.DeclLoc = DeclWithIssue->getLocation();
+    D.BugType = PD.getBugType();
+    D.Category = PD.getCategory();
+    D.VerboseDescription = PD.getVerboseDescription();
+    D.ShortDescription = PD.getShortDescription();
+
+    FlatDiagnostic::Message Warning;
+    Warning.IsNote = false;
+    Warning.Loc = D.Loc;
+    ArrayRef<SourceRange> Ranges = PD.path.back()->getRanges();
+    Warning.Ranges.append(Ranges.begin(), Ranges.end());
+    Warning.Text = PD.getShortDescription();
+    D.Messages.push_back(Warning);
+    if (!IncludePath)
+      return D;
+
+    PathPieces FlatPath = PD.path.flatten(/*ShouldFlattenMacros=*/true);
+    for (PathPieces::const_iterator PI = FlatPath.begin(), PE = FlatPath.end();
+         PI != PE; ++PI) {
+      FlatDiagnostic::Message Note;
+      Note.IsNote = true;
+      Note.Loc = (*PI)->getLocation().asLocation();
+      ArrayRef<SourceRange> Ranges = (*PI)->getRanges();
+      Note.Ranges.append(Ranges.begin(), Ranges.end());
+      Note.Text = (*PI)->getString();
+      D.Messages.push_back(Note);
+    }
+    return D;
+  }
+
+  void emit(const FlatDiagnostic &D) {
+    unsigned WarnID = Diag.getCustomDiagID(DiagnosticsEngine::Warning, "%0");
+    unsigned NoteID = Diag.getCustomDiagID(DiagnosticsEngine::Note, "%0");
+    for (const FlatDiagnostic::Message &M : D.Messages) {
+      DiagnosticBuilder B = Diag.Report(M.Loc, M.IsNote ? NoteID : WarnID);
+      B << M.Text;
+      for (SourceRange R : M.Ranges)
+        B << R;
+    }
+  }
+
 public:
   ClangDiagPathDiagConsumer(DiagnosticsEngine &Diag)
-    : Diag(Diag), IncludePath(false) {}
+    : Diag(Diag), IncludePath(false), WriteOS(nullptr) {}
   virtual ~ClangDiagPathDiagConsumer() {}
   StringRef getName() const override { return "ClangDiags"; }
 
@@ -106,30 +315,57 @@ public:
     IncludePath = true;
   }
 
+  /// Writes the diagnostics collected so far to \p OS instead of emitting
+  /// them, and keeps collecting the later ones.
+  void WriteCollectedDiagnostics(raw_ostream &OS) {
+    WriteOS = &OS;
+    FlushDiagnostics(nullptr);
+    flushed = false;
+    WriteOS = nullptr;
+  }
+
+  /// Reads the diagnostics written by WriteCollectedDiagnostics in a process
+  /// sharing the source manager of this one. They are emitted in order with
+  /// the diagnostics of this process. Returns false if \p Buffer is malformed.
+  bool ReadDiagnostics(StringRef Buffer) {
+    std::vector<FlatDiagnostic> Diags;
+    while (!Buffer.empty()) {
+      Diags.push_back(FlatDiagnostic());
+      if (!readFlatDiagnostic(Buffer, Diags.back()))
+        return false;
+    }
+    ReadDiags.insert(ReadDiags.end(), Diags.begin(), Diags.end());
+    return true;
+  }
+
   void FlushDiagnosticsImpl(std::vector<const PathDiagnostic *> &Diags,
                             FilesMade *filesMade) override {
-    unsigned WarnID = Diag.getCustomDiagID(DiagnosticsEngine::Warning, "%0");
-    unsigned NoteID = Diag.getCustomDiagID(DiagnosticsEngine::Note, "%0");
+    if (WriteOS) {
+      for (const PathDiagnostic *PD : Diags)
+        writeFlatDiagnostic(*WriteOS, flatten(*PD));
+      return;
+    }
 
-    for (std::vector<const PathDiagnostic*>::iterator I = Diags.begin(),
-         E = Diags.end(); I != E; ++I) {
-      const PathDiagnostic *PD = *I;
-      SourceLocation WarnLoc = PD->getLocation().asLocation();
-      Diag.Report(WarnLoc, WarnID) << PD->getShortDescription()
-                                   << PD->path.back()->getRanges();
-
-      if (!IncludePath)
-        continue;
-
-      PathPieces FlatPath = PD->path.flatten(/*ShouldFlattenMacros=*/true);
-      for (PathPieces::const_iterator PI = FlatPath.begin(),
-                                      PE = FlatPath.end();
-           PI != PE; ++PI) {
-        SourceLocation NoteLoc = (*PI)->getLocation().asLocation();
-        Diag.Report(NoteLoc, NoteID) << (*PI)->getString()
-                                     << (*PI)->getRanges();
-      }
+    if (ReadDiags.empty()) {
+      for (const PathDiagnostic *PD : Diags)
+        emit(flatten(*PD));
+      return;
     }
+
+    // Merge the diagnostics read from other processes, dropping the ones
+    // found more than once, as the folding set of the consumer would have.
+    std::vector<FlatDiagnostic> All;
+    All.swap(ReadDiags);
+    for (const PathDiagnostic *PD : Diags)
+      All.push_back(flatten(*PD));
+    const SourceManager &SM = Diag.getSourceManager();
+    auto Less = [&SM](const FlatDiagnostic &X, const FlatDiagnostic &Y) {
+      return compareFlatDiagnostics(SM, X, Y);
+    };
+    std::stable_sort(All.begin(), All.end(), Less);
+    for (unsigned I = 0, E = All.size(); I != E; ++I)
+      if (I == 0 || Less(All[I - 1], All[I]))
+        emit(All[I]);
   }
 };
 } // end anonymous namespace
@@ -172,6 +408,9 @@ public:
   // Set of PathDiagnosticConsumers.  Owned by AnalysisManager.
   PathDiagnosticConsumers PathConsumers;
 
+  /// The consumer printing the diagnostics on stderr, if any.
+  ClangDiagPathDiagConsumer *ClangDiags;
+
   StoreManagerCreator CreateStoreMgr;
   ConstraintManagerCreator CreateConstraintMgr;
 
@@ -191,7 +430,8 @@ public:
                    ArrayRef<std::string> plugins,
                    CodeInjector *injector)
     : RecVisitorMode(0), RecVisitorBR(nullptr), Ctx(nullptr), PP(pp),
-      OutDir(outdir), Opts(opts), Plugins(plugins), Injector(injector) {
+      OutDir(outdir), Opts(opts), Plugins(plugins), Injector(injector),
+      ClangDiags(nullptr) {
     DigestAnalyzerOptions();
     if (Opts->PrintStats) {
       llvm::EnableStatistics();
@@ -210,6 +450,7 @@ public:
       ClangDiagPathDiagConsumer *clangDiags =
           new ClangDiagPathDiagConsumer(PP.getDiagnostics());
       PathConsumers.push_back(clangDiags);
+      ClangDiags = clangDiags;
 
       if (Opts->AnalysisDiagOpt == PD_TEXT) {
         clangDiags->enablePaths();
@@ -314,6 +555,17 @@ public:
   /// use it to define the order in which the functions should be visited.
   void HandleDeclsCallGraph(const unsigned LocalTUDeclsSize);
 
+  /// \brief Explore the top level functions of the call graph in separate
+  /// worker processes and replay their results in the serial order.
+  /// Returns false if the parallel mode could not be set up, in which case
+  /// nothing has been analyzed.
+  bool HandleDeclsCallGraphInParallel(CallGraph &CG, unsigned NumJobs);
+
+  /// \brief The loop run by each worker process of the parallel mode.
+  void RunAnalysisWorker(CallGraph &CG, ArrayRef<Decl *> Order,
+                         const llvm::DenseMap<const Decl *, unsigned> &Index,
+                         std::atomic<unsigned> *Slots, StringRef ResultDir);
+
   /// \brief Run analyzes(syntax or path sensitive) on the given function.
   /// \param Mode - determines if we are requesting syntax only or path
   /// sensitive only analysis.
@@ -324,6 +576,13 @@ public:
                   ExprEngine::InliningModes IMode = ExprEngine::Inline_Minimal,
                   SetOfConstDecls *VisitedCallees = nullptr);
 
+  /// \brief Run the path sensitive analysis of the top level function \p D,
+  /// or replay its cached results if neither it nor any of the functions it
+  /// may inline changed since they were computed.
+  void HandleCodeCached(CallGraph &CG, Decl *D,
+                        ExprEngine::InliningModes IMode,
+                        SetOfConstDecls *VisitedCallees);
+
   void RunPathSensitiveChecks(Decl *D,
                               ExprEngine::InliningModes IMode,
                               SetOfConstDecls *VisitedCallees);
@@ -381,6 +640,36 @@ public:
 private:
   void storeTopLevelDecls(DeclGroupRef DG);
 
+  /// \brief Check if the top level functions may be explored by worker
+  /// processes without changing the analysis output.
+  bool canAnalyzeInParallel() const;
+
+  /// \brief The directory of the cached analysis results, or empty if the
+  /// results are not cached.
+  std::string CacheDir;
+
+  /// \brief The digest of the options and of the declarations other than the
+  /// function definitions, which is part of every cache key.
+  std::string ContextDigest;
+
+  /// \brief The digests of the definitions of the functions in the call
+  /// graph, and the definitions by digest.
+  llvm::DenseMap<const Decl *, std::string> FunctionDigests;
+  llvm::StringMap<const Decl *> DefinitionsByDigest;
+
+  /// \brief Check if the results of the top level functions may be cached
+  /// without changing the analysis output.
+  bool canCacheResults() const;
+
+  /// \brief Compute the digests the cache keys of the functions in \p CG are
+  /// made of, if the results are to be cached.
+  void setUpResultCache(CallGraph &CG);
+
+  /// \brief Return the cache key of the results of the top level function
+  /// \p FD.
+  std::string getResultCacheKey(CallGraph &CG, const FunctionDecl *FD,
+                                ExprEngine::InliningModes IMode);
+
   /// \brief Check if we should skip (not analyze) the given function.
   AnalysisMode getModeForDecl(Decl *D, AnalysisMode Mode);
 
@@ -461,17 +750,37 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     CG.addToCallGraph(LocalTUDecls[i]);
   }
 
+  // The summaries of the callees are computed in-process, so summary mode
+  // does not fork workers.
+  bool BottomUp = Mgr->options.shouldUsePathCondSummaries();
+  setUpResultCache(CG);
+
+  unsigned NumJobs = Mgr->options.getNumAnalysisJobs();
+  if (NumJobs > 1 && !BottomUp && canAnalyzeInParallel() &&
+      HandleDeclsCallGraphInParallel(CG, NumJobs))
+    return;
+
   // Walk over all of the call graph nodes in topological order, so that we
   // analyze parents before the children. Skip the functions inlined into
   // the previously processed functions. Use external Visited set to identify
   // inlined functions. The topological order allows the "do not reanalyze
   // previously inlined function" performance heuristic to be triggered more
   // often.
+  //
+  // In summary mode walk in the reverse order instead, so that the summaries
+  // of the children are available when the parents are analyzed. Only the
+  // callees in a cycle with their caller are still inlined.
+  SmallVector<CallGraphNode *, 128> Order;
+  llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
+  Order.append(RPOT.begin(), RPOT.end());
+  if (BottomUp)
+    std::reverse(Order.begin(), Order.end());
+
   SetOfConstDecls Visited;
   SetOfConstDecls VisitedAsTopLevel;
-  llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
-  for (llvm::ReversePostOrderTraversal<clang::CallGraph*>::rpo_iterator
-         I = RPOT.begin(), E = RPOT.end(); I != E; ++I) {
+  for (SmallVectorImpl<CallGraphNode *>::iterator I = Order.begin(),
+                                                  E = Order.end();
+       I != E; ++I) {
     NumFunctionTopLevel++;
 
     CallGraphNode *N = *I;
@@ -489,8 +798,9 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     // Analyze the function.
     SetOfConstDecls VisitedCallees;
 
-    HandleCode(D, AM_Path, getInliningModeForFunction(D, Visited),
-               (Mgr->options.InliningMode == All ? nullptr : &VisitedCallees));
+    HandleCodeCached(CG, D, getInliningModeForFunction(D, Visited),
+                     (Mgr->options.InliningMode == All ? nullptr
+                                                       : &VisitedCallees));
 
     // Add the visited callees to the global visited set.
     for (SetOfConstDecls::iterator I = VisitedCallees.begin(),
@@ -501,6 +811,496 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+// Parallel exploration of the top level functions.
+//===----------------------------------------------------------------------===//
+//
+// The ASTContext, the IdentifierTable and the DiagnosticsEngine are not
+// thread-safe, and the engine lazily creates types, CFGs and ParentMaps while
+// exploring a function. Instead of threads we therefore fork worker processes
+// once the translation unit has been parsed: every worker owns a private copy
+// of the AnalysisManager, the checkers and the ExprEngine state, and shares the
+// AST of its parent, which no worker writes back.
+//
+// Workers claim the top level functions in the order of the serial walk
+// through a shared counter, write everything the analysis prints to stderr to
+// a per-function log, and record the callees that were inlined. The parent
+// then replays the serial walk: it applies the "do not reanalyze previously
+// inlined function" heuristic on the recorded callee sets and splices the logs
+// of the functions the serial walk analyzes, in order.
+
+bool AnalysisConsumer::canAnalyzeInParallel() const {
+#ifdef LLVM_ON_UNIX
+  // The plist consumers write a single file per translation unit, which the
+  // workers cannot share.
+  switch (Opts->AnalysisDiagOpt) {
+  case PD_NONE:
+  case PD_TEXT:
+  case PD_HTML:
+    break;
+  default:
+    if (!OutDir.empty())
+      return false;
+  }
+
+  // Statistics and graph visualization are collected in-process.
+  if (Opts->PrintStats || Opts->visualizeExplodedGraphWithGraphViz ||
+      Opts->visualizeExplodedGraphWithUbiGraph)
+    return false;
+
+  // ObjC methods are reanalyzed with an inlining mode which depends on the
+  // functions analyzed before them.
+  return !PP.getLangOpts().ObjC1;
+#else
+  return false;
+#endif
+}
+
+static void getWorkerResultPath(SmallVectorImpl<char> &Path, StringRef Dir,
+                                unsigned Idx, StringRef Ext) {
+  Path.clear();
+  Path.append(Dir.begin(), Dir.end());
+  llvm::sys::path::append(Path, Twine(Idx) + Ext);
+}
+
+void AnalysisConsumer::RunAnalysisWorker(
+    CallGraph &CG, ArrayRef<Decl *> Order,
+    const llvm::DenseMap<const Decl *, unsigned> &Index,
+    std::atomic<unsigned> *Slots, StringRef ResultDir) {
+#ifdef LLVM_ON_UNIX
+  SmallString<128> Path, TmpPath;
+  for (;;) {
+    unsigned Idx = Slots[0]++;
+    if (Idx >= Order.size())
+      return;
+
+    // A function inlined into an earlier one is usually skipped by the serial
+    // walk. Leave it to the parent, which analyzes it if it is not.
+    if (Slots[Idx + 1])
+      continue;
+
+    getWorkerResultPath(Path, ResultDir, Idx, ".log");
+    int FD;
+    if (llvm::sys::fs::openFileForWrite(Path.str(), FD, llvm::sys::fs::F_None))
+      return;
+    llvm::errs().flush();
+    ::dup2(FD, STDERR_FILENO);
+    ::close(FD);
+
+    // Start every function from scratch, so that its result does not depend
+    // on which functions this worker happened to analyze before.
+    FunctionSummaries = FunctionSummariesTy();
+
+    SetOfConstDecls VisitedCallees;
+    HandleCodeCached(CG, Order[Idx], ExprEngine::Inline_Regular,
+                     (Mgr->options.InliningMode == All ? nullptr
+                                                       : &VisitedCallees));
+    llvm::errs().flush();
+
+    // The diagnostics are emitted by the parent, in the order of a serial
+    // run.
+    getWorkerResultPath(Path, ResultDir, Idx, ".diags");
+    {
+      std::error_code EC;
+      llvm::raw_fd_ostream Out(Path.str(), EC, llvm::sys::fs::F_None);
+      if (EC)
+        return;
+      if (ClangDiags)
+        ClangDiags->WriteCollectedDiagnostics(Out);
+    }
+
+    // The callee list doubles as the completion marker of the function, so
+    // only make it visible once it has been fully written.
+    getWorkerResultPath(TmpPath, ResultDir, Idx, ".tmp");
+    {
+      std::error_code EC;
+      llvm::raw_fd_ostream Out(TmpPath.str(), EC, llvm::sys::fs::F_Text);
+      if (EC)
+        return;
+      for (SetOfConstDecls::iterator I = VisitedCallees.begin(),
+                                     E = VisitedCallees.end(); I != E; ++I) {
+        Out << reinterpret_cast<uintptr_t>(*I) << '\n';
+        llvm::DenseMap<const Decl *, unsigned>::const_iterator CI =
+            Index.find(*I);
+        if (CI != Index.end() && CI->second > Idx)
+          Slots[CI->second + 1] = 1;
+      }
+    }
+    getWorkerResultPath(Path, ResultDir, Idx, ".callees");
+    if (llvm::sys::fs::rename(TmpPath.str(), Path.str()))
+      return;
+  }
+#endif
+}
+
+bool AnalysisConsumer::HandleDeclsCallGraphInParallel(CallGraph &CG,
+                                                      unsigned NumJobs) {
+#ifdef LLVM_ON_UNIX
+  SmallString<128> Prefix, ResultDir;
+  llvm::sys::path::system_temp_directory(/*erasedOnReboot=*/true, Prefix);
+  llvm::sys::path::append(Prefix, "clang-analyzer");
+  if (llvm::sys::fs::createUniqueDirectory(Prefix.str(), ResultDir))
+    return false;
+
+  // Collect the top level functions in the order of the serial walk.
+  SmallVector<Decl *, 128> Order;
+  llvm::DenseMap<const Decl *, unsigned> Index;
+  llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
+  for (llvm::ReversePostOrderTraversal<clang::CallGraph*>::rpo_iterator
+         I = RPOT.begin(), E = RPOT.end(); I != E; ++I) {
+    NumFunctionTopLevel++;
+    if (Decl *D = (*I)->getDecl()) {
+      Index[D] = Order.size();
+      Order.push_back(D);
+    }
+  }
+
+  // Slot 0 holds the index of the next function to be claimed by a worker.
+  // Slot I+1 is set once the I-th function has been inlined into an earlier
+  // one.
+  size_t SharedSize = (Order.size() + 1) * sizeof(std::atomic<unsigned>);
+  void *Shared = ::mmap(nullptr, SharedSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (Shared == MAP_FAILED) {
+    llvm::sys::fs::remove(ResultDir.str());
+    return false;
+  }
+  std::atomic<unsigned> *Slots = static_cast<std::atomic<unsigned> *>(Shared);
+  for (unsigned I = 0, E = Order.size() + 1; I != E; ++I)
+    new (&Slots[I]) std::atomic<unsigned>(0);
+
+  // Do not let the workers inherit buffered output.
+  llvm::outs().flush();
+  llvm::errs().flush();
+
+  SmallVector<pid_t, 16> Workers;
+  for (unsigned J = 0; J != NumJobs; ++J) {
+    pid_t Pid = ::fork();
+    if (Pid == 0) {
+      RunAnalysisWorker(CG, Order, Index, Slots, ResultDir);
+      Mgr->FlushDiagnostics();
+      llvm::errs().flush();
+      ::_exit(0);
+    }
+    if (Pid > 0)
+      Workers.push_back(Pid);
+  }
+  for (unsigned J = 0, E = Workers.size(); J != E; ++J) {
+    int Status;
+    while (::waitpid(Workers[J], &Status, 0) == -1 && errno == EINTR)
+      ;
+  }
+  ::munmap(Shared, SharedSize);
+
+  // Replay the serial walk. Functions whose result is missing (skipped as
+  // inlined, or lost with a crashed worker) are analyzed in-process.
+  SetOfConstDecls Visited;
+  SetOfConstDecls VisitedAsTopLevel;
+  SmallString<128> Path;
+  for (unsigned Idx = 0, E = Order.size(); Idx != E; ++Idx) {
+    Decl *D = Order[Idx];
+    if (!shouldSkipFunction(D, Visited, VisitedAsTopLevel)) {
+      SetOfConstDecls VisitedCallees;
+      getWorkerResultPath(Path, ResultDir, Idx, ".callees");
+      llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Callees =
+          llvm::MemoryBuffer::getFile(Path.str());
+      getWorkerResultPath(Path, ResultDir, Idx, ".diags");
+      llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> WorkerDiags =
+          llvm::MemoryBuffer::getFile(Path.str());
+      if (Callees && WorkerDiags &&
+          (!ClangDiags ||
+           ClangDiags->ReadDiagnostics((*WorkerDiags)->getBuffer()))) {
+        SmallVector<StringRef, 16> Lines;
+        (*Callees)->getBuffer().split(Lines, "\n", -1, false);
+        for (unsigned L = 0, LE = Lines.size(); L != LE; ++L) {
+          uintptr_t Callee;
+          if (!Lines[L].getAsInteger(10, Callee))
+            VisitedCallees.insert(reinterpret_cast<const Decl *>(Callee));
+        }
+
+        getWorkerResultPath(Path, ResultDir, Idx, ".log");
+        if (llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Log =
+                llvm::MemoryBuffer::getFile(Path.str()))
+          llvm::errs() << (*Log)->getBuffer();
+      } else {
+        HandleCodeCached(CG, D, getInliningModeForFunction(D, Visited),
+                         (Mgr->options.InliningMode == All ? nullptr
+                                                           : &VisitedCallees));
+      }
+
+      for (SetOfConstDecls::iterator I = VisitedCallees.begin(),
+                                     E = VisitedCallees.end(); I != E; ++I)
+        Visited.insert(*I);
+      VisitedAsTopLevel.insert(D);
+    }
+
+    getWorkerResultPath(Path, ResultDir, Idx, ".log");
+    llvm::sys::fs::remove(Path.str());
+    getWorkerResultPath(Path, ResultDir, Idx, ".diags");
+    llvm::sys::fs::remove(Path.str());
+    getWorkerResultPath(Path, ResultDir, Idx, ".tmp");
+    llvm::sys::fs::remove(Path.str());
+    getWorkerResultPath(Path, ResultDir, Idx, ".callees");
+    llvm::sys::fs::remove(Path.str());
+  }
+  llvm::sys::fs::remove(ResultDir.str());
+  return true;
+#else
+  return false;
+#endif
+}
+
+//===----------------------------------------------------------------------===//
+// Cache of the analysis results.
+//===----------------------------------------------------------------------===//
+//
+// With '-analyzer-config analysis-cache-dir=<dir>', everything the analysis of
+// a top level function prints to stderr is stored in <dir>/<key>.log, and the
+// digests of the functions inlined into it in <dir>/<key>.callees. The key
+// digests the function, all the functions it may inline (those reachable from
+// it in the call graph), the analyzer options and the other declarations of
+// the translation unit, so a later run replays the log instead of analyzing
+// the function again unless one of them changed.
+//
+// A cached function is analyzed from scratch, as in a worker of the parallel
+// mode, so that its results do not depend on the functions analyzed before it.
+// The digests do not cover the analyzer itself: clear the directory after
+// updating it.
+
+/// The version of the layout of the cache directory and of the keys.
+static const unsigned ResultCacheVersion = 1;
+
+bool AnalysisConsumer::canCacheResults() const {
+#ifdef LLVM_ON_UNIX
+  // The plist and HTML consumers write files the log does not capture.
+  if (Opts->AnalysisDiagOpt != PD_NONE && Opts->AnalysisDiagOpt != PD_TEXT)
+    return false;
+
+  // Statistics and graph visualization are not part of the log.
+  if (Opts->PrintStats || Opts->visualizeExplodedGraphWithGraphViz ||
+      Opts->visualizeExplodedGraphWithUbiGraph)
+    return false;
+
+  // The summaries of the callees and the path condition stream outlive the
+  // analysis of a single function.
+  if (Opts->shouldUsePathCondSummaries() ||
+      !Opts->Config.lookup("pathcond-stream").empty())
+    return false;
+
+  // The call graph does not record the ObjC messages, constructors,
+  // destructors and virtual calls the engine may inline.
+  const LangOptions &LangOpts = PP.getLangOpts();
+  return !LangOpts.ObjC1 && !LangOpts.CPlusPlus;
+#else
+  return false;
+#endif
+}
+
+void AnalysisConsumer::setUpResultCache(CallGraph &CG) {
+  // Do not insert the option, so that it is not dumped with the others.
+  CacheDir = Opts->Config.lookup("analysis-cache-dir");
+  if (CacheDir.empty())
+    return;
+  if (!canCacheResults() ||
+      llvm::sys::fs::create_directories(CacheDir)) {
+    CacheDir.clear();
+    return;
+  }
+
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  OS << ResultCacheVersion << '\n' << getClangFullVersion() << '\n';
+
+  // The options which do not change the output are left out.
+  std::vector<std::pair<StringRef, StringRef> > Config;
+  for (AnalyzerOptions::ConfigTable::const_iterator I = Opts->Config.begin(),
+                                                    E = Opts->Config.end();
+       I != E; ++I)
+    if (I->getKey() != "analysis-cache-dir" && I->getKey() != "jobs")
+      Config.push_back(std::make_pair(I->getKey(), StringRef(I->getValue())));
+  std::sort(Config.begin(), Config.end());
+  for (unsigned I = 0, E = Config.size(); I != E; ++I)
+    OS << Config[I].first << '=' << Config[I].second << '\n';
+  for (unsigned I = 0, E = Opts->CheckersControlList.size(); I != E; ++I)
+    OS << (Opts->CheckersControlList[I].second ? '+' : '-')
+       << Opts->CheckersControlList[I].first << '\n';
+  for (unsigned I = 0, E = Plugins.size(); I != E; ++I)
+    OS << Plugins[I] << '\n';
+  OS << Opts->AnalysisStoreOpt << ' ' << Opts->AnalysisConstraintsOpt << ' '
+     << Opts->AnalysisDiagOpt << ' ' << Opts->AnalysisPurgeOpt << ' '
+     << Opts->maxBlockVisitOnPath << ' ' << Opts->InlineMaxStackDepth << ' '
+     << Opts->InliningMode << ' ' << Opts->AnalyzeAll
+     << Opts->AnalyzerDisplayProgress << Opts->AnalyzeNestedBlocks
+     << Opts->eagerlyAssumeBinOpBifurcation << Opts->UnoptimizedCFG
+     << Opts->NoRetryExhausted << '\n';
+
+  // The record layouts, the initializers of the globals and the attributes of
+  // the functions declared but not defined affect the analysis of every
+  // function.
+  PrintingPolicy Policy(Ctx->getLangOpts());
+  for (unsigned I = 0, E = LocalTUDecls.size(); I != E; ++I) {
+    const FunctionDecl *FD = dyn_cast<FunctionDecl>(LocalTUDecls[I]);
+    if (!FD || !FD->doesThisDeclarationHaveABody()) {
+      LocalTUDecls[I]->print(OS, Policy);
+      OS << '\n';
+    }
+  }
+
+  llvm::MD5 Hash;
+  Hash.update(OS.str());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+  ContextDigest = Digest.str();
+
+  for (CallGraph::iterator I = CG.begin(), E = CG.end(); I != E; ++I) {
+    const FunctionDecl *FD = dyn_cast_or_null<FunctionDecl>(I->first);
+    const FunctionDecl *Def;
+    if (!FD || !FD->hasBody(Def))
+      continue;
+    std::string FunctionDigest = getFunctionDigest(Def);
+    FunctionDigests[Def] = FunctionDigest;
+    DefinitionsByDigest[FunctionDigest] = Def;
+  }
+}
+
+std::string AnalysisConsumer::getResultCacheKey(
+    CallGraph &CG, const FunctionDecl *FD, ExprEngine::InliningModes IMode) {
+  const FunctionDecl *Def = FD;
+  FD->hasBody(Def);
+
+  // The callees are sorted, so that the key does not depend on the order of
+  // the declarations.
+  std::vector<std::string> Callees;
+  if (CallGraphNode *N = CG.getNode(FD)) {
+    for (llvm::df_iterator<CallGraphNode *> I = llvm::df_begin(N),
+                                            E = llvm::df_end(N);
+         I != E; ++I) {
+      const FunctionDecl *Callee = dyn_cast_or_null<FunctionDecl>(I->getDecl());
+      const FunctionDecl *CalleeDef;
+      if (*I != N && Callee && Callee->hasBody(CalleeDef))
+        Callees.push_back(FunctionDigests.lookup(CalleeDef));
+    }
+  }
+  std::sort(Callees.begin(), Callees.end());
+
+  llvm::MD5 Hash;
+  Hash.update(ContextDigest);
+  Hash.update(FunctionDigests.lookup(Def));
+  Hash.update(IMode == ExprEngine::Inline_Regular ? "R" : "M");
+  for (unsigned I = 0, E = Callees.size(); I != E; ++I)
+    Hash.update(Callees[I]);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  llvm::MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+void AnalysisConsumer::HandleCodeCached(CallGraph &CG, Decl *D,
+                                        ExprEngine::InliningModes IMode,
+                                        SetOfConstDecls *VisitedCallees) {
+#ifdef LLVM_ON_UNIX
+  const FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+  if (CacheDir.empty() || !FD || !FD->hasBody() ||
+      !(getModeForDecl(D, AM_Path) & AM_Path)) {
+    HandleCode(D, AM_Path, IMode, VisitedCallees);
+    return;
+  }
+
+  std::string Key = getResultCacheKey(CG, FD, IMode);
+  SmallString<128> LogPath(CacheDir), CalleesPath(CacheDir);
+  llvm::sys::path::append(LogPath, Key + ".log");
+  llvm::sys::path::append(CalleesPath, Key + ".callees");
+
+  // The callee list is written last, so the log is complete if it exists.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Callees =
+      llvm::MemoryBuffer::getFile(CalleesPath.str());
+  if (Callees) {
+    if (llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Log =
+            llvm::MemoryBuffer::getFile(LogPath.str())) {
+      llvm::errs() << (*Log)->getBuffer();
+      if (VisitedCallees) {
+        SmallVector<StringRef, 16> Lines;
+        (*Callees)->getBuffer().split(Lines, "\n", -1, false);
+        for (unsigned L = 0, LE = Lines.size(); L != LE; ++L)
+          if (const Decl *Callee = DefinitionsByDigest.lookup(Lines[L]))
+            VisitedCallees->insert(Callee);
+      }
+      return;
+    }
+  }
+
+  // Capture everything the analysis prints in a private file, which becomes
+  // the cached log once it is complete.
+  SmallString<128> TmpLogPath, TmpCalleesPath;
+  int LogFD;
+  if (llvm::sys::fs::createUniqueFile(LogPath.str() + "-%%%%%%.tmp", LogFD,
+                                      TmpLogPath)) {
+    HandleCode(D, AM_Path, IMode, VisitedCallees);
+    return;
+  }
+  llvm::errs().flush();
+  int SavedStderr = ::dup(STDERR_FILENO);
+  if (SavedStderr == -1) {
+    ::close(LogFD);
+    llvm::sys::fs::remove(TmpLogPath.str());
+    HandleCode(D, AM_Path, IMode, VisitedCallees);
+    return;
+  }
+  ::dup2(LogFD, STDERR_FILENO);
+  ::close(LogFD);
+
+  FunctionSummaries = FunctionSummariesTy();
+  SetOfConstDecls Analyzed;
+  HandleCode(D, AM_Path, IMode, VisitedCallees ? &Analyzed : nullptr);
+  Mgr->FlushDiagnostics();
+  llvm::errs().flush();
+  ::dup2(SavedStderr, STDERR_FILENO);
+  ::close(SavedStderr);
+
+  if (llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Log =
+          llvm::MemoryBuffer::getFile(TmpLogPath.str()))
+    llvm::errs() << (*Log)->getBuffer();
+  if (VisitedCallees)
+    VisitedCallees->insert(Analyzed.begin(), Analyzed.end());
+
+  std::error_code EC;
+  {
+    int CalleesFD;
+    EC = llvm::sys::fs::createUniqueFile(CalleesPath.str() + "-%%%%%%.tmp",
+                                         CalleesFD, TmpCalleesPath);
+    if (!EC) {
+      llvm::raw_fd_ostream Out(CalleesFD, /*shouldClose=*/true);
+      for (SetOfConstDecls::iterator I = Analyzed.begin(), E = Analyzed.end();
+           I != E; ++I) {
+        llvm::DenseMap<const Decl *, std::string>::iterator DI =
+            FunctionDigests.find(*I);
+        if (DI != FunctionDigests.end())
+          Out << DI->second << '\n';
+      }
+      Out.close();
+      if (Out.has_error()) {
+        Out.clear_error();
+        EC = std::make_error_code(std::errc::io_error);
+      }
+    }
+  }
+
+  // Several analyzer processes may cache the same function; the renames
+  // replace a complete entry with an identical one.
+  if (EC || llvm::sys::fs::rename(TmpLogPath.str(), LogPath.str()) ||
+      llvm::sys::fs::rename(TmpCalleesPath.str(), CalleesPath.str())) {
+    llvm::sys::fs::remove(TmpLogPath.str());
+    if (!TmpCalleesPath.empty())
+      llvm::sys::fs::remove(TmpCalleesPath.str());
+  }
+#else
+  HandleCode(D, AM_Path, IMode, VisitedCallees);
+#endif
+}
+
 void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
   // Don't run the actions if an error has occurred with parsing the file.
   DiagnosticsEngine &Diags = PP.getDiagnostics();
@@ -512,6 +1312,10 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
   if (Opts->DisableAllChecks)
     return;
 
+  llvm::TimeRecord CheckerTimersStart;
+  if (Opts->CheckerTimers)
+    CheckerTimersStart = llvm::TimeRecord::getCurrentTime(true);
+
   {
     if (TUTotalTimer) TUTotalTimer->startTimer();
 
@@ -556,6 +1360,12 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
 
   if (TUTotalTimer) TUTotalTimer->stopTimer();
 
+  if (Opts->CheckerTimers) {
+    llvm::TimeRecord Total = llvm::TimeRecord::getCurrentTime(false);
+    Total -= CheckerTimersStart;
+    checkerMgr->printCheckerTimers(Total);
+  }
+
   // Count how many basic blocks we have not covered.
   NumBlocksInAnalyzedFunctions = FunctionSummaries.getTotalNumBasicBlocks();
   if (NumBlocksInAnalyzedFunctions > 0)
@@ -608,6 +1418,12 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
   if (Mode == AM_None)
     return;
 
+  llvm::TimeTraceScope TimeScope("HandleCode", [&]() -> std::string {
+    if (const NamedDecl *ND = dyn_cast<NamedDecl>(D))
+      return ND->getQualifiedNameAsString();
+    return std::string("<block>");
+  });
+
   DisplayFunction(D, Mode, IMode);
   CFG *DeclCFG = Mgr->getCFG(D);
   if (DeclCFG) {
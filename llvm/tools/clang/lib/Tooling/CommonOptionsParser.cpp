@@ -52,6 +52,9 @@ const char *const CommonOptionsParser::HelpMessage =
     "\tworking directory. \"./\" prefixes in the relative files will be\n"
     "\tautomatically removed, but the rest of a relative path must be a\n"
     "\tsuffix of a path in the compile command database.\n"
+    "\n"
+    "-j <N> processes N source files in parallel, or one per hardware\n"
+    "\tthread if N is 0. The tool must support it.\n"
     "\n";
 
 class ArgumentsAdjustingCompilations : public CompilationDatabase {
@@ -112,6 +115,11 @@ CommonOptionsParser::CommonOptionsParser(int &argc, const char **argv,
       cl::desc("Additional argument to prepend to the compiler command line"),
       cl::cat(Category));
 
+  static cl::opt<unsigned> Jobs(
+      "j", cl::desc("Number of source files to process in parallel "
+                    "(0 = one per hardware thread)"),
+      cl::init(1), cl::cat(Category));
+
   // Hide unrelated options.
   StringMap<cl::Option*> Options;
   cl::getRegisteredOptions(Options);
@@ -126,6 +134,7 @@ CommonOptionsParser::CommonOptionsParser(int &argc, const char **argv,
                                                                    argv));
   cl::ParseCommandLineOptions(argc, argv, Overview);
   SourcePathList = SourcePaths;
+  NumThreads = Jobs;
   if (!Compilations) {
     std::string ErrorMessage;
     if (!BuildPath.empty()) {
@@ -14,6 +14,7 @@
 
 #include "clang/Tooling/Tooling.h"
 #include "clang/AST/ASTConsumer.h"
+#include "clang/Basic/VirtualFileSystem.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/Tool.h"
@@ -29,8 +30,15 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#if LLVM_ENABLE_THREADS
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
 // For chdir, see the comment in ClangTool::run for more information.
 #ifdef LLVM_ON_WIN32
 #  include <direct.h>
@@ -278,7 +286,8 @@ bool FrontendActionFactory::runInvocation(CompilerInvocation *Invocation,
 ClangTool::ClangTool(const CompilationDatabase &Compilations,
                      ArrayRef<std::string> SourcePaths)
     : Compilations(Compilations), SourcePaths(SourcePaths),
-      Files(new FileManager(FileSystemOptions())), DiagConsumer(nullptr) {
+      Files(new FileManager(FileSystemOptions())), DiagConsumer(nullptr),
+      NumThreads(1) {
   appendArgumentsAdjuster(getClangStripOutputAdjuster());
   appendArgumentsAdjuster(getClangSyntaxOnlyAdjuster());
 }
@@ -316,6 +325,14 @@ int ClangTool::run(ToolAction *Action) {
   if (std::error_code EC = llvm::sys::fs::current_path(InitialDirectory))
     llvm::report_fatal_error("Cannot detect current path: " +
                              Twine(EC.message()));
+
+  unsigned Threads = 1;
+#if LLVM_ENABLE_THREADS
+  Threads = NumThreads ? NumThreads : std::thread::hardware_concurrency();
+#endif
+  if (Threads > 1)
+    return runInParallel(Action, MainExecutable, Threads);
+
   bool ProcessingFailed = false;
   for (const auto &SourcePath : SourcePaths) {
     std::string File(getAbsolutePath(SourcePath));
@@ -376,6 +393,268 @@ int ClangTool::run(ToolAction *Action) {
   return ProcessingFailed ? 1 : 0;
 }
 
+#if LLVM_ENABLE_THREADS
+namespace {
+
+/// \brief A file system shared by the threads of a parallel ClangTool::run,
+/// which remembers the status and the contents of the files read through it.
+///
+/// The translation units of a project mostly include the same headers, and
+/// mostly look for them in the same wrong directories first, so this saves
+/// most of the stats and reads. Files are assumed not to change during the
+/// run.
+class SharedFileCache : public vfs::FileSystem {
+  IntrusiveRefCntPtr<vfs::FileSystem> FS;
+  std::mutex Mutex;
+  /// The status of every path looked up, or the error it gave.
+  llvm::StringMap<std::pair<std::error_code, vfs::Status>> Statuses;
+  /// The contents of the regular files read, by path.
+  llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> Contents;
+
+  class CachedFile;
+
+public:
+  explicit SharedFileCache(IntrusiveRefCntPtr<vfs::FileSystem> FS)
+      : FS(FS) {}
+
+  llvm::ErrorOr<vfs::Status> status(const Twine &Path) override {
+    SmallString<256> PathStorage;
+    StringRef P = Path.toStringRef(PathStorage);
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      auto I = Statuses.find(P);
+      if (I != Statuses.end()) {
+        if (I->second.first)
+          return I->second.first;
+        return I->second.second;
+      }
+    }
+
+    llvm::ErrorOr<vfs::Status> S = FS->status(P);
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Statuses[P] = S ? std::make_pair(std::error_code(), *S)
+                    : std::make_pair(S.getError(), vfs::Status());
+    return S;
+  }
+
+  llvm::ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const Twine &Path) override;
+
+  vfs::directory_iterator dir_begin(const Twine &Dir,
+                                    std::error_code &EC) override {
+    return FS->dir_begin(Dir, EC);
+  }
+
+  /// Returns the contents of the regular file \p S, reading it the first
+  /// time.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getContents(const vfs::Status &S, const Twine &Name,
+              bool RequiresNullTerminator) {
+    const llvm::MemoryBuffer *Buffer = nullptr;
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      auto I = Contents.find(S.getName());
+      if (I != Contents.end())
+        Buffer = I->second.get();
+    }
+    if (!Buffer) {
+      // Read the file without holding the lock; if another thread read it
+      // meanwhile, keep the first copy.
+      llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Read =
+          FS->getBufferForFile(S.getName());
+      if (!Read)
+        return Read.getError();
+      std::lock_guard<std::mutex> Lock(Mutex);
+      std::unique_ptr<llvm::MemoryBuffer> &Entry = Contents[S.getName()];
+      if (!Entry)
+        Entry = std::move(*Read);
+      Buffer = Entry.get();
+    }
+    SmallString<256> NameStorage;
+    return llvm::MemoryBuffer::getMemBuffer(Buffer->getBuffer(),
+                                            Name.toStringRef(NameStorage),
+                                            RequiresNullTerminator);
+  }
+};
+
+/// \brief A regular file of a SharedFileCache. Its contents are only read
+/// when they are not in the cache yet.
+class SharedFileCache::CachedFile : public vfs::File {
+  SharedFileCache &Cache;
+  vfs::Status S;
+
+public:
+  CachedFile(SharedFileCache &Cache, const vfs::Status &S)
+      : Cache(Cache), S(S) {}
+
+  llvm::ErrorOr<vfs::Status> status() override { return S; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    if (IsVolatile)
+      return Cache.FS->getBufferForFile(S.getName(), FileSize,
+                                        RequiresNullTerminator, IsVolatile);
+    return Cache.getContents(S, Name, RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return std::error_code(); }
+
+  void setName(StringRef Name) override { S.setName(Name); }
+};
+
+llvm::ErrorOr<std::unique_ptr<vfs::File>>
+SharedFileCache::openFileForRead(const Twine &Path) {
+  llvm::ErrorOr<vfs::Status> S = status(Path);
+  if (!S)
+    return S.getError();
+  if (!S->isRegularFile())
+    return FS->openFileForRead(Path);
+  return std::unique_ptr<vfs::File>(new CachedFile(*this, *S));
+}
+
+/// \brief Forwards the diagnostics of the threads of a parallel
+/// ClangTool::run to the diagnostic consumer of the tool, one at a time.
+class LockedDiagnosticConsumer : public DiagnosticConsumer {
+  DiagnosticConsumer &Consumer;
+  std::mutex &Mutex;
+
+public:
+  LockedDiagnosticConsumer(DiagnosticConsumer &Consumer, std::mutex &Mutex)
+      : Consumer(Consumer), Mutex(Mutex) {}
+
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Consumer.BeginSourceFile(LangOpts, PP);
+  }
+
+  void EndSourceFile() override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Consumer.EndSourceFile();
+  }
+
+  bool IncludeInDiagnosticCounts() const override {
+    return Consumer.IncludeInDiagnosticCounts();
+  }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(DiagLevel, Info);
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Consumer.HandleDiagnostic(DiagLevel, Info);
+  }
+};
+
+/// \brief A compile command of a parallel ClangTool::run, and what it
+/// printed.
+struct ToolJob {
+  std::string File;
+  std::string Directory;
+  /// Empty if the file has no compile command.
+  std::vector<std::string> CommandLine;
+  std::string Output;
+};
+
+}
+#endif
+
+int ClangTool::runInParallel(ToolAction *Action,
+                             const std::string &MainExecutable,
+                             unsigned Threads) {
+#if LLVM_ENABLE_THREADS
+  // The jobs cannot chdir into the directories of their commands, which is
+  // process-wide; they are given the directory with -working-directory
+  // instead, and their input files are looked up in it by the file manager.
+  std::vector<ToolJob> Jobs;
+  for (const auto &SourcePath : SourcePaths) {
+    std::string File(getAbsolutePath(SourcePath));
+    std::vector<CompileCommand> CompileCommandsForFile =
+        Compilations.getCompileCommands(File);
+    if (CompileCommandsForFile.empty()) {
+      Jobs.push_back(ToolJob());
+      Jobs.back().Output =
+          "Skipping " + File + ". Compile command not found.\n";
+      continue;
+    }
+    for (CompileCommand &CompileCommand : CompileCommandsForFile) {
+      std::vector<std::string> CommandLine = CompileCommand.CommandLine;
+      if (ArgsAdjuster)
+        CommandLine = ArgsAdjuster(CommandLine);
+      assert(!CommandLine.empty());
+      CommandLine[0] = MainExecutable;
+      CommandLine.insert(CommandLine.begin() + 1, "-working-directory");
+      CommandLine.insert(CommandLine.begin() + 2, CompileCommand.Directory);
+      Jobs.push_back(ToolJob());
+      Jobs.back().File = File;
+      Jobs.back().Directory = CompileCommand.Directory;
+      Jobs.back().CommandLine = std::move(CommandLine);
+    }
+  }
+
+  IntrusiveRefCntPtr<vfs::FileSystem> SharedFS(
+      new SharedFileCache(vfs::getRealFileSystem()));
+  std::atomic<unsigned> NextJob(0);
+  std::atomic<bool> ProcessingFailed(false);
+  std::mutex DiagMutex, OutputMutex;
+  std::vector<bool> Finished(Jobs.size());
+  unsigned NextOutput = 0;
+
+  auto RunJobs = [&] {
+    for (unsigned I = NextJob++; I < Jobs.size(); I = NextJob++) {
+      ToolJob &Job = Jobs[I];
+      if (!Job.CommandLine.empty()) {
+        llvm::raw_string_ostream OS(Job.Output);
+        FileSystemOptions FileSystemOpts;
+        FileSystemOpts.WorkingDir = Job.Directory;
+        IntrusiveRefCntPtr<FileManager> JobFiles(
+            new FileManager(FileSystemOpts, SharedFS));
+        IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts =
+            new DiagnosticOptions();
+        TextDiagnosticPrinter DiagnosticPrinter(OS, &*DiagOpts);
+        std::unique_ptr<LockedDiagnosticConsumer> LockedConsumer;
+        if (DiagConsumer)
+          LockedConsumer.reset(
+              new LockedDiagnosticConsumer(*DiagConsumer, DiagMutex));
+
+        DEBUG({ llvm::dbgs() << "Processing: " << Job.File << ".\n"; });
+        ToolInvocation Invocation(std::move(Job.CommandLine), Action,
+                                  JobFiles.get());
+        if (LockedConsumer)
+          Invocation.setDiagnosticConsumer(LockedConsumer.get());
+        else
+          Invocation.setDiagnosticConsumer(&DiagnosticPrinter);
+        for (const auto &MappedFile : MappedFileContents)
+          Invocation.mapVirtualFile(MappedFile.first, MappedFile.second);
+        if (!Invocation.run()) {
+          OS << "Error while processing " << Job.File << ".\n";
+          ProcessingFailed = true;
+        }
+        OS.flush();
+      }
+
+      // Print what the jobs printed in their order, as the serial run would.
+      std::lock_guard<std::mutex> Lock(OutputMutex);
+      Finished[I] = true;
+      for (; NextOutput < Jobs.size() && Finished[NextOutput]; ++NextOutput) {
+        llvm::errs() << Jobs[NextOutput].Output;
+        std::string().swap(Jobs[NextOutput].Output);
+      }
+    }
+  };
+
+  std::vector<std::thread> Workers;
+  Threads = std::min<unsigned>(Threads, Jobs.size());
+  for (unsigned I = 0; I != Threads; ++I)
+    Workers.push_back(std::thread(RunJobs));
+  for (unsigned I = 0; I != Threads; ++I)
+    Workers[I].join();
+  return ProcessingFailed ? 1 : 0;
+#else
+  llvm_unreachable("ClangTool::runInParallel without threads");
+#endif
+}
+
 namespace {
 
 class ASTBuilderAction : public ToolAction {
@@ -402,8 +681,14 @@ public:
 }
 
 int ClangTool::buildASTs(std::vector<std::unique_ptr<ASTUnit>> &ASTs) {
+  // The ASTs are returned in the order of the files, so build them one by
+  // one.
+  unsigned Threads = NumThreads;
+  NumThreads = 1;
   ASTBuilderAction Action(ASTs);
-  return run(&Action);
+  int Result = run(&Action);
+  NumThreads = Threads;
+  return Result;
 }
 
 std::unique_ptr<ASTUnit> buildASTFromCode(const Twine &Code,
@@ -0,0 +1,45 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config jobs=2 %s 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config jobs=1 %s 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,alpha.unix.PathCondExtract \
+// RUN:   -analyzer-config jobs=1 %s > %t.serial 2>&1
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,alpha.unix.PathCondExtract \
+// RUN:   -analyzer-config jobs=4 %s > %t.parallel 2>&1
+// RUN: diff %t.serial %t.parallel
+
+int callee(int x) {
+  return 1 / x;
+}
+
+int caller() {
+  return callee(0);
+}
+
+int g;
+
+int store(int x) {
+  if (x < 0)
+    return -22;
+  g = x;
+  return 0;
+}
+
+int chain(int a, int b) {
+  int err = store(a);
+  if (err)
+    return err;
+  if (b > 10)
+    return -1;
+  return store(b);
+}
+
+int other(int y) {
+  if (y == 0)
+    return 2 / y;
+  return 0;
+}
+
+// The callee is inlined into the caller and must not be reported again when
+// it is considered as a top level function.
+// CHECK-DAG: analyzer-jobs.c:10:12: warning: Division by zero
+// CHECK-DAG: analyzer-jobs.c:37:14: warning: Division by zero
+// CHECK-NOT: warning: Division by zero
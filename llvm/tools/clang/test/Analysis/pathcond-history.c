@@ -0,0 +1,34 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-purge=statement -analyzer-config exploration_strategy=bfs %s 2>&1 | sed '/warning: $/,$d' | FileCheck %s
+
+// Purging the dead condition lets the states of both branches fold, so the
+// paths merge before they reach the return. The history of the merged path
+// has the events of both branches, each once, and every event comes after
+// the events recorded before it.
+
+int g;
+int rnd(void);
+
+int merge(void) {
+  if (rnd())
+    g = 1;
+  else
+    g = 1;
+  if (rnd())
+    g = 2;
+  else
+    g = 2;
+  g++;
+  return 0;
+}
+
+// CHECK: @FUNCTION: merge()
+// CHECK-NEXT: @RETURN: 0
+// CHECK-NEXT: @CONDITION: nil
+// CHECK-NEXT: @LOG_CALL: rnd() @LOCATION: {{.*}}pathcond-history.c:12:7
+// CHECK-NEXT: @LOG_STORE: g = 1 @LOCATION: {{.*}}pathcond-history.c:13:5
+// CHECK-NEXT: @LOG_STORE: g = 1 @LOCATION: {{.*}}pathcond-history.c:15:5
+// CHECK-NEXT: @LOG_CALL: rnd() @LOCATION: {{.*}}pathcond-history.c:16:7
+// CHECK-NEXT: @LOG_STORE: g = 2 @LOCATION: {{.*}}pathcond-history.c:17:5
+// CHECK-NEXT: @LOG_STORE: g = 2 @LOCATION: {{.*}}pathcond-history.c:19:5
+// CHECK-NEXT: @LOG_STORE: g++ @LOCATION: {{.*}}pathcond-history.c:20:3
+// CHECK-NOT: @FUNCTION
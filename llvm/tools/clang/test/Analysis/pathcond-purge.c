@@ -0,0 +1,52 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-purge=none %s > %t.none 2>&1
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-purge=keep-path-relevant %s > %t.relevant 2>&1
+// RUN: diff %t.none %t.relevant
+// RUN: FileCheck %s < %t.relevant
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-purge=statement %s 2>&1 | FileCheck -check-prefix=STMT %s
+
+// keep-path-relevant purges the Environment and the Store but keeps all the
+// constraints, so the path conditions are those of a run which never purges,
+// while 'statement' drops the conditions on the values which are dead at the
+// return. Loops are left out: without purging, an event in a loop may be
+// rendered with the value its expression had in the previous iteration.
+
+int g;
+int rnd(void);
+void init(int *p);
+struct s { int a; int b; };
+
+int params(int a, int b) {
+  if (a > b)
+    return 1;
+  if (g == 3)
+    return 2;
+  return 0;
+}
+
+int fields(struct s *p) {
+  int y = p->a + p->b;
+  if (y < 0)
+    return -3;
+  return 0;
+}
+
+int calls(struct s *p) {
+  int x;
+  init(&x);
+  if (x > 5)
+    return -1;
+  if (p->a == 0 && rnd())
+    return -2;
+  return 0;
+}
+
+// CHECK: @FUNCTION: fields(struct s * p)
+// CHECK-NEXT: @RETURN: 0
+// CHECK-NEXT: @CONDITION: (E # p->a + p->b) : { [0, 2147483647] }
+// CHECK: @FUNCTION: fields(struct s * p)
+// CHECK-NEXT: @RETURN: -3
+// CHECK-NEXT: @CONDITION: (E # p->a + p->b) : { [-2147483648, -1] }
+
+// STMT: @FUNCTION: fields(struct s * p)
+// STMT-NEXT: @RETURN: 0
+// STMT-NEXT: @CONDITION: nil
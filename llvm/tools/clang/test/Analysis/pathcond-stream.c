@@ -0,0 +1,60 @@
+// RUN: rm -f %t.stream
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-config pathcond-stream=%t.stream %s 2>&1 | count 0
+// RUN: pathcond-dump %t.stream > %t.dump
+// RUN: FileCheck %s < %t.dump
+
+// The stream converts back to the blocks printed without it, which come
+// before the warnings carrying the same blocks.
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract %s 2>&1 | sed '/warning: $/,$d' > %t.text
+// RUN: diff %t.text %t.dump
+
+// A second run appends its function blocks to the stream.
+// RUN: %clang_cc1 -analyze -analyzer-checker=alpha.unix.PathCondExtract -analyzer-config pathcond-stream=%t.stream %s
+// RUN: pathcond-dump %t.stream | FileCheck -check-prefix=TWICE %s
+
+// RUN: head -c 20 %t.stream > %t.truncated
+// RUN: not pathcond-dump %t.truncated 2>&1 | FileCheck -check-prefix=TRUNCATED %s
+
+int g;
+
+int store(int x) {
+  if (x < 0)
+    return -22;
+  g = x;
+  return 0;
+}
+
+int check(int a) {
+  if (a > 10)
+    return -1;
+  return 1;
+}
+
+// CHECK: @LOCATION: {{.*}}pathcond-stream.c:30:3
+// CHECK-NEXT: @FUNCTION: check(int a)
+// CHECK-NEXT: @RETURN: 1
+// CHECK: @LOCATION: {{.*}}pathcond-stream.c:29:5
+// CHECK-NEXT: @FUNCTION: check(int a)
+// CHECK-NEXT: @RETURN: -1
+// CHECK: @LOCATION: {{.*}}pathcond-stream.c:24:3
+// CHECK-NEXT: @FUNCTION: store(int x)
+// CHECK-NEXT: @RETURN: 0
+// CHECK-NEXT: @CONDITION: (S64 # x) : { [0, 2147483647] }
+// CHECK-NEXT: @LOG_STORE: g = x @LOCATION: {{.*}}pathcond-stream.c:23:3
+// CHECK: @LOCATION: {{.*}}pathcond-stream.c:22:5
+// CHECK-NEXT: @FUNCTION: store(int x)
+// CHECK-NEXT: @RETURN: -22
+// CHECK-NEXT: @CONDITION: (S64 # x) : { [-2147483648, -1] }
+// CHECK-NOT: @FUNCTION
+
+// TWICE: @FUNCTION: check(int a)
+// TWICE: @FUNCTION: check(int a)
+// TWICE: @FUNCTION: store(int x)
+// TWICE: @FUNCTION: store(int x)
+// TWICE: @FUNCTION: check(int a)
+// TWICE: @FUNCTION: check(int a)
+// TWICE: @FUNCTION: store(int x)
+// TWICE: @FUNCTION: store(int x)
+// TWICE-NOT: @FUNCTION
+
+// TRUNCATED: error: '{{.*}}.truncated': truncated record payload
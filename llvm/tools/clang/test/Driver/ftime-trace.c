@@ -0,0 +1,5 @@
+// RUN: %clang -### -c -ftime-trace -ftime-trace-granularity=100 %s 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: "-cc1"
+// CHECK: "-ftime-trace"
+// CHECK: "-ftime-trace-granularity=100"
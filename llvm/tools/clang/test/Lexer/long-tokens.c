@@ -0,0 +1,40 @@
+// RUN: %clang_cc1 -fsyntax-only -std=c11 -trigraphs -verify %s
+// RUN: %clang_cc1 -E -std=c11 -trigraphs %s 2>/dev/null | FileCheck %s
+
+// The tokens below are longer than the vectors the lexer scans them with, and
+// have escaped newlines, trigraphs and UTF-8 characters past the first ones.
+
+int identifier_longer_than_two_vectors_of_characters_which_continues_\
+after_an_escaped_newline = 1;
+int *p1 = &identifier_longer_than_two_vectors_of_characters_which_continues_after_an_escaped_newline;
+// CHECK: int identifier_longer_than_two_vectors_of_characters_which_continues_after_an_escaped_newline = 1;
+
+int identifier_longer_than_two_vectors_of_characters_with_a_trigraph_??/
+newline = 2; // expected-warning@-1 {{trigraph converted}}
+int *p2 = &identifier_longer_than_two_vectors_of_characters_with_a_trigraph_newline;
+
+int identifier_longer_than_two_vectors_of_characters_with_utf8_é = 3;
+int *p3 = &identifier_longer_than_two_vectors_of_characters_with_utf8_é;
+
+int identifier_longer_than_two_vectors_of_characters_with_a_dollar_$ = 4;
+int *p4 = &identifier_longer_than_two_vectors_of_characters_with_a_dollar_$;
+
+int	                                                       	  after_space = 5;
+// CHECK: int after_space = 5;
+
+// A line comment longer than two vectors of characters, which continues \
+int swallowed_by_the_comment;
+// A line comment longer than two vectors of characters, with a trigraph ??/
+int swallowed_by_the_trigraph;
+// CHECK-NOT: swallowed
+// CHECK: int after_comments = 6;
+int after_comments = 6;
+
+_Static_assert(sizeof("A string literal longer than two vectors of chars, \
+with an escaped newline") == 75, "");
+_Static_assert(sizeof("A string literal longer than two vectors of chars, ??=") ==
+               53, ""); // expected-warning@-1 {{trigraph converted}}
+_Static_assert(sizeof("A string literal longer than two vectors of chars, \"\n") ==
+               54, "");
+_Static_assert(sizeof("A string literal longer than two vectors of chars, é") ==
+               54, "");
@@ -0,0 +1,3 @@
+const char *trigraph = "??=";
+int x = 1;
+/* unterminated
@@ -0,0 +1,25 @@
+#ifndef HEADER_TOKEN_CACHE_H
+#define HEADER_TOKEN_CACHE_H
+
+#define STR "a string"
+#define CAT(a, b) a ## b
+
+#if 0
+'unterminated
+#error not reached
+#else
+int CAT(in, cluded) = sizeof(STR);
+#endif
+
+#ifdef DEFINED_BY_MAIN
+int defined_by_main;
+#elif 1
+int not_defined_by_main;
+#endif
+
+#define EMPTY
+int spaced EMPTY ;
+
+#warning cached \
+header
+#endif
@@ -0,0 +1,39 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fsyntax-only -verify -fheader-token-cache=%t -I %S/Inputs %s
+// RUN: %clang_cc1 -fsyntax-only -verify -fheader-token-cache=%t -I %S/Inputs %s
+// RUN: %clang_cc1 -fsyntax-only -print-stats -fheader-token-cache=%t \
+// RUN:   -I %S/Inputs -DDEFINED_BY_MAIN %s 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -E -I %S/Inputs %s -o %t.expected
+// RUN: %clang_cc1 -E -fheader-token-cache=%t -I %S/Inputs %s -o %t.cached
+// RUN: diff %t.expected %t.cached
+// RUN: %clang -### -fheader-token-cache=%t -c %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=DRIVER %s
+// RUN: not %clang_cc1 -fsyntax-only -trigraphs -fheader-token-cache=%t \
+// RUN:   -I %S/Inputs -DINCLUDE_ERROR %s 2>&1 | FileCheck -check-prefix=ERROR %s
+// RUN: not %clang_cc1 -fsyntax-only -trigraphs -fheader-token-cache=%t \
+// RUN:   -I %S/Inputs -DINCLUDE_ERROR %s 2>&1 | FileCheck -check-prefix=ERROR %s
+// RUN: not %clang_cc1 -fsyntax-only -trigraphs -print-stats \
+// RUN:   -fheader-token-cache=%t -I %S/Inputs -DINCLUDE_ERROR %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=ERROR -check-prefix=ERROR-STATS %s
+
+// The first compilation stores the header and the others read it back, as
+// the tokens do not depend on the macros defined when it is entered.
+// CHECK: 1 headers read from the cache.
+// CHECK: 0 headers stored in the cache.
+// DRIVER: "-cc1" {{.*}}"-fheader-token-cache=
+
+// A header about which the lexer issues a diagnostic is never stored, so that
+// the diagnostic is issued by every compilation.
+// ERROR: header-token-cache-error.h:1:{{.*}} warning: trigraph converted
+// ERROR: header-token-cache-error.h:3:1: error: unterminated /* comment
+// ERROR-STATS: 1 headers read from the cache.
+// ERROR-STATS: 0 headers stored in the cache.
+
+#include "header-token-cache.h"
+// expected-warning@Inputs/header-token-cache.h:23 {{cached header}}
+
+int *p = &included;
+
+#ifdef INCLUDE_ERROR
+#include "header-token-cache-error.h"
+#endif
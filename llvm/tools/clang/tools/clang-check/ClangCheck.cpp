@@ -162,6 +162,10 @@ int main(int argc, const char **argv) {
   Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(
       Analyze ? "--analyze" : "-fsyntax-only", ArgumentInsertPosition::BEGIN));
 
+  // The AST dumps of files processed in parallel would interleave.
+  if (!ASTDump && !ASTList && !ASTPrint)
+    Tool.setNumThreads(OptionsParser.getNumThreads());
+
   ClangCheckActionFactory CheckFactory;
   std::unique_ptr<FrontendActionFactory> FrontendFactory;
 
@@ -23,14 +23,18 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Frontend/Utils.h"
 #include "clang/FrontendTool/Utils.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/LinkAllPasses.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
@@ -57,6 +61,29 @@ static void LLVMErrorHandler(void *UserData, const std::string &Message,
   exit(GenCrashDiag ? 70 : 1);
 }
 
+/// Writes the time trace of the compilation (-ftime-trace) next to the
+/// output file, or in the current directory, named after the main input
+/// file, if the output goes to stdout.
+static void WriteTimeTrace(CompilerInstance &Clang) {
+  const FrontendOptions &Opts = Clang.getFrontendOpts();
+  SmallString<128> Path(Opts.OutputFile);
+  if ((Path.empty() || Path.str() == "-") && !Opts.Inputs.empty() &&
+      Opts.Inputs[0].isFile())
+    Path = llvm::sys::path::filename(Opts.Inputs[0].getFile());
+  if (Path.empty() || Path.str() == "-")
+    Path = "out";
+  llvm::sys::path::replace_extension(Path, "json");
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_Text);
+  if (EC) {
+    Clang.getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+        << Path.str() << EC.message();
+    return;
+  }
+  llvm::timeTraceProfilerWrite(OS);
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -106,8 +133,21 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   if (!Success)
     return 1;
 
+  if (Clang->getFrontendOpts().TimeTrace)
+    llvm::timeTraceProfilerInitialize(
+        Clang->getFrontendOpts().TimeTraceGranularity,
+        llvm::sys::path::filename(Argv0));
+
   // Execute the frontend actions.
-  Success = ExecuteCompilerInvocation(Clang.get());
+  {
+    llvm::TimeTraceScope TimeScope("ExecuteCompiler");
+    Success = ExecuteCompilerInvocation(Clang.get());
+  }
+
+  if (llvm::timeTraceProfilerEnabled()) {
+    WriteTimeTrace(*Clang);
+    llvm::timeTraceProfilerCleanup();
+  }
 
   // If any timers were active but haven't been destroyed yet, print their
   // results now.  This happens in -disable-free mode.
@@ -0,0 +1,66 @@
+//===-- pathcond-dump/PathCondDump.cpp - Print path condition streams -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file implements a tool that converts the binary record streams
+/// written by the PathCondExtractor checker
+/// ('-analyzer-config pathcond-stream=<file>') to the textual form the
+/// checker prints by default.
+///
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/PathCondStream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static cl::list<std::string>
+InputFiles(cl::Positional, cl::desc("<stream files>"), cl::OneOrMore);
+
+static cl::opt<std::string>
+OutputFile("o", cl::desc("Output file (default: stdout)"),
+           cl::value_desc("filename"), cl::init("-"));
+
+int main(int argc, const char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "path condition stream to text converter\n");
+
+  std::error_code EC;
+  raw_fd_ostream OS(OutputFile, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "error: cannot open '" << OutputFile << "': " << EC.message()
+           << '\n';
+    return 1;
+  }
+
+  for (unsigned I = 0, E = InputFiles.size(); I != E; ++I) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFileOrSTDIN(InputFiles[I]);
+    if (std::error_code BufEC = Buffer.getError()) {
+      errs() << "error: cannot read '" << InputFiles[I] << "': "
+             << BufEC.message() << '\n';
+      return 1;
+    }
+
+    std::string Error;
+    if (!clang::ento::convertPathCondStreamToText((*Buffer)->getBuffer(), OS,
+                                                  Error)) {
+      errs() << "error: '" << InputFiles[I] << "': " << Error << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
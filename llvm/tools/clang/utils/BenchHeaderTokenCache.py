@@ -0,0 +1,179 @@
+#!/usr/bin/env python
+
+"""
+Benchmark of the header token cache.
+
+Generates a batch of translation units which all include the same headers,
+as the files of a kernel subsystem include the headers of include/linux, and
+a compilation database for them. Reports the time taken over the batch:
+- to preprocess each file with '-cc1 -Eonly', which lexes and preprocesses
+  without parsing,
+- to check the syntax of the files with clang-check, a ClangTool,
+without the cache ('-fheader-token-cache' not given), while filling it, and
+with the cache filled by the previous run.
+
+Usage: BenchHeaderTokenCache.py [options] [-- cc1 args]
+
+"""
+
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+Configs = ['no cache', 'cold cache', 'warm cache']
+
+def generateHeader(Index, NumDecls):
+    """Returns the source of the header 'Index'."""
+    Lines = ['/*',
+             ' * Header %d of the header token cache benchmark.' % Index,
+             ' */',
+             '#ifndef BENCH_HEADER_%d_H' % Index,
+             '#define BENCH_HEADER_%d_H' % Index,
+             '']
+    if Index > 0:
+        Lines.append('#include "header%d.h"' % (Index - 1))
+        Lines.append('')
+    for D in range(NumDecls):
+        Name = 'h%d_%d' % (Index, D)
+        Lines += [
+            '/* The flags of %s. */' % Name,
+            '#define %s_FLAG (1UL << %d)' % (Name.upper(), D % 32),
+            '#define %s_NAME "%s"' % (Name.upper(), Name),
+            'struct %s {' % Name,
+            '  int count;',
+            '  unsigned long flags;',
+            '  char name[sizeof(%s_NAME)];' % Name.upper(),
+            '#ifdef CONFIG_DEBUG_%d' % (D % 8),
+            '  const char *owner;',
+            '#endif',
+            '};',
+            '',
+            'static inline int %s_test(const struct %s *p) {' % (Name, Name),
+            '#if defined(CONFIG_SMP) && CONFIG_NR_CPUS > %d' % D,
+            '  return p->count > 0 && (p->flags & %s_FLAG) != 0;' %
+                Name.upper(),
+            '#else',
+            '  return (p->flags & %s_FLAG) != 0;' % Name.upper(),
+            '#endif',
+            '}',
+            '']
+    Lines.append('#endif')
+    return '\n'.join(Lines) + '\n'
+
+def generateSource(Index, NumHeaders):
+    """Returns the source of the translation unit 'Index'."""
+    Lines = ['#include "header%d.h"' % (NumHeaders - 1),
+             '',
+             'int file%d(struct h0_0 *p) {' % Index,
+             '  return h0_0_test(p);',
+             '}']
+    return '\n'.join(Lines) + '\n'
+
+def generate(Dir, NumFiles, NumHeaders, NumDecls, ExtraArgs):
+    """Writes the batch and its compilation database to 'Dir', and returns
+    the paths of the files."""
+    for H in range(NumHeaders):
+        with open(os.path.join(Dir, 'header%d.h' % H), 'w') as F:
+            F.write(generateHeader(H, NumDecls))
+    Files = []
+    Commands = []
+    for I in range(NumFiles):
+        File = os.path.join(Dir, 'file%d.c' % I)
+        with open(File, 'w') as F:
+            F.write(generateSource(I, NumHeaders))
+        Files.append(File)
+        Commands.append({
+            'directory': Dir,
+            'command': ' '.join(['clang', '-fsyntax-only', '-DCONFIG_SMP',
+                                 '-DCONFIG_NR_CPUS=64'] + ExtraArgs + [File]),
+            'file': File})
+    with open(os.path.join(Dir, 'compile_commands.json'), 'w') as F:
+        json.dump(Commands, F, indent=2)
+    return Files
+
+def run(Cmd):
+    """Runs 'Cmd' and exits on failure."""
+    P = subprocess.Popen(Cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    _, Err = P.communicate()
+    if P.returncode != 0:
+        print >> sys.stderr, 'error: %s failed:' % Cmd[0]
+        print >> sys.stderr, Err
+        sys.exit(1)
+
+def preprocess(Clang, Files, CacheArgs, ExtraArgs):
+    """Returns the time taken to preprocess 'Files' one by one."""
+    Start = time.time()
+    for File in Files:
+        run([Clang, '-cc1', '-Eonly', '-DCONFIG_SMP', '-DCONFIG_NR_CPUS=64'] +
+            CacheArgs + ExtraArgs + [File])
+    return time.time() - Start
+
+def check(ClangCheck, Dir, Files, CacheArgs, Jobs):
+    """Returns the time taken by clang-check over 'Files'."""
+    Cmd = [ClangCheck, '-p', Dir, '-j', str(Jobs)]
+    Cmd += ['-extra-arg=' + A for A in CacheArgs]
+    Start = time.time()
+    run(Cmd + Files)
+    return time.time() - Start
+
+def measure(Dir, Files, Measure):
+    """Returns the times taken by 'Measure' in each configuration."""
+    Cache = os.path.join(Dir, 'cache')
+    if os.path.exists(Cache):
+        shutil.rmtree(Cache)
+    return [Measure([]),
+            Measure(['-fheader-token-cache=' + Cache]),
+            Measure(['-fheader-token-cache=' + Cache])]
+
+def main():
+    Parser = OptionParser(usage='%prog [options] [-- cc1 args]')
+    Parser.add_option('--clang', dest='Clang', default='clang',
+                      help='The clang binary to run [default=%default]')
+    Parser.add_option('--clang-check', dest='ClangCheck',
+                      default='clang-check',
+                      help='The clang-check binary to run, or an empty '
+                           'string to skip the ClangTool batch '
+                           '[default=%default]')
+    Parser.add_option('-j', dest='Jobs', type='int', default=1,
+                      help='The number of files clang-check processes in '
+                           'parallel [default=%default]')
+    Parser.add_option('--files', dest='NumFiles', type='int', default=50,
+                      help='The number of translation units '
+                           '[default=%default]')
+    Parser.add_option('--headers', dest='NumHeaders', type='int', default=40,
+                      help='The number of headers [default=%default]')
+    Parser.add_option('--decls', dest='NumDecls', type='int', default=50,
+                      help='The number of structs per header '
+                           '[default=%default]')
+    Args = sys.argv[1:]
+    ExtraArgs = []
+    if '--' in Args:
+        ExtraArgs = Args[Args.index('--') + 1:]
+        Args = Args[:Args.index('--')]
+    (Opts, _) = Parser.parse_args(Args)
+
+    Dir = tempfile.mkdtemp()
+    try:
+        Files = generate(Dir, Opts.NumFiles, Opts.NumHeaders, Opts.NumDecls,
+                         ExtraArgs)
+        Rows = [('preprocess (s)', measure(Dir, Files,
+            lambda CacheArgs: preprocess(Opts.Clang, Files, CacheArgs,
+                                         ExtraArgs)))]
+        if Opts.ClangCheck:
+            Rows.append(('clang-check (s)', measure(Dir, Files,
+                lambda CacheArgs: check(Opts.ClangCheck, Dir, Files,
+                                        CacheArgs, Opts.Jobs))))
+    finally:
+        shutil.rmtree(Dir)
+
+    print '%-20s %12s %12s %12s' % tuple(['batch'] + Configs)
+    for Name, Times in Rows:
+        print '%-20s %12.2f %12.2f %12.2f' % tuple([Name] + Times)
+
+if __name__ == '__main__':
+    main()
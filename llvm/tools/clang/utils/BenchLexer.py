@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+
+"""
+Benchmark of the throughput of the lexer.
+
+Lexes a corpus of preprocessed files with '-cc1 -Eonly', which runs the
+preprocessor over the tokens without parsing them, and reports the best time
+over a number of runs and the resulting throughput.  A preprocessed corpus
+keeps the time spent looking up headers out of the measurement; a kernel
+corpus can be produced by building the kernel with 'make KCFLAGS=-save-temps'
+and collecting the .i files.  Given a baseline clang, for instance one built
+without the SSE2 scanners of the lexer, compares the two.
+
+Usage: BenchLexer.py [options] <files or directories> [-- cc1 args]
+
+"""
+
+import os
+import subprocess
+import sys
+import time
+from optparse import OptionParser
+
+def findFiles(Paths):
+    """Returns the preprocessed files in 'Paths', searching directories."""
+    Files = []
+    for Path in Paths:
+        if not os.path.isdir(Path):
+            Files.append(Path)
+            continue
+        for Root, _, Names in os.walk(Path):
+            Files += [os.path.join(Root, N) for N in sorted(Names)
+                      if os.path.splitext(N)[1] in ('.i', '.ii')]
+    return Files
+
+def lex(Clang, Files, ExtraArgs):
+    """Returns the time taken to lex 'Files' one by one."""
+    Start = time.time()
+    for File in Files:
+        P = subprocess.Popen([Clang, '-cc1', '-Eonly'] + ExtraArgs + [File],
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        _, Err = P.communicate()
+        if P.returncode != 0:
+            print >> sys.stderr, 'error: %s failed on %s:' % (Clang, File)
+            print >> sys.stderr, Err
+            sys.exit(1)
+    return time.time() - Start
+
+def main():
+    Parser = OptionParser(usage='%prog [options] <files or directories> '
+                                '[-- cc1 args]')
+    Parser.add_option('--clang', dest='Clang', default='clang',
+                      help='The clang binary to measure [default=%default]')
+    Parser.add_option('--baseline', dest='Baseline', default='',
+                      help='A clang binary to compare against')
+    Parser.add_option('-r', dest='Runs', type='int', default=5,
+                      help='The number of runs over the corpus, of which the '
+                           'best is reported [default=%default]')
+    Args = sys.argv[1:]
+    ExtraArgs = []
+    if '--' in Args:
+        ExtraArgs = Args[Args.index('--') + 1:]
+        Args = Args[:Args.index('--')]
+    (Opts, Paths) = Parser.parse_args(Args)
+
+    Files = findFiles(Paths)
+    if not Files:
+        Parser.error('no preprocessed files given')
+    Size = sum(os.path.getsize(F) for F in Files) / (1024.0 * 1024.0)
+
+    Clangs = [Opts.Clang]
+    if Opts.Baseline:
+        Clangs.append(Opts.Baseline)
+    Times = []
+    for Clang in Clangs:
+        Times.append(min(lex(Clang, Files, ExtraArgs)
+                         for _ in range(Opts.Runs)))
+
+    print '%d files, %.1f MB' % (len(Files), Size)
+    print '%-40s %10s %10s' % ('clang', 'time (s)', 'MB/s')
+    for Clang, Time in zip(Clangs, Times):
+        print '%-40s %10.2f %10.1f' % (Clang, Time, Size / Time)
+    if Opts.Baseline:
+        print 'speedup over the baseline: %.2fx' % (Times[1] / Times[0])
+
+if __name__ == '__main__':
+    main()
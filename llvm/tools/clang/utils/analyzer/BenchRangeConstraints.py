@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+
+"""
+Microbenchmark of the range constraint manager.
+
+Generates functions in the style of file system code, where every call
+returns an error code which is checked against zero ('if (err < 0)',
+'if (ret == 0)', ...), analyzes them with '-analyzer-stats', and reports the
+average cost of an assumption on the range of a symbol and the memory taken
+by the range sets per program state.
+
+The cost per assumption is the analyzer time divided by the number of
+assumptions, so the generated code is dominated by the comparisons. Run the
+script with the '--clang' of two builds to compare them.
+
+Usage: BenchRangeConstraints.py [options] [-- cc1 args]
+
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+from optparse import OptionParser
+
+Comparisons = ['%s < 0', '%s == 0', '%s != 0', '%s > 0', '%s <= -1',
+               '%s >= 4096']
+
+def generate(NumFunctions, NumCalls):
+    """Returns the source of the benchmark."""
+    Lines = ['int op(int);', '']
+    for F in range(NumFunctions):
+        Lines.append('int f%d(int a) {' % F)
+        Lines.append('  int err, ret = 0;')
+        for C in range(NumCalls):
+            Cond = Comparisons[(F + C) % len(Comparisons)] % 'err'
+            Lines.append('  err = op(a + %d);' % C)
+            Lines.append('  if (%s)' % Cond)
+            Lines.append('    ret += %d;' % (C + 1))
+        Lines.append('  return ret;')
+        Lines.append('}')
+        Lines.append('')
+    return '\n'.join(Lines)
+
+def getStat(Output, Name):
+    """Returns the value of the statistic 'Name', or None."""
+    M = re.search(r'^\s*(\d+) \S+\s+- ' + re.escape(Name), Output,
+                  re.MULTILINE)
+    return int(M.group(1)) if M else None
+
+def getTime(Output):
+    """Returns the total analyzer time in seconds, or None."""
+    for Line in Output.splitlines():
+        if 'Analyzer Total Time' in Line:
+            # The wall time is the last column.
+            Times = re.findall(r'(\d+\.\d+)\s+\(', Line)
+            return float(Times[-1]) if Times else None
+    return None
+
+def main():
+    Parser = OptionParser(usage='%prog [options] [-- cc1 args]')
+    Parser.add_option('--clang', dest='Clang', default='clang',
+                      help='The clang binary to run [default=%default]')
+    Parser.add_option('--functions', dest='NumFunctions', type='int',
+                      default=50,
+                      help='The number of functions [default=%default]')
+    Parser.add_option('--calls', dest='NumCalls', type='int', default=12,
+                      help='The number of checked calls per function '
+                           '[default=%default]')
+    Args = sys.argv[1:]
+    ExtraArgs = []
+    if '--' in Args:
+        ExtraArgs = Args[Args.index('--') + 1:]
+        Args = Args[:Args.index('--')]
+    (Opts, _) = Parser.parse_args(Args)
+
+    Fd, File = tempfile.mkstemp(suffix='.c')
+    try:
+        os.write(Fd, generate(Opts.NumFunctions, Opts.NumCalls))
+        os.close(Fd)
+        Cmd = [Opts.Clang, '-cc1', '-analyze', '-analyzer-checker=core',
+               '-analyzer-stats'] + ExtraArgs + [File]
+        P = subprocess.Popen(Cmd, stdout=subprocess.PIPE,
+                             stderr=subprocess.PIPE)
+        _, Err = P.communicate()
+    finally:
+        os.remove(File)
+    if P.returncode != 0:
+        print >> sys.stderr, 'error: the analyzer failed:'
+        print >> sys.stderr, Err
+        sys.exit(1)
+
+    Time = getTime(Err)
+    Assumes = getStat(Err, 'The # of assumptions on the range of a symbol')
+    States = getStat(Err, 'The # of distinct program states created')
+    Sets = getStat(Err, 'The # of distinct range sets created')
+    Bytes = getStat(Err, 'The # of bytes allocated for range sets')
+
+    print 'analyzer time (s)            %s' % Time
+    print 'range assumptions            %s' % Assumes
+    print 'program states               %s' % States
+    print 'distinct range sets          %s' % Sets
+    if Time is not None and Assumes:
+        print 'time per assumption (us)     %.3f' % (Time * 1e6 / Assumes)
+    if Bytes is not None and States:
+        print 'range set bytes per state    %.2f' % (float(Bytes) / States)
+
+if __name__ == '__main__':
+    main()
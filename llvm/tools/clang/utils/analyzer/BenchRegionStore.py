@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+
+"""
+Microbenchmark of the region store.
+
+Generates functions which fill the fields of large structs, as file system
+code does with its inodes and superblocks, and read them back along several
+paths, so that every store has a cluster with many bindings. Analyzes them
+with '-analyzer-stats' with the bindings of the clusters kept in AVL trees
+('-analyzer-store=region') and in hash array mapped tries
+('-analyzer-store=region-hash-trie'), and reports the analyzer time and the
+memory taken by the states and the clusters for each.
+
+Usage: BenchRegionStore.py [options] [-- cc1 args]
+
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+from optparse import OptionParser
+
+Stores = ['region', 'region-hash-trie']
+
+def generate(NumFunctions, NumFields):
+    """Returns the source of the benchmark."""
+    Lines = ['int op(int);', '', 'struct inode {']
+    for I in range(NumFields):
+        Lines.append('  int f%d;' % I)
+    Lines.append('};')
+    Lines.append('')
+    for F in range(NumFunctions):
+        Lines.append('int fill%d(struct inode *ip, int a) {' % F)
+        Lines.append('  int ret = 0;')
+        for I in range(NumFields):
+            Lines.append('  ip->f%d = op(a + %d);' % (I, I))
+        # Each branch reads fields back and updates others, so that the
+        # clusters of the paths share most of their bindings.
+        for I in range(0, NumFields, 4):
+            Lines.append('  if (ip->f%d < 0)' % I)
+            Lines.append('    ip->f%d = ret++;' % ((I * 7 + F) % NumFields))
+        for I in range(NumFields):
+            Lines.append('  ret += ip->f%d;' % I)
+        Lines.append('  return ret;')
+        Lines.append('}')
+        Lines.append('')
+    return '\n'.join(Lines)
+
+def getStat(Output, Name):
+    """Returns the value of the statistic 'Name', or None."""
+    M = re.search(r'^\s*(\d+) \S+\s+- ' + re.escape(Name), Output,
+                  re.MULTILINE)
+    return int(M.group(1)) if M else None
+
+def getTime(Output):
+    """Returns the total analyzer time in seconds, or None."""
+    for Line in Output.splitlines():
+        if 'Analyzer Total Time' in Line:
+            # The wall time is the last column.
+            Times = re.findall(r'(\d+\.\d+)\s+\(', Line)
+            return float(Times[-1]) if Times else None
+    return None
+
+def analyze(Clang, File, Store, ExtraArgs):
+    """Returns the statistics output of analyzing 'File' with 'Store'."""
+    Cmd = [Clang, '-cc1', '-analyze', '-analyzer-checker=core',
+           '-analyzer-store=' + Store, '-analyzer-stats'] + ExtraArgs + [File]
+    P = subprocess.Popen(Cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    _, Err = P.communicate()
+    if P.returncode != 0:
+        print >> sys.stderr, 'error: the analyzer failed:'
+        print >> sys.stderr, Err
+        sys.exit(1)
+    return Err
+
+def main():
+    Parser = OptionParser(usage='%prog [options] [-- cc1 args]')
+    Parser.add_option('--clang', dest='Clang', default='clang',
+                      help='The clang binary to run [default=%default]')
+    Parser.add_option('--functions', dest='NumFunctions', type='int',
+                      default=20,
+                      help='The number of functions [default=%default]')
+    Parser.add_option('--fields', dest='NumFields', type='int', default=64,
+                      help='The number of fields per struct '
+                           '[default=%default]')
+    Args = sys.argv[1:]
+    ExtraArgs = []
+    if '--' in Args:
+        ExtraArgs = Args[Args.index('--') + 1:]
+        Args = Args[:Args.index('--')]
+    (Opts, _) = Parser.parse_args(Args)
+
+    Fd, File = tempfile.mkstemp(suffix='.c')
+    try:
+        os.write(Fd, generate(Opts.NumFunctions, Opts.NumFields))
+        os.close(Fd)
+        Outputs = [analyze(Opts.Clang, File, S, ExtraArgs) for S in Stores]
+    finally:
+        os.remove(File)
+
+    print '%-32s %16s %16s' % tuple(['store'] + Stores)
+    Rows = [
+        ('analyzer time (s)', getTime),
+        ('bytes per state', lambda O: getStat(O,
+            'The average # of bytes per program state, including its store')),
+        ('bytes per cluster', lambda O: getStat(O,
+            'The average # of bytes per store binding cluster')),
+        ('max graph (KB)', lambda O: getStat(O,
+            'The maximum # of kilobytes allocated for an exploded graph and '
+            'its states')),
+    ]
+    for Name, Get in Rows:
+        print '%-32s %16s %16s' % tuple([Name] + [Get(O) for O in Outputs])
+
+if __name__ == '__main__':
+    main()
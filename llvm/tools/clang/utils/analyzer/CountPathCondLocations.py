@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+
+"""
+Script to compare the analyzer exploration strategies by the number of
+distinct return signatures the PathCondExtractor checker reports under a
+fixed node budget.
+
+Every source file is analyzed once per strategy with
+'-analyzer-config max-nodes=<budget>,exploration_strategy=<strategy>', and the
+distinct '@LOCATION' signatures ('@LOCATION', '@FUNCTION' and '@RETURN'
+lines) printed by the checker are counted.
+
+Usage: CountPathCondLocations.py [options] file.c [file.c ...] [-- cc1 args]
+
+"""
+
+import subprocess
+import sys
+from optparse import OptionParser
+
+Strategies = ['dfs', 'bfs', 'bfs_block_dfs_contents',
+              'unexplored_returns_first']
+
+def getSignatures(Output):
+    """Returns the set of return signatures in the checker output."""
+    Signatures = set()
+    Lines = Output.splitlines()
+    I = 0
+    while I < len(Lines):
+        Line = Lines[I]
+        I += 1
+        if not Line.startswith('@LOCATION: '):
+            continue
+        Sig = [Line]
+        while I < len(Lines) and (Lines[I].startswith('@FUNCTION: ') or
+                                  Lines[I].startswith('@RETURN: ')):
+            Sig.append(Lines[I])
+            I += 1
+        Signatures.add('\n'.join(Sig))
+    return Signatures
+
+def analyze(Clang, File, Strategy, Budget, ExtraArgs):
+    Config = 'max-nodes=%d,exploration_strategy=%s' % (Budget, Strategy)
+    Cmd = [Clang, '-cc1', '-analyze',
+           '-analyzer-checker=alpha.unix.PathCondExtract',
+           '-analyzer-config', Config] + ExtraArgs + [File]
+    P = subprocess.Popen(Cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    _, Err = P.communicate()
+    if P.returncode != 0:
+        print >> sys.stderr, 'error: analyzing %s failed:' % File
+        print >> sys.stderr, Err
+        sys.exit(1)
+    return getSignatures(Err)
+
+def main():
+    Parser = OptionParser(usage='%prog [options] file... [-- cc1 args]')
+    Parser.add_option('--clang', dest='Clang', default='clang',
+                      help='The clang binary to run [default=%default]')
+    Parser.add_option('--max-nodes', dest='Budget', type='int',
+                      default=10000,
+                      help='The node budget per top level function '
+                           '[default=%default]')
+    Parser.add_option('--strategy', dest='Strategies', action='append',
+                      help='A strategy to compare (may be repeated) '
+                           '[default=all]')
+    Args = sys.argv[1:]
+    ExtraArgs = []
+    if '--' in Args:
+        ExtraArgs = Args[Args.index('--') + 1:]
+        Args = Args[:Args.index('--')]
+    (Opts, Files) = Parser.parse_args(Args)
+    if not Files:
+        Parser.error('no input files')
+
+    for Strategy in Opts.Strategies or Strategies:
+        Signatures = set()
+        for File in Files:
+            Signatures |= set(File + ':' + Sig for Sig in
+                              analyze(Opts.Clang, File, Strategy, Opts.Budget,
+                                      ExtraArgs))
+        print '%-28s %d' % (Strategy, len(Signatures))
+
+if __name__ == '__main__':
+    main()